@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// ============= СЧЕТЧИК ВЫДЕЛЕНИЙ ПАМЯТИ =============
+// Подменяет глобальные operator new/delete (и в подключенных .so тоже) и
+// считает выделения и их байты во всех потоках, пока AllocHook::counting ==
+// true.
+// Замена глобальных операторов должна быть одна на программу, поэтому
+// заголовок подключается только в .cpp с main().
+namespace AllocHook {
+    inline std::atomic<bool> counting(false);
+    inline std::atomic<unsigned long long> allocations(0);
+    inline std::atomic<unsigned long long> bytes(0);
+}
+
+void* operator new(std::size_t n) {
+    if (AllocHook::counting.load(std::memory_order_relaxed)) {
+        AllocHook::allocations.fetch_add(1, std::memory_order_relaxed);
+        AllocHook::bytes.fetch_add(n, std::memory_order_relaxed);
+    }
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "alloc_hook.h"
+#include "game.h"
+
+// ============= ПРОВЕРКА ВЫДЕЛЕНИЙ ПАМЯТИ В ПРАВИЛАХ =============
+// Играет партии без терминала случайными захватами, способностями и
+// пасами и считает вызовы глобального operator new внутри playAction().
+// После --warmup первых ходов (буферы правил уже под размер поля) ход не
+// должен выделять память ни на каком числе потоков: иначе печатается,
+// сколько выделений пришлось на захваты, способности и пасы, и код выхода
+// 1. С --journal включены журнал партии (очищается после каждого хода) и
+// история счетчиков, с --events - поток событий events.h.
+//
+//   ./alloccheck --size 16 --plies 20000
+//   CELL_WARFARE_THREADS=4 ./alloccheck --size 64 --players 4 --journal --events
+
+namespace {
+    struct Options {
+        int size = Constants::BOARD_SIZE_SMALL;
+        int players = 2;
+        int plies = 10000;
+        int warmup = 500;
+        uint32_t seed = 1;
+        bool journal = false;
+        bool events = false;
+    };
+
+    // Случайный ход: способность, если на нее хватает очков, иначе захват
+    // случайной доступной клетки, иначе пас. После способности захватывать
+    // нельзя - пас.
+    Action randomAction(const Game& game, std::mt19937& rng) {
+        int size = game.getSize();
+        const Player& player = game.getPlayer(game.getCurrentPlayer());
+        if (player.abilityUsedThisTurn || rng() % 20 == 0) return Action();
+        if (rng() % 3 == 0) {
+            int ability = static_cast<int>(rng() % NUM_ABILITIES);
+            if (player.score >= ABILITIES[ability].baseCost) {
+                return Action::useAbility(ability, static_cast<int>(rng() % size), static_cast<int>(rng() % size),
+                                          "WASD"[rng() % 4]);
+            }
+        }
+        const std::vector<uint32_t>& available = game.getAvailableCells();
+        if (available.empty()) return Action();
+        int chosen = static_cast<int>(available[rng() % available.size()]);
+        return Action::capture(chosen / size, chosen % size);
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--journal") {
+            options.journal = true;
+        } else if (arg == "--events") {
+            options.events = true;
+        } else if (i + 1 < argc && arg == "--size") {
+            options.size = std::atoi(argv[++i]);
+        } else if (i + 1 < argc && arg == "--players") {
+            options.players = std::atoi(argv[++i]);
+        } else if (i + 1 < argc && arg == "--plies") {
+            options.plies = std::max(1, std::atoi(argv[++i]));
+        } else if (i + 1 < argc && arg == "--warmup") {
+            options.warmup = std::max(0, std::atoi(argv[++i]));
+        } else if (i + 1 < argc && arg == "--seed") {
+            options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else {
+            std::fprintf(stderr, "Использование: %s [--size N] [--players N] [--plies N] [--warmup N] [--seed N] "
+                                 "[--journal] [--events]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (options.size < Constants::BOARD_SIZE_SMALL || options.size > 1024 ||
+        options.players < Constants::MIN_PLAYERS || options.players > Constants::MAX_PLAYERS) {
+        std::fprintf(stderr, "Недопустимые размер поля или число игроков\n");
+        return 2;
+    }
+
+    Game game(options.size, options.seed, false, MapGen::Options(), options.players);
+    std::unique_ptr<Events::Stream> stream;
+    if (options.events) {
+        std::vector<std::unique_ptr<Events::Sink>> sinks;
+        sinks.emplace_back(new Events::NullSink());
+        stream.reset(new Events::Stream(std::move(sinks)));
+        game.setEventStream(stream.get());
+    }
+    if (options.journal) {
+        game.setJournalEnabled(true);
+        game.setStatsHistory(64);
+    }
+
+    const char* const kindNames[] = {"захваты", "способности", "пасы"};
+    unsigned long long played[3] = {}, applied[3] = {}, allocated[3] = {};
+    std::mt19937 rng(options.seed);
+    int games = 1;
+    for (int ply = 0; ply < options.plies; ++ply) {
+        if (game.isGameOver()) game.reset(options.seed + static_cast<uint32_t>(games++));
+        Action action = randomAction(game, rng);
+
+        unsigned long long before = AllocHook::allocations.load();
+        AllocHook::counting = ply >= options.warmup;
+        bool ok = game.playAction(action);
+        AllocHook::counting = false;
+        if (options.journal) game.clearJournal();
+        if (ply < options.warmup) continue;
+
+        ++played[action.kind];
+        if (ok) ++applied[action.kind];
+        allocated[action.kind] += AllocHook::allocations.load() - before;
+    }
+    game.setEventStream(nullptr);
+
+    std::printf("Поле %dx%d, игроков: %d, потоков: %d, партий: %d, ходов после разогрева: %d\n", options.size,
+                options.size, options.players, ThreadPool::instance().threadCount(), games,
+                std::max(0, options.plies - options.warmup));
+    unsigned long long total = 0;
+    for (int kind = 0; kind < 3; ++kind) {
+        std::printf("  %s: %llu ходов (%llu применено), выделений: %llu\n", kindNames[kind], played[kind],
+                    applied[kind], allocated[kind]);
+        total += allocated[kind];
+    }
+    if (total > 0) {
+        std::printf("Ходы выделяли память: %llu раз\n", total);
+        return 1;
+    }
+    std::printf("Выделений памяти во время ходов: 0\n");
+    return 0;
+}
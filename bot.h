@@ -0,0 +1,162 @@
+#pragma once
+
+#include <climits>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "game.h"
+
+// ============= ПРОСТОЙ БОТ =============
+// Жадный бот на один ход вперед: пробует каждый доступный захват на ветке
+// партии (Game::fork()) и берет позицию с лучшей оценкой. Способностями не
+// пользуется.
+//
+// Кроме постоянной оценки evaluate(game, playerId) есть оценка по весам
+// признаков (Weights), которые подбирает evaltune.cpp по шардам самоигры.
+class Bot {
+public:
+    // Признаки игрока для оценки по весам. evaltune.cpp считает их же по
+    // разобранной позиции шарда, поэтому смысл признака менять нельзя -
+    // только добавлять новые в конец.
+    enum Feature {
+        SCORE,          // Очки
+        TERRITORY,      // Своих клеток
+        FRONTIER,       // Своих клеток с чужим или нейтральным соседом
+        KING_DISTANCE,  // Захватов до вражеского короля, без пути - 2 * size
+        FORTIFIED,      // Своих укрепленных клеток
+        SABOTAGE,       // Очков диверсий на клетках, которые можно захватить
+        COMMANDER,      // Командир активен (0 или 1)
+        FEATURES
+    };
+
+    static constexpr const char* FEATURE_NAMES[FEATURES] = {
+        "score", "territory", "frontier", "king_distance", "fortified", "sabotage", "commander"
+    };
+
+    // Единиц оценки на логит вероятности победы
+    static constexpr int EVAL_SCALE = 100;
+
+    // Веса признаков - логит на единицу разности признаков игрока и
+    // соперника. Файл текстовый: строки "имя вес", # - комментарий.
+    struct Weights {
+        float w[FEATURES] = {};
+
+        bool save(const std::string& path, const std::string& comment = std::string()) const {
+            std::ofstream file(path);
+            if (!file) return false;
+            file << "# Веса оценки Bot::Weights (evaltune.cpp)\n";
+            if (!comment.empty()) file << "# " << comment << "\n";
+            file.precision(9);
+            for (int k = 0; k < FEATURES; ++k) file << FEATURE_NAMES[k] << ' ' << w[k] << '\n';
+            return static_cast<bool>(file);
+        }
+
+        // Признаки, которых нет в файле, получают вес 0
+        bool load(const std::string& path) {
+            std::ifstream file(path);
+            if (!file) return false;
+            *this = Weights();
+            std::string name;
+            while (file >> name) {
+                if (name[0] == '#') {
+                    std::getline(file, name);
+                    continue;
+                }
+                float value;
+                if (!(file >> value)) return false;
+                int k = 0;
+                while (k < FEATURES && name != FEATURE_NAMES[k]) ++k;
+                if (k == FEATURES) return false;
+                w[k] = value;
+            }
+            return true;
+        }
+    };
+
+    // Признаки игрока player (с 0) - из живых счетчиков партии; проход
+    // только по клеткам, которые игрок может захватить
+    static void features(const Game& game, int player, float out[FEATURES]) {
+        int size = game.getSize();
+        const Player& state = game.getPlayer(player);
+        const PlayerStats& stats = game.getStats(player);
+        int kingDistance = game.getKingThreat(player);
+        int sabotage = 0;
+        for (uint32_t i : game.getCapturableCells(player)) {
+            const Cell& cell = game.getCell(static_cast<int>(i) / size, static_cast<int>(i) % size);
+            if (cell.sabotageCell) sabotage += cell.sabotageValue;
+        }
+        out[SCORE] = static_cast<float>(state.score);
+        out[TERRITORY] = static_cast<float>(stats.territory);
+        out[FRONTIER] = static_cast<float>(stats.frontier);
+        out[KING_DISTANCE] = static_cast<float>(kingDistance < 0 ? size * 2 : kingDistance);
+        out[FORTIFIED] = static_cast<float>(stats.fortified);
+        out[SABOTAGE] = static_cast<float>(sabotage);
+        out[COMMANDER] = state.commanderActive ? 1.0f : 0.0f;
+    }
+
+    // Оценка по весам для игрока playerId (1-2) в единицах EVAL_SCALE
+    static int evaluate(const Game& game, int playerId, const Weights& weights) {
+        if (game.isGameOver()) {
+            return game.getWinner() == playerId ? INT_MAX / 2 : INT_MIN / 2;
+        }
+        float mine[FEATURES], theirs[FEATURES];
+        features(game, playerId - 1, mine);
+        features(game, 2 - playerId, theirs);
+        float logit = 0;
+        for (int k = 0; k < FEATURES; ++k) logit += weights.w[k] * (mine[k] - theirs[k]);
+        return static_cast<int>(std::lround(logit * EVAL_SCALE));
+    }
+
+    // Оценка позиции с точки зрения игрока playerId (1-2): разница очков,
+    // разница территорий и близость своих клеток к вражескому королю
+    static int evaluate(const Game& game, int playerId) {
+        const Player& me = game.getPlayer(playerId - 1);
+        const Player& enemy = game.getPlayer(2 - playerId);
+
+        // Территории и расстояние до короля - из живых счетчиков партии,
+        // без прохода по полю. Расстояние - в захватах в обход укреплений.
+        int myCells = game.getStats(playerId - 1).territory;
+        int enemyCells = game.getStats(2 - playerId).territory;
+        int kingDistance = game.getKingThreat(playerId - 1);
+        if (kingDistance < 0) kingDistance = game.getSize() * 2;
+
+        if (game.isGameOver()) {
+            return game.getWinner() == playerId ? INT_MAX / 2 : INT_MIN / 2;
+        }
+        return (me.score - enemy.score) * 4 + (myCells - enemyCells) - kingDistance * 2;
+    }
+
+    // Ход для игрока, чья сейчас очередь. seed разбивает равные оценки;
+    // weights - оценка по весам вместо постоянной.
+    static Action chooseMove(const Game& game, uint32_t seed, const Weights* weights = nullptr) {
+        int size = game.getSize();
+        int playerId = game.getCurrentPlayer() + 1;
+        std::mt19937 rng(seed);
+
+        Action best = Action::pass();
+        int bestScore = INT_MIN;
+        int ties = 0;
+
+        for (int x = 0; x < size; ++x) {
+            for (int y = 0; y < size; ++y) {
+                if (!game.isCellAvailable(x, y)) continue;
+
+                Game trial = game.fork();
+                if (!trial.playCapture(x, y)) continue;
+                int score = weights ? evaluate(trial, playerId, *weights) : evaluate(trial, playerId);
+
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = Action::capture(x, y);
+                    ties = 1;
+                } else if (score == bestScore && rng() % ++ties == 0) {
+                    best = Action::capture(x, y);
+                }
+            }
+        }
+        return best;
+    }
+};
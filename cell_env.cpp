@@ -0,0 +1,278 @@
+#include "cell_env.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "game.h"
+
+// ============= ПАКЕТНАЯ СРЕДА =============
+// Каждая среда - Game без терминала со своим зерном. Шаг пакета делят между
+// собой постоянные потоки среды и вызывающий поток: потоки спят до
+// следующего шага и разбирают среды по атомарному счетчику. В отличие от
+// ThreadPool::parallelFor шаг не заводит задач и не выделяет память.
+//
+// Правила каждой партии считаются в ее потоке (Game::setParallel(false)):
+// параллельность здесь - между партиями.
+//
+//   g++ -std=c++17 -O2 -pthread -fPIC -shared -o libcellenv.so cell_env.cpp
+
+namespace {
+    const float ILLEGAL_ACTION_PENALTY = -0.1f;
+    const float SCORE_REWARD_SCALE = 0.01f;
+    const int ENVS_PER_CLAIM = 4;
+
+    // Зерно следующей партии среды после конца эпизода
+    uint32_t episodeSeed(uint32_t seed, uint32_t episode) {
+        return seed + episode * 0x9E3779B9u;
+    }
+
+    int scoreMargin(const Game& game, int playerId) {
+        return game.getPlayer(playerId - 1).score - game.getPlayer(2 - playerId).score;
+    }
+}
+
+struct CellEnv {
+    int numEnvs;
+    int size;
+    int maxEpisodeSteps;
+    std::vector<Game> games;
+    std::vector<uint32_t> seeds;
+    std::vector<uint32_t> episodes;
+    std::vector<int> episodeSteps;
+
+    // Аргументы текущего пакета
+    bool resetting;
+    const uint32_t* resetSeeds;
+    const int32_t* actions;
+    uint8_t* observations;
+    uint8_t* captureMasks;
+    float* rewards;
+    uint8_t* dones;
+
+    // Потоки, идущие шаг в шаг
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    uint64_t generation;
+    int busyWorkers;
+    bool stopping;
+    std::atomic<int> nextEnv;
+
+    CellEnv(int envs, int boardSize, int threads, int maxSteps) :
+        numEnvs(envs), size(boardSize), maxEpisodeSteps(maxSteps),
+        seeds(envs, 0), episodes(envs, 0), episodeSteps(envs, 0),
+        resetting(false), resetSeeds(nullptr), actions(nullptr), observations(nullptr),
+        captureMasks(nullptr), rewards(nullptr), dones(nullptr),
+        generation(0), busyWorkers(0), stopping(false), nextEnv(0) {
+        games.reserve(envs);
+        for (int i = 0; i < envs; ++i) {
+            games.emplace_back(boardSize, 0, false);
+            games.back().setParallel(false);
+        }
+        for (int t = 1; t < threads; ++t) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~CellEnv() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    int observationSize() const {
+        return CELL_ENV_PLANES * size * size;
+    }
+
+    int numActions() const {
+        return size * size * (1 + 4 * NUM_ABILITIES) + 1;
+    }
+
+    // Пакет целиком: потоки и вызывающий разбирают среды, пока они не кончатся
+    void runBatch() {
+        nextEnv.store(0);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++generation;
+            busyWorkers = static_cast<int>(workers.size());
+        }
+        wake.notify_all();
+        claimEnvs();
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return busyWorkers == 0; });
+    }
+
+    void workerLoop() {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            claimEnvs();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--busyWorkers == 0) finished.notify_one();
+            }
+        }
+    }
+
+    void claimEnvs() {
+        for (;;) {
+            int begin = nextEnv.fetch_add(ENVS_PER_CLAIM);
+            if (begin >= numEnvs) return;
+            int end = std::min(numEnvs, begin + ENVS_PER_CLAIM);
+            for (int i = begin; i < end; ++i) {
+                if (resetting) {
+                    resetEnv(i);
+                } else {
+                    stepEnv(i);
+                }
+            }
+        }
+    }
+
+    void resetEnv(int i) {
+        seeds[i] = resetSeeds ? resetSeeds[i] : static_cast<uint32_t>(i);
+        episodes[i] = 0;
+        episodeSteps[i] = 0;
+        games[i].reset(seeds[i]);
+        writeObservation(i);
+    }
+
+    // Действие по правилам Game; false - недопустимо, ход уходит пасом
+    bool applyAction(Game& game, int32_t action) {
+        int cells = size * size;
+        if (action >= 0 && action < cells) {
+            if (game.playCapture(action / size, action % size)) return true;
+        } else if (action >= cells && action < numActions() - 1) {
+            int rest = action - cells;
+            int cell = rest % cells;
+            int abilityAndDirection = rest / cells;
+            static const char directions[4] = {'w', 'a', 's', 'd'};
+            if (game.playAbility(abilityAndDirection / 4, cell / size, cell % size,
+                                 directions[abilityAndDirection % 4])) {
+                return true;
+            }
+        } else if (action == numActions() - 1) {
+            game.playPass();
+            return true;
+        }
+        game.playPass();
+        return false;
+    }
+
+    void stepEnv(int i) {
+        Game& game = games[i];
+        int actor = game.getCurrentPlayer() + 1;
+        int marginBefore = scoreMargin(game, actor);
+
+        float reward = applyAction(game, actions[i]) ? 0.0f : ILLEGAL_ACTION_PENALTY;
+        reward += (scoreMargin(game, actor) - marginBefore) * SCORE_REWARD_SCALE;
+
+        bool done = false;
+        if (game.isGameOver()) {
+            reward += game.getWinner() == actor ? 1.0f : -1.0f;
+            done = true;
+        } else if (maxEpisodeSteps > 0 && ++episodeSteps[i] >= maxEpisodeSteps) {
+            done = true;
+        }
+        if (done) {
+            game.reset(episodeSeed(seeds[i], ++episodes[i]));
+            episodeSteps[i] = 0;
+        }
+
+        rewards[i] = reward;
+        dones[i] = done ? 1 : 0;
+        writeObservation(i);
+    }
+
+    void writeObservation(int i) {
+        const Game& game = games[i];
+        int cells = size * size;
+        int me = game.getCurrentPlayer() + 1;
+        uint8_t* planes = observations + static_cast<size_t>(i) * observationSize();
+        uint8_t* mask = captureMasks ? captureMasks + static_cast<size_t>(i) * cells : nullptr;
+
+        for (int x = 0; x < size; ++x) {
+            for (int y = 0; y < size; ++y) {
+                int c = x * size + y;
+                const Cell& cell = game.getCell(x, y);
+                // Туман считается для игрока, чей сейчас ход
+                bool visible = game.isCellVisible(x, y);
+                planes[CELL_ENV_PLANE_OWN * cells + c] = visible && cell.ownerId == me;
+                planes[CELL_ENV_PLANE_ENEMY * cells + c] = visible && cell.ownerId != 0 && cell.ownerId != me;
+                planes[CELL_ENV_PLANE_NEUTRAL * cells + c] = visible && cell.ownerId == 0;
+                planes[CELL_ENV_PLANE_FORTIFIED * cells + c] = visible && cell.isFortified;
+                planes[CELL_ENV_PLANE_SABOTAGE * cells + c] = (visible && cell.sabotageCell) ? cell.sabotageValue : 0;
+                planes[CELL_ENV_PLANE_FOG * cells + c] = !visible;
+                planes[CELL_ENV_PLANE_KING * cells + c] = visible && cell.kingCell;
+                if (mask) mask[c] = game.isCellAvailable(x, y);
+            }
+        }
+    }
+};
+
+extern "C" {
+
+CellEnv* cell_env_create(int num_envs, int board_size, int threads, int max_episode_steps) {
+    if (num_envs <= 0 || !Game::isKnownSize(board_size)) {
+        return nullptr;
+    }
+    if (threads <= 0) threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    threads = std::min(threads, num_envs);
+    return new CellEnv(num_envs, board_size, threads, max_episode_steps);
+}
+
+void cell_env_destroy(CellEnv* env) {
+    delete env;
+}
+
+int cell_env_num_envs(const CellEnv* env) {
+    return env->numEnvs;
+}
+
+int cell_env_board_size(const CellEnv* env) {
+    return env->size;
+}
+
+int cell_env_num_actions(const CellEnv* env) {
+    return env->numActions();
+}
+
+int cell_env_observation_size(const CellEnv* env) {
+    return env->observationSize();
+}
+
+int cell_env_to_play(const CellEnv* env, int i) {
+    return env->games[i].getCurrentPlayer() + 1;
+}
+
+void cell_env_reset(CellEnv* env, const uint32_t* seeds, uint8_t* observations, uint8_t* capture_masks) {
+    env->resetting = true;
+    env->resetSeeds = seeds;
+    env->observations = observations;
+    env->captureMasks = capture_masks;
+    env->runBatch();
+}
+
+void cell_env_step(CellEnv* env, const int32_t* actions, uint8_t* observations, uint8_t* capture_masks,
+                   float* rewards, uint8_t* dones) {
+    env->resetting = false;
+    env->actions = actions;
+    env->observations = observations;
+    env->captureMasks = capture_masks;
+    env->rewards = rewards;
+    env->dones = dones;
+    env->runBatch();
+}
+
+}
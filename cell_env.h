@@ -0,0 +1,69 @@
+#ifndef CELL_ENV_H
+#define CELL_ENV_H
+
+#include <stdint.h>
+
+/* ============= ПАКЕТНАЯ СРЕДА ДЛЯ ОБУЧЕНИЯ =============
+ * C ABI для обучения агентов: B партий идут шаг в шаг на нескольких
+ * потоках, наблюдения пишутся прямо в буферы вызывающего. После сброса
+ * шаг не выделяет память.
+ *
+ * Наблюдение одной среды - CELL_ENV_PLANES плоскостей uint8 по size*size
+ * байт (индекс x * size + y) с точки зрения игрока, чей сейчас ход.
+ * Под туманом заполнена только плоскость FOG.
+ *
+ * Действие - число:
+ *   [0, N)                          захват клетки c, N = size*size
+ *   N + (a * 4 + d) * N + c         способность a (0-6) в клетке c,
+ *                                   направление d: 0-w 1-a 2-s 3-d
+ *   cell_env_num_actions() - 1      пас
+ * Захват и пас передают ход, способность - нет. Недопустимое действие
+ * считается пасом со штрафом.
+ *
+ * Награда - игроку, сделавшему ход: изменение разницы очков / 100,
+ * +1/-1 за победу/поражение. Законченная партия сразу начинается заново
+ * (dones[i] = 1, наблюдение уже из новой партии). */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+    CELL_ENV_PLANE_OWN = 0,
+    CELL_ENV_PLANE_ENEMY = 1,
+    CELL_ENV_PLANE_NEUTRAL = 2,
+    CELL_ENV_PLANE_FORTIFIED = 3,
+    CELL_ENV_PLANE_SABOTAGE = 4, /* Ценность диверсии 2-5, 0 - нет */
+    CELL_ENV_PLANE_FOG = 5,
+    CELL_ENV_PLANE_KING = 6,
+    CELL_ENV_PLANES = 7
+};
+
+typedef struct CellEnv CellEnv;
+
+/* board_size - 16, 32 или 64; threads <= 0 - по числу ядер;
+ * max_episode_steps <= 0 - без ограничения. NULL при недопустимых
+ * параметрах. */
+CellEnv* cell_env_create(int num_envs, int board_size, int threads, int max_episode_steps);
+void cell_env_destroy(CellEnv* env);
+
+int cell_env_num_envs(const CellEnv* env);
+int cell_env_board_size(const CellEnv* env);
+int cell_env_num_actions(const CellEnv* env);
+/* Байт наблюдения одной среды: CELL_ENV_PLANES * size * size */
+int cell_env_observation_size(const CellEnv* env);
+/* Чей ход в среде i: 1 или 2 */
+int cell_env_to_play(const CellEnv* env, int i);
+
+/* observations - num_envs * cell_env_observation_size() байт.
+ * capture_masks (можно NULL) - num_envs * size * size байт: 1, если захват
+ * клетки сейчас допустим. */
+void cell_env_reset(CellEnv* env, const uint32_t* seeds, uint8_t* observations, uint8_t* capture_masks);
+void cell_env_step(CellEnv* env, const int32_t* actions, uint8_t* observations, uint8_t* capture_masks,
+                   float* rewards, uint8_t* dones);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
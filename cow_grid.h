@@ -0,0 +1,278 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ============= ОБЩИЕ ПЛИТКИ С КОПИРОВАНИЕМ ПРИ ЗАПИСИ =============
+// Массив лежит в куче кусками по CHUNK элементов, у каждого куска свой
+// счетчик ссылок. Копия массива не копирует элементы, а берет ссылки на те
+// же куски - O(кусков) указателей. Пока на кусок ссылается больше одного
+// массива, он неизменен: edit() перед записью копирует общий кусок, так что
+// копия партии платит только за куски, которые тронула.
+//
+// Чтение - operator[], запись - только через edit(): обращение на запись
+// делает кусок своим, даже если значение не изменится. Где запись часто
+// ничего не меняет, сначала сравнивают через operator[] (или set()).
+//
+// Счетчики ссылок атомарные: копии могут жить и меняться в разных потоках.
+// Один массив одновременно из нескольких потоков менять можно, только если
+// потоки пишут в разные куски (см. CowGrid и полосы forEachBand()).
+template <typename T, int CHUNK_SHIFT = 8>
+class CowArray {
+public:
+    static constexpr int CHUNK = 1 << CHUNK_SHIFT;
+    static constexpr int CHUNK_MASK = CHUNK - 1;
+
+private:
+    struct Chunk {
+        std::atomic<uint32_t> refs;
+        T values[CHUNK];
+
+        Chunk() : refs(1), values() {}
+        Chunk(const Chunk& other) : refs(1) { std::copy(other.values, other.values + CHUNK, values); }
+    };
+
+    size_t count = 0;
+    std::vector<Chunk*> chunks;
+
+    static void release(Chunk* chunk) {
+        if (chunk->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete chunk;
+    }
+
+    void releaseAll() {
+        for (Chunk* chunk : chunks) release(chunk);
+        chunks.clear();
+    }
+
+    void share(const CowArray& other) {
+        count = other.count;
+        chunks = other.chunks;
+        for (Chunk* chunk : chunks) chunk->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Свой кусок под запись: общий сначала копируем
+    Chunk* own(size_t c) {
+        Chunk* chunk = chunks[c];
+        if (chunk->refs.load(std::memory_order_acquire) != 1) {
+            Chunk* copy = new Chunk(*chunk);
+            release(chunk);
+            chunks[c] = chunk = copy;
+        }
+        return chunk;
+    }
+
+public:
+    CowArray() = default;
+    CowArray(const CowArray& other) { share(other); }
+
+    CowArray& operator=(const CowArray& other) {
+        if (this != &other) {
+            releaseAll();
+            share(other);
+        }
+        return *this;
+    }
+
+    ~CowArray() { releaseAll(); }
+
+    // n элементов, равных value. Свои куски переиспользуются (без выделения
+    // памяти), общие заменяются новыми без копирования старого содержимого
+    void assign(size_t n, const T& value) {
+        size_t needed = (n + CHUNK_MASK) >> CHUNK_SHIFT;
+        if (needed != chunks.size()) {
+            releaseAll();
+            chunks.resize(needed);
+            for (Chunk*& chunk : chunks) chunk = new Chunk();
+        }
+        count = n;
+        for (Chunk*& chunk : chunks) {
+            if (chunk->refs.load(std::memory_order_acquire) != 1) {
+                release(chunk);
+                chunk = new Chunk();
+            }
+            std::fill(chunk->values, chunk->values + CHUNK, value);
+        }
+    }
+
+    void clear() {
+        releaseAll();
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    const T& operator[](size_t i) const { return chunks[i >> CHUNK_SHIFT]->values[i & CHUNK_MASK]; }
+
+    T& edit(size_t i) { return own(i >> CHUNK_SHIFT)->values[i & CHUNK_MASK]; }
+
+    // Запись, которая не трогает кусок, если значение то же
+    void set(size_t i, const T& value) {
+        if (!((*this)[i] == value)) edit(i) = value;
+    }
+
+    // Все куски своими: дальше массив ни с кем не делит память
+    void detach() {
+        for (size_t c = 0; c < chunks.size(); ++c) own(c);
+    }
+
+    // Для замеров: кусков всего, из них общих с другими массивами, и
+    // память под один кусок
+    size_t chunkCount() const { return chunks.size(); }
+
+    size_t sharedChunks() const {
+        size_t shared = 0;
+        for (const Chunk* chunk : chunks) shared += chunk->refs.load(std::memory_order_relaxed) != 1;
+        return shared;
+    }
+
+    static constexpr size_t chunkBytes() { return sizeof(Chunk); }
+};
+
+// Квадратное поле size x size на плитках-полосах по TILE_ROWS строк во всю
+// ширину поля. Копия поля берет ссылки на плитки, запись копирует только
+// тронутую плитку. Для каждой строки хранится указатель на ее начало в
+// плитке, поэтому чтение клетки стоит столько же, сколько в
+// std::vector<std::vector<T>>: указатель строки и индекс в ней.
+//
+// Высота плитки делит высоту полосы forEachBand() (см. game.h): полоса
+// пишет только в свои строки, значит и в свои плитки, и копия общей плитки
+// вместе с указателями ее строк внутри прохода по полосам делается одним
+// потоком.
+template <typename T>
+class CowGrid {
+public:
+    static constexpr int TILE_SHIFT = 3;
+    static constexpr int TILE_ROWS = 1 << TILE_SHIFT;
+
+private:
+    struct Tile {
+        std::atomic<uint32_t> refs;
+        std::vector<T> cells;
+
+        Tile(size_t count, const T& value) : refs(1), cells(count, value) {}
+        Tile(const Tile& other) : refs(1), cells(other.cells) {}
+    };
+
+    int size = 0;
+    std::vector<Tile*> tiles;
+    std::vector<T*> rows;  // Начало строки x в ее плитке
+
+    static void release(Tile* tile) {
+        if (tile->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete tile;
+    }
+
+    void releaseAll() {
+        for (Tile* tile : tiles) release(tile);
+        tiles.clear();
+        rows.clear();
+    }
+
+    void share(const CowGrid& other) {
+        size = other.size;
+        tiles = other.tiles;
+        rows = other.rows;
+        for (Tile* tile : tiles) tile->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void pointRows(int t) {
+        T* base = tiles[t]->cells.data();
+        int from = t << TILE_SHIFT;
+        int to = std::min(size, from + TILE_ROWS);
+        for (int x = from; x < to; ++x) rows[x] = base + static_cast<size_t>(x - from) * size;
+    }
+
+    // Общую плитку t копируем в свою
+    void own(int t) {
+        Tile* copy = new Tile(*tiles[t]);
+        release(tiles[t]);
+        tiles[t] = copy;
+        pointRows(t);
+    }
+
+public:
+    CowGrid() = default;
+    CowGrid(const CowGrid& other) { share(other); }
+
+    CowGrid& operator=(const CowGrid& other) {
+        if (this != &other) {
+            releaseAll();
+            share(other);
+        }
+        return *this;
+    }
+
+    ~CowGrid() { releaseAll(); }
+
+    // Поле n x n, все клетки - value. Свои плитки того же размера
+    // переиспользуются без выделения памяти, общие заменяются новыми.
+    void reset(int n, const T& value) {
+        size_t tileCells = static_cast<size_t>(TILE_ROWS) * n;
+        size_t needed = static_cast<size_t>((n + TILE_ROWS - 1) >> TILE_SHIFT);
+        if (n != size || needed != tiles.size()) {
+            releaseAll();
+            for (size_t t = 0; t < needed; ++t) tiles.push_back(new Tile(tileCells, value));
+        } else {
+            for (Tile*& tile : tiles) {
+                if (tile->refs.load(std::memory_order_acquire) != 1) {
+                    release(tile);
+                    tile = new Tile(tileCells, value);
+                } else {
+                    std::fill(tile->cells.begin(), tile->cells.end(), value);
+                }
+            }
+        }
+        size = n;
+        rows.resize(n);
+        for (int t = 0; t < static_cast<int>(tiles.size()); ++t) pointRows(t);
+    }
+
+    void clear() {
+        releaseAll();
+        size = 0;
+    }
+
+    int getSize() const { return size; }
+
+    const T& at(int x, int y) const { return rows[x][y]; }
+
+    T& edit(int x, int y) { return editRow(x)[y]; }
+
+    // Строка x целиком под запись
+    T* editRow(int x) {
+        int t = x >> TILE_SHIFT;
+        if (tiles[t]->refs.load(std::memory_order_acquire) != 1) own(t);
+        return rows[x];
+    }
+
+    void detach() {
+        for (int t = 0; t < static_cast<int>(tiles.size()); ++t) {
+            if (tiles[t]->refs.load(std::memory_order_acquire) != 1) own(t);
+        }
+    }
+
+    // Для замеров: плиток всего, из них общих с другими полями, и память
+    // под одну плитку
+    size_t tileCount() const { return tiles.size(); }
+
+    size_t sharedTiles() const {
+        size_t shared = 0;
+        for (const Tile* tile : tiles) shared += tile->refs.load(std::memory_order_relaxed) != 1;
+        return shared;
+    }
+
+    size_t tileBytes() const { return sizeof(Tile) + sizeof(T) * TILE_ROWS * size; }
+};
+
+// Рабочий буфер: копия объекта получает пустой буфер, а не копию чужого.
+// Содержимое между вызовами не нужно, размер задается при использовании.
+template <typename T>
+class WorkBuffer : public std::vector<T> {
+public:
+    WorkBuffer() = default;
+    WorkBuffer(const WorkBuffer&) : std::vector<T>() {}
+    WorkBuffer& operator=(const WorkBuffer&) { return *this; }
+};
@@ -0,0 +1,510 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "game.h"
+#include "lz.h"
+
+// ============= НАБОР ПОЗИЦИЙ ДЛЯ ОБУЧЕНИЯ =============
+// Позиции самоигры пишутся в шарды по POSITIONS_PER_SHARD позиций. Шард
+// описывает себя сам: заголовок с размером поля и параметрами, блоки, в
+// конце - индекс блоков и хвост со ссылкой на индекс.
+//
+// Блок - BLOCK_POSITIONS подряд идущих позиций, сжатых lz.h независимо от
+// соседних блоков, поэтому позиция k читается за O(1): индекс дает блок
+// k / BLOCK_POSITIONS, распаковывается только он.
+//
+// Запись позиции внутри блока (числа - varint, знаковые - zigzag):
+//   u8 флаги (KEY - владельцы целиком, иначе XOR с прошлой позицией партии;
+//   COMMANDER1/2 - у игрока активен Командир, старые шарды читаются без них),
+//   varint game, varint ply, u8 toMove, u8 result (победитель, 0 - нет),
+//   zigzag очки x2, владельцы по 2 бита на клетку ((N + 3) / 4 байт),
+//   списки клеток: укрепления, диверсии (с ценностью), короли - число и
+//   разности индексов x * size + y.
+// Первая позиция блока и первая позиция партии всегда KEY.
+//
+// Файл: [Header 32 байта][блоки][индекс: по u64 offset, u32 packed,
+// u32 raw на блок][Trailer 24 байта]
+namespace Dataset {
+    const uint32_t SHARD_MAGIC = 0x53445743;   // "CWDS"
+    const uint32_t TRAILER_MAGIC = 0x58445743; // "CWDX"
+    const uint32_t VERSION = 1;
+    const uint32_t CODEC_LZ = 1;
+    const int HEADER_SIZE = 32;
+    const int TRAILER_SIZE = 24;
+    const int INDEX_ENTRY_SIZE = 16;
+    const uint32_t BLOCK_POSITIONS = 64;
+    const uint32_t POSITIONS_PER_SHARD = 1 << 16;
+
+    const uint8_t RECORD_KEY = 1 << 0;
+    const uint8_t RECORD_COMMANDER1 = 1 << 1;
+    const uint8_t RECORD_COMMANDER2 = 1 << 2;
+
+    // Позиция в разобранном виде
+    struct Position {
+        int size = 0;
+        uint32_t gameId = 0;
+        uint32_t ply = 0;
+        uint8_t toMove = 0;            // 1-2
+        uint8_t result = 0;            // Победитель партии, 0 - не доиграна
+        int32_t scores[2] = {0, 0};
+        bool commanders[2] = {false, false}; // Активен ли Командир игрока
+        std::vector<uint8_t> owners;   // По клетке, индекс x * size + y
+        std::vector<uint32_t> fortified;
+        std::vector<uint32_t> sabotage;
+        std::vector<uint8_t> sabotageValues;
+        std::vector<uint32_t> kings;
+
+        // Снимок позиции партии; результат проставляется в конце партии
+        void capture(const Game& game, uint32_t id, uint32_t plyNumber) {
+            size = game.getSize();
+            gameId = id;
+            ply = plyNumber;
+            toMove = static_cast<uint8_t>(game.getCurrentPlayer() + 1);
+            result = 0;
+            scores[0] = game.getPlayer(0).score;
+            scores[1] = game.getPlayer(1).score;
+            commanders[0] = game.getPlayer(0).commanderActive;
+            commanders[1] = game.getPlayer(1).commanderActive;
+            owners.resize(size * size);
+            fortified.clear();
+            sabotage.clear();
+            sabotageValues.clear();
+            kings.clear();
+            for (int x = 0; x < size; ++x) {
+                for (int y = 0; y < size; ++y) {
+                    const Cell& cell = game.getCell(x, y);
+                    uint32_t i = static_cast<uint32_t>(x * size + y);
+                    owners[i] = cell.ownerId;
+                    if (cell.isFortified) fortified.push_back(i);
+                    if (cell.sabotageCell) {
+                        sabotage.push_back(i);
+                        sabotageValues.push_back(cell.sabotageValue);
+                    }
+                    if (cell.kingCell) kings.push_back(i);
+                }
+            }
+        }
+    };
+
+    // ============= БАЙТЫ =============
+    inline void putVarint(std::vector<uint8_t>& out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back(static_cast<uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(v));
+    }
+
+    inline void putLe(std::vector<uint8_t>& out, uint64_t v, int bytes) {
+        for (int i = 0; i < bytes; ++i) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    inline uint64_t getLe(const uint8_t* p, int bytes) {
+        uint64_t v = 0;
+        for (int i = 0; i < bytes; ++i) v |= static_cast<uint64_t>(p[i]) << (8 * i);
+        return v;
+    }
+
+    inline uint64_t zigzag(int64_t v) {
+        return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    }
+
+    inline int64_t unzigzag(uint64_t v) {
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+
+    class Input {
+    private:
+        const uint8_t* p;
+        const uint8_t* end;
+        bool valid;
+
+    public:
+        Input(const uint8_t* data, size_t n) : p(data), end(data + n), valid(true) {}
+
+        bool ok() const { return valid; }
+
+        uint8_t u8() {
+            if (p >= end) { valid = false; return 0; }
+            return *p++;
+        }
+
+        uint64_t varint() {
+            uint64_t v = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                uint8_t b = u8();
+                v |= static_cast<uint64_t>(b & 0x7F) << shift;
+                if (!(b & 0x80)) return v;
+            }
+            valid = false;
+            return 0;
+        }
+
+        const uint8_t* bytes(size_t n) {
+            if (static_cast<size_t>(end - p) < n) { valid = false; return nullptr; }
+            const uint8_t* r = p;
+            p += n;
+            return r;
+        }
+    };
+
+    // ============= КОДИРОВАНИЕ ЗАПИСИ =============
+    inline void putCellList(std::vector<uint8_t>& out, const std::vector<uint32_t>& cells) {
+        putVarint(out, cells.size());
+        uint32_t previous = 0;
+        for (uint32_t c : cells) {
+            putVarint(out, c - previous);
+            previous = c;
+        }
+    }
+
+    inline bool getCellList(Input& in, std::vector<uint32_t>& cells, uint32_t limit) {
+        uint64_t count = in.varint();
+        if (!in.ok() || count > limit) return false;
+        cells.resize(count);
+        uint32_t previous = 0;
+        for (auto& c : cells) {
+            c = previous + static_cast<uint32_t>(in.varint());
+            if (c >= limit) return false;
+            previous = c;
+        }
+        return in.ok();
+    }
+
+    // previous - владельцы прошлой позиции той же партии или nullptr
+    inline void encodeRecord(const Position& p, const std::vector<uint8_t>* previous, std::vector<uint8_t>& out) {
+        int cells = p.size * p.size;
+        out.push_back(static_cast<uint8_t>((previous ? 0 : RECORD_KEY) | (p.commanders[0] ? RECORD_COMMANDER1 : 0) |
+                                           (p.commanders[1] ? RECORD_COMMANDER2 : 0)));
+        putVarint(out, p.gameId);
+        putVarint(out, p.ply);
+        out.push_back(p.toMove);
+        out.push_back(p.result);
+        putVarint(out, zigzag(p.scores[0]));
+        putVarint(out, zigzag(p.scores[1]));
+
+        // Между соседними позициями меняется несколько клеток, так что XOR
+        // почти весь из нулей, и их съедает LZ
+        size_t start = out.size();
+        out.resize(start + (cells + 3) / 4, 0);
+        for (int i = 0; i < cells; ++i) {
+            uint8_t owner = p.owners[i];
+            if (previous) owner ^= (*previous)[i];
+            out[start + i / 4] |= static_cast<uint8_t>((owner & 3) << (2 * (i % 4)));
+        }
+
+        putCellList(out, p.fortified);
+        putCellList(out, p.sabotage);
+        out.insert(out.end(), p.sabotageValues.begin(), p.sabotageValues.end());
+        putCellList(out, p.kings);
+    }
+
+    // Запись разбирается поверх p: для не-KEY записи в p.owners должны
+    // лежать владельцы прошлой позиции
+    inline bool decodeRecord(Input& in, int size, Position& p) {
+        int cells = size * size;
+        uint8_t flags = in.u8();
+        bool key = (flags & RECORD_KEY) != 0;
+        if (!key && static_cast<int>(p.owners.size()) != cells) return false;
+        p.size = size;
+        p.gameId = static_cast<uint32_t>(in.varint());
+        p.ply = static_cast<uint32_t>(in.varint());
+        p.toMove = in.u8();
+        p.result = in.u8();
+        p.scores[0] = static_cast<int32_t>(unzigzag(in.varint()));
+        p.scores[1] = static_cast<int32_t>(unzigzag(in.varint()));
+        p.commanders[0] = (flags & RECORD_COMMANDER1) != 0;
+        p.commanders[1] = (flags & RECORD_COMMANDER2) != 0;
+
+        const uint8_t* packed = in.bytes((cells + 3) / 4);
+        if (!packed) return false;
+        if (key) p.owners.assign(cells, 0);
+        for (int i = 0; i < cells; ++i) {
+            p.owners[i] ^= (packed[i / 4] >> (2 * (i % 4))) & 3;
+        }
+
+        uint32_t limit = static_cast<uint32_t>(cells);
+        if (!getCellList(in, p.fortified, limit) || !getCellList(in, p.sabotage, limit)) return false;
+        const uint8_t* values = in.bytes(p.sabotage.size());
+        if (!values) return false;
+        p.sabotageValues.assign(values, values + p.sabotage.size());
+        return getCellList(in, p.kings, limit);
+    }
+
+    // ============= ЗАПИСЬ =============
+    // Позиции приходят партиями: addPosition() копит позиции партии,
+    // endGame() проставляет им результат и отправляет в шард.
+    class Writer {
+    private:
+        std::string prefix;
+        int size;
+        std::ofstream file;
+        int shardNumber;
+        uint32_t shardPositions;
+        uint64_t fileOffset;
+        std::vector<uint8_t> index;
+
+        std::vector<Position> pendingGame;
+
+        std::vector<uint8_t> blockRaw;
+        std::vector<uint8_t> blockPacked;
+        uint32_t blockPositions;
+        const std::vector<uint8_t>* previousOwners; // Владельцы прошлой позиции в блоке
+        uint32_t previousGame;
+        std::vector<uint8_t> lastOwners;
+
+        uint64_t totalPositions;
+        uint64_t totalBytes;
+        bool failed;                  // Шард не открылся или не записался: дальше ничего не пишется
+
+        std::string shardPath(int number) const {
+            char suffix[32];
+            std::snprintf(suffix, sizeof(suffix), "-%05d.cwds", number);
+            return prefix + suffix;
+        }
+
+        void writeBytes(const std::vector<uint8_t>& bytes) {
+            file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+            fileOffset += bytes.size();
+            totalBytes += bytes.size();
+        }
+
+        bool openShard() {
+            file.open(shardPath(shardNumber), std::ios::binary | std::ios::trunc);
+            if (!file) return false;
+            fileOffset = 0;
+            shardPositions = 0;
+            index.clear();
+            std::vector<uint8_t> header;
+            putLe(header, SHARD_MAGIC, 4);
+            putLe(header, VERSION, 4);
+            putLe(header, static_cast<uint32_t>(size), 4);
+            putLe(header, BLOCK_POSITIONS, 4);
+            putLe(header, POSITIONS_PER_SHARD, 4);
+            putLe(header, CODEC_LZ, 4);
+            putLe(header, 0, 8);
+            writeBytes(header);
+            return true;
+        }
+
+        void resetBlock() {
+            blockRaw.clear();
+            blockPositions = 0;
+            previousOwners = nullptr;
+        }
+
+        // Ошибка записи запоминается один раз: блок сбрасывается, а
+        // следующие позиции не копятся без толку
+        void fail() {
+            if (!failed) std::fprintf(stderr, "Не удалось записать шард %s\n", shardPath(shardNumber).c_str());
+            failed = true;
+            resetBlock();
+            if (file.is_open()) file.close();
+        }
+
+        void flushBlock() {
+            if (blockPositions == 0) return;
+            if (!file.is_open() && !openShard()) {
+                fail();
+                return;
+            }
+            blockPacked.clear();
+            Lz::compress(blockRaw.data(), blockRaw.size(), blockPacked);
+            putLe(index, fileOffset, 8);
+            putLe(index, blockPacked.size(), 4);
+            putLe(index, blockRaw.size(), 4);
+            writeBytes(blockPacked);
+            if (!file) {
+                fail();
+                return;
+            }
+            shardPositions += blockPositions;
+            resetBlock();
+            if (shardPositions >= POSITIONS_PER_SHARD) closeShard();
+        }
+
+        void closeShard() {
+            if (!file.is_open()) return;
+            uint64_t indexOffset = fileOffset;
+            writeBytes(index);
+            std::vector<uint8_t> trailer;
+            putLe(trailer, indexOffset, 8);
+            putLe(trailer, index.size() / INDEX_ENTRY_SIZE, 4);
+            putLe(trailer, shardPositions, 4);
+            putLe(trailer, 0, 4);
+            putLe(trailer, TRAILER_MAGIC, 4);
+            writeBytes(trailer);
+            if (!file) {
+                fail();
+                return;
+            }
+            file.close();
+            ++shardNumber;
+        }
+
+        void append(const Position& p) {
+            if (failed) return;
+            // Дельта только внутри блока и внутри партии
+            bool delta = previousOwners && previousGame == p.gameId;
+            encodeRecord(p, delta ? previousOwners : nullptr, blockRaw);
+            lastOwners = p.owners;
+            previousOwners = &lastOwners;
+            previousGame = p.gameId;
+            ++totalPositions;
+            if (++blockPositions == BLOCK_POSITIONS) flushBlock();
+        }
+
+    public:
+        // Шарды называются prefix-00000.cwds, prefix-00001.cwds, ...
+        Writer(const std::string& pathPrefix, int boardSize) :
+            prefix(pathPrefix), size(boardSize), shardNumber(0), shardPositions(0), fileOffset(0),
+            blockPositions(0), previousOwners(nullptr), previousGame(0),
+            totalPositions(0), totalBytes(0), failed(false) {}
+
+        ~Writer() { close(); }
+
+        // gameId выбирает вызывающий; позиции одной партии идут подряд.
+        // Запись - на двоих игроков, позиции других партий не пишутся
+        void addPosition(const Game& game, uint32_t gameId, uint32_t ply) {
+            if (failed || game.getSize() != size || game.getPlayerCount() != 2) return;
+            pendingGame.emplace_back();
+            pendingGame.back().capture(game, gameId, ply);
+        }
+
+        // result - победитель, 0 - партия не доиграна
+        void endGame(int result) {
+            for (Position& p : pendingGame) {
+                p.result = static_cast<uint8_t>(result);
+                append(p);
+            }
+            pendingGame.clear();
+        }
+
+        // Готовые позиции одной партии (например, собранные другим потоком)
+        void writeGame(std::vector<Position>& positions, int result) {
+            pendingGame.swap(positions);
+            endGame(result);
+        }
+
+        void close() {
+            flushBlock();
+            closeShard();
+        }
+
+        // false - шард не записался (ошибка уже напечатана в stderr)
+        bool ok() const { return !failed; }
+        uint64_t positions() const { return totalPositions; }
+        uint64_t bytesWritten() const { return totalBytes; }
+        int shards() const { return shardNumber + (file.is_open() ? 1 : 0); }
+    };
+
+    // ============= ЧТЕНИЕ =============
+    class ShardReader {
+    private:
+        std::ifstream file;
+        int size;
+        uint32_t blockPositions;
+        uint32_t positions;
+        std::vector<uint8_t> index;
+        uint64_t indexOffset;           // Блоки лежат до индекса
+
+        // Последний распакованный блок: последовательное чтение не
+        // распаковывает его заново
+        int64_t cachedBlock;
+        std::vector<uint8_t> packed;
+        std::vector<uint8_t> raw;
+        std::vector<Position> decoded;
+
+        bool loadBlock(uint32_t block) {
+            if (cachedBlock == block) return true;
+            cachedBlock = -1;
+            const uint8_t* entry = index.data() + static_cast<size_t>(block) * INDEX_ENTRY_SIZE;
+            uint64_t offset = getLe(entry, 8);
+            size_t packedSize = getLe(entry + 8, 4);
+            size_t rawSize = getLe(entry + 12, 4);
+            packed.resize(packedSize);
+            raw.resize(rawSize);
+            file.seekg(static_cast<std::streamoff>(offset));
+            file.read(reinterpret_cast<char*>(packed.data()), static_cast<std::streamsize>(packedSize));
+            if (!file || !Lz::decompress(packed.data(), packedSize, raw.data(), rawSize)) return false;
+
+            uint32_t first = block * blockPositions;
+            uint32_t count = std::min(blockPositions, positions - first);
+            decoded.resize(count);
+            Input in(raw.data(), raw.size());
+            for (uint32_t i = 0; i < count; ++i) {
+                if (i > 0) decoded[i].owners = decoded[i - 1].owners;
+                if (!decodeRecord(in, size, decoded[i])) return false;
+            }
+            cachedBlock = block;
+            return true;
+        }
+
+    public:
+        ShardReader() : size(0), blockPositions(0), positions(0), indexOffset(0), cachedBlock(-1) {}
+
+        bool open(const std::string& path) {
+            file.open(path, std::ios::binary);
+            if (!file) return false;
+            uint8_t header[HEADER_SIZE];
+            uint8_t trailer[TRAILER_SIZE];
+            file.read(reinterpret_cast<char*>(header), HEADER_SIZE);
+            file.seekg(0, std::ios::end);
+            uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+            if (!file || fileSize < static_cast<uint64_t>(HEADER_SIZE + TRAILER_SIZE)) return false;
+            file.seekg(-TRAILER_SIZE, std::ios::end);
+            file.read(reinterpret_cast<char*>(trailer), TRAILER_SIZE);
+            if (!file || getLe(header, 4) != SHARD_MAGIC || getLe(header + 4, 4) != VERSION ||
+                getLe(header + 20, 4) != CODEC_LZ || getLe(trailer + 20, 4) != TRAILER_MAGIC) {
+                return false;
+            }
+            size = static_cast<int>(getLe(header + 8, 4));
+            blockPositions = static_cast<uint32_t>(getLe(header + 12, 4));
+            indexOffset = getLe(trailer, 8);
+            uint32_t blocks = static_cast<uint32_t>(getLe(trailer + 8, 4));
+            positions = static_cast<uint32_t>(getLe(trailer + 12, 4));
+            // Подвал не проверен ничем, кроме магии: смещения и счетчики
+            // сверяются с размером файла до того, как по ним что-то читать
+            uint64_t indexEnd = fileSize - TRAILER_SIZE;
+            if (!Game::isKnownSize(size) || blockPositions == 0 ||
+                static_cast<uint64_t>(blocks) * blockPositions < positions ||
+                indexOffset < static_cast<uint64_t>(HEADER_SIZE) || indexOffset > indexEnd ||
+                static_cast<uint64_t>(blocks) * INDEX_ENTRY_SIZE != indexEnd - indexOffset) {
+                return false;
+            }
+
+            index.resize(static_cast<size_t>(blocks) * INDEX_ENTRY_SIZE);
+            file.seekg(static_cast<std::streamoff>(indexOffset));
+            file.read(reinterpret_cast<char*>(index.data()), static_cast<std::streamsize>(index.size()));
+            if (!file) return false;
+            for (uint32_t b = 0; b < blocks; ++b) {
+                const uint8_t* entry = index.data() + static_cast<size_t>(b) * INDEX_ENTRY_SIZE;
+                uint64_t offset = getLe(entry, 8);
+                uint64_t packedSize = getLe(entry + 8, 4);
+                uint64_t rawSize = getLe(entry + 12, 4);
+                // Байт потока LZ разворачивается не больше чем в 255 байт
+                if (offset < static_cast<uint64_t>(HEADER_SIZE) || offset > indexOffset ||
+                    packedSize > indexOffset - offset || rawSize > packedSize * 255) {
+                    return false;
+                }
+            }
+            cachedBlock = -1;
+            return true;
+        }
+
+        int boardSize() const { return size; }
+        uint32_t positionCount() const { return positions; }
+
+        // Позиция k шарда: распаковывается один блок
+        bool read(uint32_t k, Position& out) {
+            if (k >= positions || !loadBlock(k / blockPositions)) return false;
+            out = decoded[k % blockPositions];
+            return true;
+        }
+    };
+}
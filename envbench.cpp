@@ -0,0 +1,86 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "alloc_hook.h"
+#include "cell_env.h"
+
+// ============= ЗАМЕР ПАКЕТНОЙ СРЕДЫ =============
+// Гоняет libcellenv.so случайными допустимыми захватами и печатает шаги
+// сред в секунду. Заодно считает выделения памяти во время шагов: после
+// сброса их должно быть 0.
+//
+//   g++ -std=c++17 -O2 -pthread -fPIC -shared -o libcellenv.so cell_env.cpp
+//   g++ -std=c++17 -O2 -pthread -o envbench envbench.cpp -L. -lcellenv -Wl,-rpath,.
+//   ./envbench --envs 256 --size 16 --threads 4 --steps 2000
+
+int main(int argc, char** argv) {
+    int envs = 256, size = 16, threads = 0, steps = 2000, maxEpisodeSteps = 500;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        int value = std::atoi(argv[i + 1]);
+        if (arg == "--envs") envs = value;
+        else if (arg == "--size") size = value;
+        else if (arg == "--threads") threads = value;
+        else if (arg == "--steps") steps = value;
+        else if (arg == "--max-episode-steps") maxEpisodeSteps = value;
+        else {
+            std::fprintf(stderr, "Использование: %s [--envs N] [--size N] [--threads N] [--steps N] "
+                                 "[--max-episode-steps N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    CellEnv* env = cell_env_create(envs, size, threads, maxEpisodeSteps);
+    if (!env) {
+        std::fprintf(stderr, "Недопустимые параметры среды\n");
+        return 1;
+    }
+    int cells = size * size;
+    int passAction = cell_env_num_actions(env) - 1;
+
+    std::vector<uint32_t> seeds(envs);
+    for (int i = 0; i < envs; ++i) seeds[i] = static_cast<uint32_t>(i + 1);
+    std::vector<uint8_t> observations(static_cast<size_t>(envs) * cell_env_observation_size(env));
+    std::vector<uint8_t> masks(static_cast<size_t>(envs) * cells);
+    std::vector<int32_t> actions(envs);
+    std::vector<float> rewards(envs);
+    std::vector<uint8_t> dones(envs);
+    std::mt19937 rng(12345);
+
+    cell_env_reset(env, seeds.data(), observations.data(), masks.data());
+
+    unsigned long long episodes = 0;
+    double stepSeconds = 0;
+    for (int s = 0; s < steps; ++s) {
+        // Случайный допустимый захват, пас - если захватывать нечего
+        for (int i = 0; i < envs; ++i) {
+            const uint8_t* mask = masks.data() + static_cast<size_t>(i) * cells;
+            int chosen = passAction;
+            int seen = 0;
+            for (int c = 0; c < cells; ++c) {
+                if (mask[c] && rng() % ++seen == 0) chosen = c;
+            }
+            actions[i] = chosen;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        AllocHook::counting = true;
+        cell_env_step(env, actions.data(), observations.data(), masks.data(), rewards.data(), dones.data());
+        AllocHook::counting = false;
+        stepSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        for (int i = 0; i < envs; ++i) episodes += dones[i];
+    }
+
+    unsigned long long envSteps = static_cast<unsigned long long>(envs) * steps;
+    std::printf("Сред: %d, поле %dx%d, шагов пакета: %d, эпизодов: %llu\n", envs, size, size, steps, episodes);
+    std::printf("%.0f шагов сред/с (%.2f мкс на шаг пакета)\n", envSteps / stepSeconds, stepSeconds / steps * 1e6);
+    std::printf("Выделений памяти во время шагов: %llu\n", AllocHook::allocations.load());
+
+    cell_env_destroy(env);
+    return 0;
+}
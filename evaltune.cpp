@@ -0,0 +1,420 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "bot.h"
+#include "dataset.h"
+#include "king_threat.h"
+#include "thread_pool.h"
+
+// ============= ПОДБОР ВЕСОВ ОЦЕНКИ =============
+// Подбирает веса Bot::Weights по шардам самоигры (dataset.h): логистическая
+// регрессия вероятности победы игрока 1 по разностям признаков Bot::Feature
+// игроков 1 и 2. Признаки считаются по разобранной позиции так же, как
+// Bot::features() считает их по партии.
+//
+// Цель позиции - итог партии (1 или 0). Недоигранная партия (а жадная
+// самоигра до короля не доходит) судится по своей последней позиции в
+// шардах: больше очков, при равенстве - территории; ничья - 0.5.
+// Каждая десятая партия откладывается для проверки.
+//
+// Шарды читаются параллельно на пуле потоков. Признаки лежат по столбцам
+// (столбец на признак, обучающие позиции впереди), столбцы приведены к
+// единичному среднему квадрату. Спуск полный по выборке (Adam): эпоха - один
+// проход блоками по BLOCK позиций на всех потоках, логит блока и градиент
+// считаются SIMD-ядрами axpy и dot. Суммы блоков складываются по порядку,
+// так что веса не зависят от числа потоков.
+//
+//   ./selfplay --games 1000 --size 16 --greedy --out data/selfplay
+//   ./evaltune --out eval16.weights data/selfplay-*.cwds
+//   ./selfplay --games 100 --size 16 --greedy --eval eval16.weights
+
+namespace {
+    const int FEATURES = Bot::FEATURES;
+    const int BLOCK = 4096;
+
+    struct Options {
+        std::string out = "eval.weights";
+        std::vector<std::string> shards;
+        int epochs = 200;
+        float rate = 0.05f;
+    };
+
+    // Позиции одного шарда: признаки игрока 1 минус игрока 2 по строкам
+    struct ShardRows {
+        std::vector<float> rows;       // FEATURES на позицию
+        std::vector<uint32_t> games;
+        std::vector<uint32_t> plies;
+        std::vector<uint8_t> results;
+        std::vector<int32_t> verdicts; // Разница очков, иначе территорий - для суда
+        bool ok = true;
+        int size = 0;
+    };
+
+    // Итог партии для цели: последняя позиция и победитель, если есть
+    struct GameEnd {
+        uint32_t ply = 0;
+        int32_t verdict = 0;
+        uint8_t result = 0;
+        bool seen = false;
+    };
+
+    // Рабочие буферы разбора позиций одного потока. Позиции шарда идут по
+    // партиям подряд, поэтому поля расстояний до королей не строятся
+    // заново, а чинятся по клеткам, изменившимся с прошлой позиции партии.
+    struct Scratch {
+        KingThreat threats;
+        std::vector<uint8_t> fortified, king;
+        std::vector<uint8_t> previousOwners, previousFortified;
+        uint32_t game = UINT32_MAX;
+    };
+
+    namespace Simd {
+        // y += a * x
+        inline void axpy(float a, const float* x, float* y, int n) {
+            int i = 0;
+#if defined(__AVX2__)
+            __m256 va = _mm256_set1_ps(a);
+            for (; i + 8 <= n; i += 8) {
+                __m256 vy = _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(va, _mm256_loadu_ps(x + i)));
+                _mm256_storeu_ps(y + i, vy);
+            }
+#elif defined(__SSE2__)
+            __m128 va = _mm_set1_ps(a);
+            for (; i + 4 <= n; i += 4) {
+                __m128 vy = _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(va, _mm_loadu_ps(x + i)));
+                _mm_storeu_ps(y + i, vy);
+            }
+#endif
+            for (; i < n; ++i) y[i] += a * x[i];
+        }
+
+        inline float dot(const float* a, const float* b, int n) {
+            float sum = 0;
+            int i = 0;
+#if defined(__AVX2__)
+            __m256 acc = _mm256_setzero_ps();
+            for (; i + 8 <= n; i += 8) acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+            __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+            half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+            half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 0x55));
+            sum = _mm_cvtss_f32(half);
+#elif defined(__SSE2__)
+            __m128 acc = _mm_setzero_ps();
+            for (; i + 4 <= n; i += 4) acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+            acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 0x55));
+            sum = _mm_cvtss_f32(acc);
+#endif
+            for (; i < n; ++i) sum += a[i] * b[i];
+            return sum;
+        }
+    }
+
+    // Признаки Bot::features() обоих игроков по разобранной позиции
+    void positionFeatures(const Dataset::Position& p, Scratch& scratch, float out[2][FEATURES]) {
+        int size = p.size;
+        int cells = size * size;
+        std::vector<uint8_t>& fortified = scratch.fortified;
+        std::vector<uint8_t>& king = scratch.king;
+        fortified.assign(cells, 0);
+        king.assign(cells, 0);
+        for (uint32_t i : p.fortified) fortified[i] = 1;
+        for (uint32_t i : p.kings) king[i] = 1;
+
+        // Короли вдвоем - в противоположных углах (Game::placeKings()), даже
+        // если клетку короля уже взяли
+        KingThreat& threats = scratch.threats;
+        bool follows = scratch.game == p.gameId && static_cast<int>(scratch.previousOwners.size()) == cells;
+        if (!follows) {
+            int kingsX[2] = {0, size - 1}, kingsY[2] = {0, size - 1};
+            threats.reset(size, 2, kingsX, kingsY);
+        }
+
+        int territory[2] = {0, 0}, frontier[2] = {0, 0}, forts[2] = {0, 0};
+        for (int i = 0; i < cells; ++i) {
+            int x = i / size, y = i % size;
+            int owner = p.owners[i];
+            if (!follows) {
+                threats.setInitial(x, y, owner, fortified[i] != 0);
+            } else if (owner != scratch.previousOwners[i] || fortified[i] != scratch.previousFortified[i]) {
+                threats.cellChanged(x, y, owner, fortified[i] != 0);
+            }
+            if (owner != 1 && owner != 2) continue;
+            territory[owner - 1]++;
+            forts[owner - 1] += fortified[i];
+            if ((x > 0 && p.owners[i - size] != owner) || (x + 1 < size && p.owners[i + size] != owner) ||
+                (y > 0 && p.owners[i - 1] != owner) || (y + 1 < size && p.owners[i + 1] != owner)) {
+                frontier[owner - 1]++;
+            }
+        }
+        if (!follows) threats.rebuild();
+        scratch.game = p.gameId;
+        scratch.previousOwners = p.owners;
+        scratch.previousFortified = fortified;
+
+        // Диверсии на клетках, которые игрок может захватить (move_frontier.h)
+        int sabotage[2] = {0, 0};
+        auto source = [&](int i, int player) { return p.owners[i] == player && !fortified[i]; };
+        for (size_t j = 0; j < p.sabotage.size(); ++j) {
+            int i = static_cast<int>(p.sabotage[j]);
+            if (fortified[i] || king[i]) continue;
+            int x = i / size, y = i % size;
+            for (int player = 1; player <= 2; ++player) {
+                if (p.owners[i] == player) continue;
+                if ((x > 0 && source(i - size, player)) || (x + 1 < size && source(i + size, player)) ||
+                    (y > 0 && source(i - 1, player)) || (y + 1 < size && source(i + 1, player))) {
+                    sabotage[player - 1] += p.sabotageValues[j];
+                }
+            }
+        }
+
+        for (int s = 0; s < 2; ++s) {
+            int kingDistance = threats.threat(s);
+            out[s][Bot::SCORE] = static_cast<float>(p.scores[s]);
+            out[s][Bot::TERRITORY] = static_cast<float>(territory[s]);
+            out[s][Bot::FRONTIER] = static_cast<float>(frontier[s]);
+            out[s][Bot::KING_DISTANCE] = static_cast<float>(kingDistance < 0 ? size * 2 : kingDistance);
+            out[s][Bot::FORTIFIED] = static_cast<float>(forts[s]);
+            out[s][Bot::SABOTAGE] = static_cast<float>(sabotage[s]);
+            out[s][Bot::COMMANDER] = p.commanders[s] ? 1.0f : 0.0f;
+        }
+    }
+
+    void loadShard(const std::string& path, ShardRows& shard) {
+        Dataset::ShardReader reader;
+        if (!reader.open(path)) {
+            std::fprintf(stderr, "Не удалось открыть шард %s\n", path.c_str());
+            shard.ok = false;
+            return;
+        }
+        shard.size = reader.boardSize();
+        uint32_t count = reader.positionCount();
+        shard.rows.reserve(static_cast<size_t>(count) * FEATURES);
+        shard.games.reserve(count);
+        shard.plies.reserve(count);
+        shard.results.reserve(count);
+        shard.verdicts.reserve(count);
+        Dataset::Position p;
+        Scratch scratch;
+        float features[2][FEATURES];
+        for (uint32_t k = 0; k < count; ++k) {
+            if (!reader.read(k, p)) {
+                std::fprintf(stderr, "Шард %s поврежден (позиция %u)\n", path.c_str(), k);
+                shard.ok = false;
+                return;
+            }
+            positionFeatures(p, scratch, features);
+            for (int f = 0; f < FEATURES; ++f) shard.rows.push_back(features[0][f] - features[1][f]);
+            shard.games.push_back(p.gameId);
+            shard.plies.push_back(p.ply);
+            shard.results.push_back(p.result);
+            float score = features[0][Bot::SCORE] - features[1][Bot::SCORE];
+            float cells = features[0][Bot::TERRITORY] - features[1][Bot::TERRITORY];
+            shard.verdicts.push_back(static_cast<int32_t>(score != 0 ? score : cells));
+        }
+    }
+
+    // Выборка по столбцам: обучающие позиции [0, train), проверочные -
+    // [train, rows)
+    struct Matrix {
+        size_t rows = 0;
+        size_t train = 0;
+        std::vector<float> columns[FEATURES];
+        std::vector<float> labels;
+        float scale[FEATURES];
+    };
+
+    bool loadMatrix(const Options& options, ThreadPool& pool, Matrix& m) {
+        std::vector<ShardRows> shards(options.shards.size());
+        pool.parallelFor(0, static_cast<int>(shards.size()), 1, [&](int begin, int end) {
+            for (int s = begin; s < end; ++s) loadShard(options.shards[s], shards[s]);
+        });
+
+        // Последняя позиция каждой партии - по всем шардам
+        std::vector<GameEnd> ends;
+        for (size_t s = 0; s < shards.size(); ++s) {
+            const ShardRows& shard = shards[s];
+            if (!shard.ok) return false;
+            if (shard.size != shards[0].size) {
+                std::fprintf(stderr, "Шард %s - поле %d, а не %d\n", options.shards[s].c_str(), shard.size,
+                             shards[0].size);
+                return false;
+            }
+            for (size_t k = 0; k < shard.games.size(); ++k) {
+                uint32_t id = shard.games[k];
+                if (id >= ends.size()) ends.resize(id + 1);
+                GameEnd& end = ends[id];
+                end.result = shard.results[k];
+                if (!end.seen || shard.plies[k] >= end.ply) {
+                    end.ply = shard.plies[k];
+                    end.verdict = shard.verdicts[k];
+                    end.seen = true;
+                }
+            }
+        }
+
+        for (const ShardRows& shard : shards) {
+            m.rows += shard.games.size();
+            for (uint32_t id : shard.games) m.train += id % 10 != 0;
+        }
+        for (std::vector<float>& column : m.columns) column.resize(m.rows);
+        m.labels.resize(m.rows);
+        size_t nextTrain = 0, nextValidation = m.train;
+        for (ShardRows& shard : shards) {
+            for (size_t k = 0; k < shard.games.size(); ++k) {
+                uint32_t id = shard.games[k];
+                size_t row = id % 10 != 0 ? nextTrain++ : nextValidation++;
+                const GameEnd& end = ends[id];
+                float label = end.verdict > 0 ? 1.0f : end.verdict < 0 ? 0.0f : 0.5f;
+                if (end.result == 1 || end.result == 2) label = end.result == 1 ? 1.0f : 0.0f;
+                m.labels[row] = label;
+                for (int f = 0; f < FEATURES; ++f) m.columns[f][row] = shard.rows[k * FEATURES + f];
+            }
+            shard = ShardRows(); // Строки больше не нужны
+        }
+
+        // Средний квадрат столбца по обучающим позициям - к единице
+        for (int f = 0; f < FEATURES; ++f) {
+            double sum = 0;
+            for (size_t i = 0; i < m.train; ++i) sum += static_cast<double>(m.columns[f][i]) * m.columns[f][i];
+            double rms = m.train ? std::sqrt(sum / m.train) : 0;
+            m.scale[f] = rms > 0 ? static_cast<float>(rms) : 1.0f;
+            float inverse = 1.0f / m.scale[f];
+            for (float& v : m.columns[f]) v *= inverse;
+        }
+        return m.rows != 0;
+    }
+
+    // Потери и градиент одного блока
+    struct Partial {
+        double loss = 0;
+        double gradient[FEATURES] = {};
+    };
+
+    // Средние логистические потери на [begin, end) и, если gradient не
+    // nullptr, их градиент; блоки - на пуле потоков
+    double pass(const Matrix& m, const float w[FEATURES], size_t begin, size_t end, ThreadPool& pool,
+                std::vector<Partial>& partials, double* gradient) {
+        size_t count = end - begin;
+        if (count == 0) return 0;
+        int blocks = static_cast<int>((count + BLOCK - 1) / BLOCK);
+        partials.assign(blocks, Partial());
+        pool.parallelFor(0, blocks, 1, [&](int from, int to) {
+            float z[BLOCK], residual[BLOCK];
+            for (int b = from; b < to; ++b) {
+                size_t first = begin + static_cast<size_t>(b) * BLOCK;
+                int n = static_cast<int>(std::min<size_t>(BLOCK, end - first));
+                std::fill(z, z + n, 0.0f);
+                for (int f = 0; f < FEATURES; ++f) Simd::axpy(w[f], &m.columns[f][first], z, n);
+                const float* labels = &m.labels[first];
+                double loss = 0;
+                for (int i = 0; i < n; ++i) {
+                    // log(1 + e^z) - y z без переполнения
+                    float v = z[i];
+                    float softplus = v > 0 ? v + std::log1p(std::exp(-v)) : std::log1p(std::exp(v));
+                    loss += softplus - labels[i] * v;
+                    residual[i] = 1.0f / (1.0f + std::exp(-v)) - labels[i];
+                }
+                Partial& partial = partials[b];
+                partial.loss = loss;
+                if (gradient) {
+                    for (int f = 0; f < FEATURES; ++f) partial.gradient[f] = Simd::dot(residual, &m.columns[f][first], n);
+                }
+            }
+        });
+        double loss = 0;
+        if (gradient) std::fill(gradient, gradient + FEATURES, 0.0);
+        for (const Partial& partial : partials) {
+            loss += partial.loss;
+            if (!gradient) continue;
+            for (int f = 0; f < FEATURES; ++f) gradient[f] += partial.gradient[f];
+        }
+        if (gradient) {
+            for (int f = 0; f < FEATURES; ++f) gradient[f] /= static_cast<double>(count);
+        }
+        return loss / static_cast<double>(count);
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 < argc && arg == "--out") {
+            options.out = argv[++i];
+        } else if (i + 1 < argc && arg == "--epochs") {
+            options.epochs = std::max(1, std::atoi(argv[++i]));
+        } else if (i + 1 < argc && arg == "--rate") {
+            options.rate = static_cast<float>(std::atof(argv[++i]));
+        } else if (!arg.empty() && arg[0] != '-') {
+            options.shards.push_back(arg);
+        } else {
+            options.shards.clear();
+            break;
+        }
+    }
+    if (options.shards.empty()) {
+        std::fprintf(stderr, "Использование: %s [--out ВЕСА] [--epochs N] [--rate X] ШАРД...\n", argv[0]);
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ThreadPool& pool = ThreadPool::instance();
+    Matrix m;
+    if (!loadMatrix(options, pool, m)) return 1;
+    double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("Позиций %zu, для обучения %zu, прочитано за %.1f с на %d потоках\n", m.rows, m.train, loadSeconds,
+                pool.threadCount());
+
+    // Adam по полной выборке
+    const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+    float w[FEATURES] = {};
+    double moment[FEATURES] = {}, velocity[FEATURES] = {}, gradient[FEATURES];
+    std::vector<Partial> partials;
+    double trainLoss = 0, validationLoss = 0, epochSeconds = 0;
+    for (int epoch = 0; epoch < options.epochs; ++epoch) {
+        auto epochStart = std::chrono::steady_clock::now();
+        trainLoss = pass(m, w, 0, m.train, pool, partials, gradient);
+        double correction1 = 1 - std::pow(beta1, epoch + 1);
+        double correction2 = 1 - std::pow(beta2, epoch + 1);
+        for (int f = 0; f < FEATURES; ++f) {
+            moment[f] = beta1 * moment[f] + (1 - beta1) * gradient[f];
+            velocity[f] = beta2 * velocity[f] + (1 - beta2) * gradient[f] * gradient[f];
+            double step = options.rate * (moment[f] / correction1) / (std::sqrt(velocity[f] / correction2) + epsilon);
+            w[f] = static_cast<float>(w[f] - step);
+        }
+        validationLoss = pass(m, w, m.train, m.rows, pool, partials, nullptr);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - epochStart).count();
+        epochSeconds += seconds;
+        if (epoch % 20 == 0 || epoch + 1 == options.epochs) {
+            std::printf("Эпоха %d: ошибка %.5f, на проверке %.5f, %.3f с\n", epoch + 1, trainLoss, validationLoss,
+                        seconds);
+        }
+    }
+
+    Bot::Weights weights;
+    for (int f = 0; f < FEATURES; ++f) {
+        weights.w[f] = w[f] / m.scale[f];
+        std::printf("  %-14s %12.6f\n", Bot::FEATURE_NAMES[f], weights.w[f]);
+    }
+    char comment[128];
+    std::snprintf(comment, sizeof(comment), "позиций %zu, эпох %d, ошибка %.5f, на проверке %.5f", m.rows,
+                  options.epochs, trainLoss, validationLoss);
+    if (!weights.save(options.out, comment)) {
+        std::fprintf(stderr, "Не удалось записать %s\n", options.out.c_str());
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("Веса: %s, эпоха в среднем %.3f с, всего %.1f с\n", options.out.c_str(),
+                epochSeconds / options.epochs, seconds);
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "events.h"
+
+// ============= ЧТЕНИЕ ЖУРНАЛА СОБЫТИЙ =============
+// Печатает двоичный журнал Events::BinarySink: каждое событие с типом,
+// игроком и клеткой, а с --text - тем же текстом, что видел игрок.
+//
+//   CELL_WARFARE_EVENTS=events.bin ./game
+//   ./eventlog events.bin
+//   ./eventlog events.bin --text
+
+namespace {
+    const char* typeName(uint8_t type) {
+        switch (type) {
+            case Events::CELL_CAPTURED: return "захват";
+            case Events::SABOTAGE_COLLECTED: return "диверсия";
+            case Events::FORTIFICATION_DESTROYED: return "укрепление разрушено";
+            case Events::SABOTAGE_DESTROYED: return "диверсия уничтожена";
+            case Events::AREA_DESTROYED: return "область уничтожена";
+            case Events::AUTO_CAPTURE_REGION: return "автозахват области";
+            case Events::AUTO_CAPTURE_TERRITORY: return "автозахват территорий";
+            case Events::KING_CAPTURED: return "король захвачен";
+            case Events::PLAYER_ELIMINATED: return "игрок выбыл";
+        }
+        return "?";
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || (argc == 3 && std::string(argv[2]) != "--text") || argc > 3) {
+        std::fprintf(stderr, "Использование: %s ЖУРНАЛ [--text]\n", argv[0]);
+        return 2;
+    }
+    bool text = argc == 3;
+
+    FILE* f = std::fopen(argv[1], "rb");
+    uint32_t header[2];
+    if (!f || std::fread(header, sizeof(header), 1, f) != 1 ||
+        header[0] != Events::LOG_MAGIC || header[1] != Events::LOG_VERSION) {
+        std::fprintf(stderr, "%s - не журнал событий\n", argv[1]);
+        if (f) std::fclose(f);
+        return 1;
+    }
+
+    Events::Event e;
+    unsigned long count = 0;
+    while (std::fread(&e, sizeof(e), 1, f) == 1) {
+        ++count;
+        if (text) {
+            Events::writeText(e, std::cout);
+        } else {
+            std::cout << typeName(e.type) << ": игрок " << static_cast<int>(e.player) << ", (" << e.x << ","
+                      << e.y << "), " << e.a << " " << e.b << "\n";
+        }
+    }
+    std::fclose(f);
+    std::cout << "Событий: " << count << "\n";
+    return 0;
+}
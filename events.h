@@ -0,0 +1,266 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ============= ПОТОК СОБЫТИЙ ПАРТИИ =============
+// Правила сообщают о захватах, диверсиях, разрушениях и автозахватах
+// типизированными записями Event, а не текстом. Записи идут через кольцо
+// одного писателя и одного читателя (SpscRing) в поток-потребитель, который
+// отдает их приемникам: текст в терминал (тот же, что печатала игра),
+// двоичный журнал или ничего. Поток правил не форматирует строк и не
+// берет блокировок.
+//
+// Без подключенного потока интерактивная игра печатает те же события сразу
+// (writeText), а игра без терминала их просто не создает.
+namespace Events {
+    enum Type : uint8_t {
+        CELL_CAPTURED = 0,           // a - прежний владелец, b - очки за диверсию
+        SABOTAGE_COLLECTED,          // a - очки
+        FORTIFICATION_DESTROYED,     // ability - чем
+        SABOTAGE_DESTROYED,          // ability - чем
+        AREA_DESTROYED,              // a - клеток, b - укреплений, ability - чем
+        AUTO_CAPTURE_REGION,         // x, y - первая клетка области, a - клеток, b - очков
+        AUTO_CAPTURE_TERRITORY,      // a, b - очки игроков 1 и 2
+        KING_CAPTURED,               // player - победитель
+        PLAYER_ELIMINATED            // player - выбывший, a - чей захват (партия на 3+ игроков)
+    };
+
+    // Индексы способностей в ABILITIES, которые разрушают клетки
+    const uint8_t CLUSTER_BOMB = 1;
+    const uint8_t ARTILLERY = 4;
+
+    struct Event {
+        uint8_t type;
+        uint8_t player;
+        uint8_t ability;
+        uint8_t reserved;
+        uint16_t x, y;
+        int32_t a, b;
+    };
+    static_assert(sizeof(Event) == 16, "Event пишется в журнал как есть");
+
+    inline Event make(Type type, int player, int x = 0, int y = 0, int a = 0, int b = 0, int ability = 0) {
+        Event e;
+        e.type = type;
+        e.player = static_cast<uint8_t>(player);
+        e.ability = static_cast<uint8_t>(ability);
+        e.reserved = 0;
+        e.x = static_cast<uint16_t>(x);
+        e.y = static_cast<uint16_t>(y);
+        e.a = a;
+        e.b = b;
+        return e;
+    }
+
+    // Текст события - ровно то, что раньше печатали сами правила. Часть
+    // событий (диверсия, король) в терминале не видна, как и раньше.
+    inline void writeText(const Event& e, std::ostream& os) {
+        switch (e.type) {
+            case CELL_CAPTURED:
+                os << "✅ Клетка захвачена! ";
+                if (e.b > 0) {
+                    os << "+" << e.b << " за диверсию! ";
+                }
+                os << ((e.a == 0) ? "+1 очко" : "+2 очка") << "\n";
+                break;
+            case FORTIFICATION_DESTROYED:
+                if (e.ability == CLUSTER_BOMB) {
+                    os << "💥 Укрепление (S) разрушено в клетке (" << e.x << "," << e.y << ")\n";
+                } else {
+                    os << "💥 Укрепление (S) разрушено в (" << e.x << "," << e.y << ")\n";
+                }
+                break;
+            case SABOTAGE_DESTROYED:
+                if (e.ability == CLUSTER_BOMB) {
+                    os << "💥 Саботажная клетка уничтожена в (" << e.x << "," << e.y << ")\n";
+                }
+                break;
+            case AREA_DESTROYED:
+                if (e.ability == CLUSTER_BOMB) {
+                    os << "✅ Уничтожено " << e.a << " клеток в области 2x2\n";
+                } else {
+                    os << "✅ Уничтожено " << e.a << " клеток в области 3x3\n";
+                    if (e.b > 0) {
+                        os << "💥 Разрушено " << e.b << " укреплений (S)\n";
+                    }
+                }
+                break;
+            case AUTO_CAPTURE_REGION:
+                os << "\n🔄 Игрок " << static_cast<int>(e.player)
+                   << " захватил окруженную нейтральную область из "
+                   << e.a << " клеток! +" << e.b << " очков\n";
+                break;
+            case AUTO_CAPTURE_TERRITORY:
+                os << "🔄 Захват окруженных территорий завершен!\n";
+                break;
+            case PLAYER_ELIMINATED:
+                os << "👑 Игрок " << e.a << " захватил короля Игрока " << static_cast<int>(e.player)
+                   << " - тот выбывает!\n";
+                break;
+            default:
+                break;
+        }
+    }
+
+    // ============= КОЛЬЦО SPSC =============
+    // Один писатель двигает tail, один читатель - head; индексы растут
+    // бесконечно, ячейка - индекс по модулю N
+    template <typename T, size_t N>
+    class SpscRing {
+        static_assert((N & (N - 1)) == 0, "N - степень двойки");
+
+    private:
+        alignas(64) std::atomic<size_t> head{0};
+        alignas(64) std::atomic<size_t> tail{0};
+        alignas(64) T items[N];
+
+    public:
+        bool tryPush(const T& item) {
+            size_t t = tail.load(std::memory_order_relaxed);
+            if (t - head.load(std::memory_order_acquire) == N) return false;
+            items[t & (N - 1)] = item;
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool tryPop(T& item) {
+            size_t h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire)) return false;
+            item = items[h & (N - 1)];
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+    };
+
+    // ============= ПРИЕМНИКИ =============
+    class Sink {
+    public:
+        virtual ~Sink() {}
+        virtual void write(const Event& event) = 0;
+        // Вызывается, когда кольцо опустело
+        virtual void flush() {}
+    };
+
+    class TerminalSink : public Sink {
+    private:
+        std::ostream& os;
+
+    public:
+        explicit TerminalSink(std::ostream& stream) : os(stream) {}
+        void write(const Event& event) override { writeText(event, os); }
+        void flush() override { os.flush(); }
+    };
+
+    // Двоичный журнал: заголовок [magic u32][version u32], затем записи
+    // Event по 16 байт. Порядок байт - как у машины, писавшей журнал.
+    const uint32_t LOG_MAGIC = 0x56455743; // "CWEV"
+    const uint32_t LOG_VERSION = 1;
+
+    class BinarySink : public Sink {
+    private:
+        FILE* file;
+
+    public:
+        explicit BinarySink(const std::string& path) : file(std::fopen(path.c_str(), "wb")) {
+            if (!file) return;
+            uint32_t header[2] = {LOG_MAGIC, LOG_VERSION};
+            std::fwrite(header, sizeof(header), 1, file);
+        }
+        ~BinarySink() override {
+            if (file) std::fclose(file);
+        }
+
+        bool isOpen() const { return file != nullptr; }
+        void write(const Event& event) override {
+            if (file) std::fwrite(&event, sizeof(event), 1, file);
+        }
+        void flush() override {
+            if (file) std::fflush(file);
+        }
+    };
+
+    class NullSink : public Sink {
+    public:
+        void write(const Event&) override {}
+    };
+
+    // ============= ПОТОК-ПОТРЕБИТЕЛЬ =============
+    class Stream {
+    public:
+        static const size_t CAPACITY = 4096;
+
+    private:
+        SpscRing<Event, CAPACITY> ring;
+        std::vector<std::unique_ptr<Sink>> sinks;
+        uint64_t published;                  // Пишет только поток правил
+        std::atomic<uint64_t> consumed{0};   // Событий, уже отданных приемникам
+        std::atomic<bool> stopping{false};
+        std::thread consumer;
+
+        void drain() {
+            Event event;
+            uint64_t done = consumed.load(std::memory_order_relaxed);
+            for (;;) {
+                uint64_t batch = 0;
+                while (ring.tryPop(event)) {
+                    for (auto& sink : sinks) sink->write(event);
+                    ++batch;
+                }
+                if (batch > 0) {
+                    for (auto& sink : sinks) sink->flush();
+                    done += batch;
+                    consumed.store(done, std::memory_order_release);
+                    continue;
+                }
+                if (stopping.load(std::memory_order_acquire)) {
+                    if (ring.tryPop(event)) { // Событие, успевшее до остановки
+                        for (auto& sink : sinks) sink->write(event);
+                        consumed.store(++done, std::memory_order_release);
+                        continue;
+                    }
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+            for (auto& sink : sinks) sink->flush();
+        }
+
+    public:
+        explicit Stream(std::vector<std::unique_ptr<Sink>> streamSinks) :
+            sinks(std::move(streamSinks)), published(0) {
+            consumer = std::thread([this] { drain(); });
+        }
+
+        ~Stream() {
+            stopping.store(true, std::memory_order_release);
+            consumer.join();
+        }
+
+        Stream(const Stream&) = delete;
+        Stream& operator=(const Stream&) = delete;
+
+        // Полное кольцо не теряет событий: писатель ждет, пока читатель
+        // освободит место
+        void publish(const Event& event) {
+            while (!ring.tryPush(event)) std::this_thread::yield();
+            ++published;
+        }
+
+        // Ждет, пока все опубликованные события дойдут до приемников -
+        // перед тем как писать в терминал мимо потока
+        void flush() const {
+            while (consumed.load(std::memory_order_acquire) != published) std::this_thread::yield();
+        }
+
+        uint64_t publishedCount() const { return published; }
+    };
+}
@@ -0,0 +1,145 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "game.h"
+
+// ============= ПРОВЕРКА ПАРТИИ КАЖДЫЙ САМ ЗА СЕБЯ =============
+// Играет партию на --players игроков без терминала: первый игрок копит
+// очки захватами и берет Штурмовиком королей соперников по очереди,
+// остальные пасуют. Проверяет, что взятый король выбивает хозяина (и
+// только его), что ход после этого обходит выбывших, что поля угроз не
+// считают выбывших королей и что партия кончается победой первого, когда
+// соперников не осталось. С --players 2 проверяет, что в партии на двоих
+// Штурмовик короля не берет и партия после удара продолжается. При ошибке
+// печатает ее и выходит с кодом 1.
+//
+//   ./ffacheck
+//   ./ffacheck --size 32 --players 8 --seed 7
+//   ./ffacheck --players 2
+
+namespace {
+    struct Options {
+        int size = Constants::BOARD_SIZE_SMALL;
+        int players = 3;
+        uint32_t seed = 1;
+    };
+
+    const int ASSAULT = 2; // Индекс Штурмовика в ABILITIES
+
+    int failures = 0;
+
+    void check(bool ok, const char* what, int turn) {
+        if (ok) return;
+        std::printf("❌ Ход %d: %s\n", turn, what);
+        ++failures;
+    }
+
+    // Угроза игрока перебором по полю: ближайшая его неукрепленная клетка
+    // к королю невыбывшего соперника, -1 - пути нет
+    int expectedThreat(const Game& game, int player) {
+        int size = game.getSize();
+        int best = -1;
+        for (int k = 0; k < game.getPlayerCount(); ++k) {
+            if (k == player || game.getPlayer(k).eliminated) continue;
+            for (int x = 0; x < size; ++x) {
+                for (int y = 0; y < size; ++y) {
+                    const Cell& cell = game.getCell(x, y);
+                    if (cell.ownerId != player + 1 || cell.isFortified) continue;
+                    int d = game.getKingDistance(k, x, y);
+                    if (d >= 0 && (best < 0 || d < best)) best = d;
+                }
+            }
+        }
+        return best;
+    }
+
+    // Следующий по кругу невыбывший игрок после player
+    int nextAlive(const Game& game, int player) {
+        do {
+            player = (player + 1) % game.getPlayerCount();
+        } while (game.getPlayer(player).eliminated);
+        return player;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 < argc && arg == "--size") {
+            options.size = std::atoi(argv[++i]);
+        } else if (i + 1 < argc && arg == "--players") {
+            options.players = std::atoi(argv[++i]);
+        } else if (i + 1 < argc && arg == "--seed") {
+            options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else {
+            std::fprintf(stderr, "Использование: %s [--size N] [--players N] [--seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!Game::isKnownSize(options.size) || options.players < 2 || options.players > Constants::MAX_PLAYERS) {
+        std::fprintf(stderr, "Размер поля - %d, %d или %d, игроков от 2 до %d\n", Constants::BOARD_SIZE_SMALL,
+                     Constants::BOARD_SIZE_MEDIUM, Constants::BOARD_SIZE_LARGE, Constants::MAX_PLAYERS);
+        return 2;
+    }
+
+    Game game(options.size, options.seed, false, MapGen::Options(), options.players);
+    int size = options.size;
+    int eliminated = 0;
+    int turn = 0;
+    for (; !game.isGameOver() && turn < 100000; ++turn) {
+        int current = game.getCurrentPlayer();
+        check(!game.getPlayer(current).eliminated, "ходит выбывший игрок", turn);
+        if (current != 0) {
+            game.playPass();
+        } else if (game.getPlayer(0).canUseAbility(ABILITIES[ASSAULT].baseCost)) {
+            // Удар по королю следующего по кругу соперника
+            int target = nextAlive(game, 0);
+            const Player& victim = game.getPlayer(target);
+            if (!game.playAbility(ASSAULT, victim.kingX, victim.kingY, 'D')) {
+                check(false, "Штурмовик не сработал", turn);
+                break;
+            }
+            if (options.players == 2) {
+                // Вдвоем правила прежние: король стоит, партия идет дальше
+                check(!game.getPlayer(1).eliminated, "в партии на двоих выбыл игрок", turn);
+                check(!game.isGameOver(), "Штурмовик взял короля в партии на двоих", turn);
+                if (failures > 0) return 1;
+                std::printf("Поле %dx%d, игроков: 2: удар по королю на ходу %d партию не кончил\n", size, size, turn);
+                return 0;
+            }
+            ++eliminated;
+            for (int p = 1; p < options.players; ++p) {
+                bool expected = p <= target;
+                check(game.getPlayer(p).eliminated == expected, "выбыл не тот игрок", turn);
+            }
+            check(game.isGameOver() == (eliminated == options.players - 1), "конец партии не совпал с последним выбывшим", turn);
+            if (!game.isGameOver()) {
+                // Взятая королевская клетка теперь своя, но угроза считается
+                // только до оставшихся королей
+                check(game.getKingThreat(0) == expectedThreat(game, 0), "угроза учла выбывшего короля", turn);
+                int alive = nextAlive(game, 0);
+                game.playPass();
+                check(game.getCurrentPlayer() == alive, "ход не перешел к следующему невыбывшему", turn);
+            }
+        } else {
+            const std::vector<uint32_t>& available = game.getAvailableCells();
+            if (available.empty()) {
+                game.playPass();
+            } else {
+                uint32_t cell = available[turn % available.size()];
+                game.playCapture(static_cast<int>(cell) / size, static_cast<int>(cell) % size);
+            }
+        }
+    }
+
+    check(game.isGameOver(), "партия не кончилась", turn);
+    check(game.getWinner() == 1, "победил не первый игрок", turn);
+    check(!game.playCapture(0, 0), "после конца партии ход принят", turn);
+    if (failures > 0) return 1;
+    std::printf("Поле %dx%d, игроков: %d: %d выбыли, победил игрок %d за %d ходов\n", size, size,
+                options.players, eliminated, game.getWinner(), turn);
+    return 0;
+}
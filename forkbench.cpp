@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "alloc_hook.h"
+#include "game.h"
+
+// ============= ЗАМЕР ВЕТОК ПАРТИИ =============
+// Сравнивает Game::fork() с полной копией партии (fork() + detach(): все
+// плитки свои, как у прежнего копирования по значению). Позиция - партия
+// после --plies случайных захватов. Для каждого способа печатает среднее
+// время, байты и выделения памяти на копию и на копию с одним захватом в
+// ней: байты хода в ветке - это плитки, которые он скопировал. Затем
+// --threads потоков ведут ветки от общей позиции одновременно.
+//
+//   ./forkbench --size 64 --forks 2000
+//   ./forkbench --size 256 --players 4 --threads 4
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        int size = 64;
+        int players = 2;
+        int plies = -1;  // -1 - 2 * size
+        int forks = 2000;
+        int threads = 4;
+        uint32_t seed = 1;
+    };
+
+    struct Cost {
+        double micros = 0;
+        unsigned long long bytes = 0;
+        unsigned long long allocations = 0;
+    };
+
+    // Считает время и память вызова fn; счетчик выделений общий, поэтому
+    // только из одного потока
+    template <typename Fn>
+    void measure(Cost& cost, Fn&& fn) {
+        unsigned long long bytes = AllocHook::bytes.load();
+        unsigned long long allocations = AllocHook::allocations.load();
+        auto start = Clock::now();
+        AllocHook::counting = true;
+        fn();
+        AllocHook::counting = false;
+        cost.micros += std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        cost.bytes += AllocHook::bytes.load() - bytes;
+        cost.allocations += AllocHook::allocations.load() - allocations;
+    }
+
+    // Копия и копия с захватом: fork() или полная копия
+    void run(const Game& root, const std::vector<uint32_t>& captures, int forks, bool full, Cost& copy,
+             Cost& move) {
+        int size = root.getSize();
+        for (int i = 0; i < forks; ++i) {
+            uint32_t cell = captures[i % captures.size()];
+            Game* branch = nullptr;
+            measure(copy, [&] {
+                branch = new Game(root.fork());
+                if (full) branch->detach();
+            });
+            measure(move, [&] { branch->playCapture(static_cast<int>(cell) / size, static_cast<int>(cell) % size); });
+            delete branch;
+        }
+    }
+
+    void print(const char* name, const Cost& cost, int forks) {
+        std::printf("  %10.2f %10llu %10.1f  %s\n", cost.micros / forks, cost.bytes / forks,
+                    static_cast<double>(cost.allocations) / forks, name);
+    }
+
+    // Ветки с захватом в threads потоках от одной позиции; ветки в секунду
+    double concurrent(const Game& root, const std::vector<uint32_t>& captures, int forks, int threads, bool full) {
+        int size = root.getSize();
+        auto start = Clock::now();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (int i = t; i < forks; i += threads) {
+                    uint32_t cell = captures[i % captures.size()];
+                    Game branch = root.fork();
+                    if (full) branch.detach();
+                    branch.playCapture(static_cast<int>(cell) / size, static_cast<int>(cell) % size);
+                }
+            });
+        }
+        for (std::thread& worker : workers) worker.join();
+        return forks / std::chrono::duration<double>(Clock::now() - start).count();
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 < argc && arg == "--size") {
+            options.size = std::atoi(argv[++i]);
+        } else if (i + 1 < argc && arg == "--players") {
+            options.players = std::atoi(argv[++i]);
+        } else if (i + 1 < argc && arg == "--plies") {
+            options.plies = std::max(0, std::atoi(argv[++i]));
+        } else if (i + 1 < argc && arg == "--forks") {
+            options.forks = std::max(1, std::atoi(argv[++i]));
+        } else if (i + 1 < argc && arg == "--threads") {
+            options.threads = std::max(1, std::atoi(argv[++i]));
+        } else if (i + 1 < argc && arg == "--seed") {
+            options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else {
+            std::fprintf(stderr, "Использование: %s [--size N] [--players N] [--plies N] [--forks N] "
+                                 "[--threads N] [--seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (options.size < Constants::BOARD_SIZE_SMALL || options.size > 1024 ||
+        options.players < Constants::MIN_PLAYERS || options.players > Constants::MAX_PLAYERS) {
+        std::fprintf(stderr, "Недопустимые размер поля или число игроков\n");
+        return 2;
+    }
+    if (options.plies < 0) options.plies = options.size * 2;
+
+    // Ветки считают правила в своем потоке, как у подсказок (hint.h)
+    Game root(options.size, options.seed, false, MapGen::Options(), options.players);
+    root.setParallel(false);
+    std::mt19937 rng(options.seed);
+    int played = 0;
+    for (; played < options.plies && !root.isGameOver(); ++played) {
+        const std::vector<uint32_t>& available = root.getAvailableCells();
+        if (available.empty()) {
+            root.playAction(Action());
+            continue;
+        }
+        uint32_t cell = available[rng() % available.size()];
+        root.playCapture(static_cast<int>(cell) / options.size, static_cast<int>(cell) % options.size);
+    }
+    std::vector<uint32_t> captures = root.getAvailableCells();
+    if (root.isGameOver() || captures.empty()) {
+        std::fprintf(stderr, "Партия кончилась раньше, чем набралась позиция: уменьшите --plies\n");
+        return 1;
+    }
+
+    // Прогрев: буферы кучи и пул потоков
+    Cost warmup[2];
+    run(root, captures, std::min(options.forks, 50), true, warmup[0], warmup[1]);
+
+    Cost fullCopy, fullMove, forkCopy, forkMove;
+    run(root, captures, options.forks, true, fullCopy, fullMove);
+    run(root, captures, options.forks, false, forkCopy, forkMove);
+
+    std::printf("Поле %dx%d, игроков: %d, позиция после %d ходов, веток: %d\n", options.size, options.size,
+                options.players, played, options.forks);
+    std::printf("         мкс       байт  выделений  на ветку\n");
+    print("полная копия", fullCopy, options.forks);
+    print("fork()", forkCopy, options.forks);
+    print("захват в полной копии", fullMove, options.forks);
+    print("захват в fork()", forkMove, options.forks);
+    std::printf("fork() дешевле полной копии в %.1f раза по времени и в %.1f раза по памяти\n",
+                fullCopy.micros / forkCopy.micros,
+                static_cast<double>(fullCopy.bytes) / std::max<unsigned long long>(1, forkCopy.bytes));
+    std::printf("С захватом: %.2f мкс и %llu байт против %.2f мкс и %llu байт\n",
+                (forkCopy.micros + forkMove.micros) / options.forks,
+                (forkCopy.bytes + forkMove.bytes) / options.forks,
+                (fullCopy.micros + fullMove.micros) / options.forks,
+                (fullCopy.bytes + fullMove.bytes) / options.forks);
+
+    double fullRate = concurrent(root, captures, options.forks, options.threads, true);
+    double forkRate = concurrent(root, captures, options.forks, options.threads, false);
+    std::printf("%d потоков, веток с захватом в секунду: полные копии %.0f, fork() %.0f\n", options.threads,
+                fullRate, forkRate);
+    return 0;
+}
@@ -0,0 +1,2602 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <random>
+#include <string>
+#include <cstdlib>
+#include <limits>
+#include <cmath>
+#include <memory>
+#include <algorithm>
+#include <fstream>
+#include <cstdint>
+#include <atomic>
+#include <functional>
+
+#include "events.h"
+#include "king_threat.h"
+#include "move_frontier.h"
+#include "cow_grid.h"
+#include "map_gen.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+#ifdef _WIN32
+    #include <conio.h>
+#else
+    #include <termios.h>
+    #include <unistd.h>
+    inline int _getch() {
+        struct termios oldt, newt;
+        int ch;
+        tcgetattr(STDIN_FILENO, &oldt);
+        newt = oldt;
+        newt.c_lflag &= ~(ICANON | ECHO);
+        tcsetattr(STDIN_FILENO, TCSANOW, &newt);
+        ch = getchar();
+        tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
+        return ch;
+    }
+#endif
+
+// ============= ПРОСТРАНСТВА ИМЕН ДЛЯ ОРГАНИЗАЦИИ =============
+namespace Constants {
+    const int BOARD_SIZE_SMALL = 16;
+    const int BOARD_SIZE_MEDIUM = 32;
+    const int BOARD_SIZE_LARGE = 64;
+    const int MIN_BOARD_SIZE = 16;
+    const int MAX_BOARD_SIZE = 64;
+    const int DEFAULT_SIZE = 16;
+    const int INITIAL_TERRITORY_SIZE_SMALL = 5;
+    const int INITIAL_TERRITORY_SIZE_MEDIUM = 8;
+    const int INITIAL_TERRITORY_SIZE_LARGE = 12;
+    const int SABOTAGE_DIVISOR_SMALL = 17;
+    const int SABOTAGE_DIVISOR_MEDIUM = 25;
+    const int SABOTAGE_DIVISOR_LARGE = 40;
+    const int MIN_SABOTAGE_SMALL = 3;
+    const int MIN_SABOTAGE_MEDIUM = 5;
+    const int MIN_SABOTAGE_LARGE = 10;
+    const int COMMANDER_DISCOUNT_PERCENT = 35;
+    const int VISIBILITY_RADIUS_SMALL = 3;
+    const int VISIBILITY_RADIUS_MEDIUM = 5;
+    const int VISIBILITY_RADIUS_LARGE = 8;
+    const int SCOUTING_RADIUS_SMALL = 6;
+    const int SCOUTING_RADIUS_MEDIUM = 10;
+    const int SCOUTING_RADIUS_LARGE = 15;
+    const int FORTIFICATION_COST = 6; // Новая цена укреплений
+    const int PARALLEL_MIN_CELLS = 32 * 32; // С какого размера поля проходы идут на пуле потоков
+    const int PARALLEL_BAND_ROWS = 8;       // Высота полосы, которую получает один поток
+    const int STATS_HISTORY_TURNS = 4096;   // Ходов в истории счетчиков по умолчанию
+    const int KING_DANGER_DISTANCE = 3;     // Предупреждать, если соперник ближе к королю
+    const int MIN_PLAYERS = 2;
+    const int MAX_PLAYERS = 8;              // Владелец клетки - 4 бита в packCell()
+}
+
+// ============= СТРУКТУРЫ КОНФИГУРАЦИИ =============
+struct AbilityConfig {
+    std::string name;
+    int baseCost;
+    std::string description;
+};
+
+// Статический массив способностей с обновленной ценой укреплений
+static const AbilityConfig ABILITIES[] = {
+    {"Десантник", 18, "Захват любой клетки (мин. 5 от королевских)"},
+    {"Кассетная бомба", 8, "Сброс области 2x2 в нейтральные"},
+    {"Штурмовик", 10, "Захват 3 клеток в направлении"},
+    {"Командир", 50, "-35% к стоимости способностей на ВСЕ ходы"},
+    {"Артиллерия", 20, "Уничтожение всего в области 3x3"},
+    {"Укрепления", 6, "Защита 2 клеток в направлении (только артиллерия)"},
+    {"Разведка", 12, "Показывает область вокруг клетки"}
+};
+
+static const int NUM_ABILITIES = sizeof(ABILITIES) / sizeof(ABILITIES[0]);
+
+// ============= ТРАФАРЕТЫ СПОСОБНОСТЕЙ =============
+// Способность на поле - трафарет клеток вокруг цели и действие на каждую
+// клетку. Все способности применяет одно ядро Game::applyStencil(): оно
+// обрезает трафарет по краям поля один раз, а не проверяет каждую клетку, и
+// меняет клетки через CellEdit, так что журнал, счетчики игроков, поля
+// расстояний до королей и видимость обновляются сами. Новой способности
+// достаточно строки в таблице.
+
+// Причина изменений для счетчиков потерь и автозахвата
+enum EditCause : uint8_t { EDIT_DIRECT = 0, EDIT_BOMB, EDIT_ARTILLERY, EDIT_AUTO_CAPTURE };
+
+enum class StencilShape : uint8_t {
+    NONE,      // Способность не трогает поле (Командир)
+    RECT,      // Квадрат смещений [from, to] по обеим осям
+    LINE       // Клетки [from, to] вдоль направления W/A/S/D
+};
+
+enum class AreaEffect : uint8_t {
+    NONE,
+    CAPTURE,     // Клетка становится своей, диверсия собирается; укрепления не берутся
+    NEUTRALIZE,  // Клетка, укрепление и диверсия уничтожаются; короли не трогаются
+    FORTIFY,     // Своя клетка укрепляется
+    REVEAL       // Клетка открывается, но не меняется
+};
+
+struct AbilityStencil {
+    StencilShape shape;
+    AreaEffect effect;
+    int8_t from, to;
+    bool scoutingScale;         // RECT: from и to умножаются на радиус разведки
+    bool allOrNothing;          // Неподходящая или лежащая за полем клетка отменяет способность
+    uint8_t kingClearance;      // Цель не ближе этого к вражеским королям (по Чебышеву), 0 - где угодно
+    bool reportFortifications;  // AREA_DESTROYED несет число разрушенных укреплений
+    EditCause cause;
+    const char* profileName;
+    // Текст в терминале - тот же, что печатала каждая способность до таблицы
+    const char* title;          // Строка "title на клетке (x,y)"; nullptr - без нее
+    const char* prompt;         // Вопрос о направлении для LINE
+    const char* area;           // Строка "area NxN клетки"; nullptr - без нее
+    bool areaAtTarget;          // Вместо " клетки" - " вокруг (x,y)"
+    bool showPrice;             // Строка "Цена: N очков" перед вопросом о направлении
+    const char* fortifiedCell;  // CAPTURE: отказ на укрепленной клетке; nullptr - молча
+    bool namesCell;             // В отказе - координаты клетки
+    bool pauseOnError;          // Отказ способности ждет Enter
+};
+
+// По индексам ABILITIES; индекс способности - он же Events::Event::ability
+static constexpr AbilityStencil ABILITY_STENCILS[] = {
+    {StencilShape::RECT, AreaEffect::CAPTURE, 0, 0, false, true, KingThreat::PARATROOPER_MIN_DISTANCE, false,
+     EDIT_DIRECT, "ability.paratrooper", "📍 Использование Десантника", nullptr,
+     nullptr, false, false, "❌ Нельзя поставить десантника на укрепленную клетку", false, false},
+    {StencilShape::RECT, AreaEffect::NEUTRALIZE, 0, 1, false, false, 0, false,
+     EDIT_BOMB, "ability.clusterBomb", "💣 Использование Кассетной бомбы", nullptr,
+     "💥 Область поражения: ", false, false, nullptr, false, false},
+    {StencilShape::LINE, AreaEffect::CAPTURE, 0, 2, false, false, 0, false,
+     EDIT_DIRECT, "ability.assaultSoldier", "🔫 Использование Штурмовика",
+     "Выберите направление (W-вверх, S-вниз, A-влево, D-вправо): ",
+     nullptr, false, false, "❌ Нельзя захватить укрепленную клетку (S)", true, false},
+    {StencilShape::NONE, AreaEffect::NONE, 0, 0, false, false, 0, false,
+     EDIT_DIRECT, "ability.commander", nullptr, nullptr,
+     nullptr, false, false, nullptr, false, false},
+    {StencilShape::RECT, AreaEffect::NEUTRALIZE, -1, 1, false, false, 0, true,
+     EDIT_ARTILLERY, "ability.artillery", "💥 Использование Артиллерии", nullptr,
+     "💥 Область поражения: ", false, false, nullptr, false, false},
+    {StencilShape::LINE, AreaEffect::FORTIFY, 0, 1, false, true, 0, false,
+     EDIT_DIRECT, "ability.fortifications", "\n🏰 Использование Укреплений",
+     "Выберите направление для укрепления 1x2 (W-вверх, S-вниз, A-влево, D-вправо): ",
+     nullptr, false, true, nullptr, false, true},
+    {StencilShape::RECT, AreaEffect::REVEAL, -1, 1, true, false, 0, false,
+     EDIT_DIRECT, "ability.scouting", nullptr, nullptr,
+     "🔍 Разведка активирована! Показана область ", true, false, nullptr, false, false}
+};
+
+static_assert(sizeof(ABILITY_STENCILS) / sizeof(ABILITY_STENCILS[0]) == NUM_ABILITIES,
+              "трафарет на каждую способность");
+static_assert(Events::CLUSTER_BOMB == 1 && Events::ARTILLERY == 4, "события называют способность ее индексом");
+
+// ============= ОПТИМИЗИРОВАННЫЕ КЛАССЫ =============
+
+// Минималистичный ColorManager
+class ColorManager {
+private:
+    static const char* colors[17]; // Добавлен цвет для укреплений
+    
+public:
+    static const char* get(int index) {
+        return (index >= 0 && index < 17) ? colors[index] : colors[0];
+    }
+    
+    // Цвет фона клеток игрока playerId (1-8)
+    static int playerColor(int playerId) {
+        return playerId <= 2 ? playerId + 1 : playerId + 8;
+    }
+    
+    static void clearScreen() {
+#ifdef _WIN32
+        system("cls");
+#else
+        system("clear");
+#endif
+    }
+    
+    static void waitForEnter() {
+        std::cout << "Нажмите Enter для продолжения...";
+        std::cin.clear();
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    
+    // Поток, который все выбрасывает: в него пишут игры без терминала.
+    // Свой у каждого потока, чтобы параллельные игры не делили его состояние.
+    static std::ostream& nullStream() {
+        struct NullBuffer : std::streambuf {
+            int overflow(int c) override { return c; }
+        };
+        static thread_local NullBuffer buffer;
+        static thread_local std::ostream stream(&buffer);
+        return stream;
+    }
+};
+
+// Инициализация статического массива с новым цветом для укреплений
+inline const char* ColorManager::colors[] = {
+    "\033[0m",        // reset
+    "\033[1;37m",     // text
+    "\033[48;2;255;100;100m\033[1;37m",  // player1_bg
+    "\033[48;2;100;100;255m\033[1;37m",  // player2_bg
+    "\033[48;2;255;255;100m\033[1;30m",  // king
+    "\033[48;2;200;100;255m\033[1;37m",  // sabotage
+    "\033[48;2;50;50;50m\033[1;37m",     // neutral_bg
+    "\033[48;2;100;255;100m\033[1;30m",  // available
+    "\033[48;2;255;255;255m\033[1;30m",  // cursor
+    "\033[48;2;30;30;30m\033[1;30m",     // fog of war
+    "\033[48;2;139;69;19m\033[1;37m",    // fortification (коричневый)
+    "\033[48;2;60;170;60m\033[1;37m",    // player3_bg
+    "\033[48;2;230;140;30m\033[1;30m",   // player4_bg
+    "\033[48;2;40;180;190m\033[1;30m",   // player5_bg
+    "\033[48;2;230;90;200m\033[1;37m",   // player6_bg
+    "\033[48;2;150;150;150m\033[1;30m",  // player7_bg
+    "\033[48;2;120;60;160m\033[1;37m"    // player8_bg
+};
+
+// Массив атомарных счетчиков для параллельных проходов по полю. Это только
+// рабочий буфер: при копировании игры он не копируется, а заводится заново.
+template <typename T>
+class AtomicScratch {
+private:
+    std::unique_ptr<std::atomic<T>[]> data;
+    int count;
+    
+public:
+    AtomicScratch() : count(0) {}
+    AtomicScratch(const AtomicScratch&) : count(0) {}
+    AtomicScratch& operator=(const AtomicScratch&) { return *this; }
+    
+    void resize(int n) {
+        if (n != count) {
+            data.reset(new std::atomic<T>[n]);
+            count = n;
+        }
+    }
+    
+    int size() const { return count; }
+    std::atomic<T>& operator[](int i) { return data[i]; }
+    const std::atomic<T>& operator[](int i) const { return data[i]; }
+};
+
+// Структура для Cell с поддержкой тумана войны и укреплений
+struct Cell {
+    uint8_t ownerId;      // 0 - нейтральная, 1-MAX_PLAYERS - игрок
+    bool kingCell : 1;
+    bool sabotageCell : 1;
+    bool isExplored : 1;  // Была ли исследована клетка
+    bool isFortified : 1; // Новое: укреплена ли клетка
+    uint8_t sabotageValue : 3;
+    uint8_t lastSeenOwner : 4; // Кто был владельцем, когда видели в последний раз
+    
+    Cell() : ownerId(0), kingCell(false), sabotageCell(false), isExplored(false),
+             isFortified(false), sabotageValue(0), lastSeenOwner(0) {}
+};
+
+// Оптимизированный Player
+struct Player {
+    int8_t playerId;      // 1-MAX_PLAYERS
+    int score;
+    uint16_t kingX, kingY; // Используем uint16_t для больших полей
+    uint16_t cursorX, cursorY;
+    bool commanderActive;
+    bool abilityUsedThisTurn;
+    bool eliminated;      // Короля захватили (партия на 3+ игроков)
+    
+    // Конструктор по умолчанию
+    Player() : playerId(0), score(0), kingX(0), kingY(0), 
+               cursorX(0), cursorY(0), commanderActive(false),
+               abilityUsedThisTurn(false), eliminated(false) {}
+    
+    // Основной конструктор
+    Player(int id, int kx, int ky) : 
+        playerId(static_cast<int8_t>(id)), score(0), 
+        kingX(static_cast<uint16_t>(kx)), 
+        kingY(static_cast<uint16_t>(ky)), 
+        cursorX(static_cast<uint16_t>(kx)), 
+        cursorY(static_cast<uint16_t>(ky)), 
+        commanderActive(false),
+        abilityUsedThisTurn(false),
+        eliminated(false) {}
+    
+    int getAbilityCost(int baseCost) const {
+        return commanderActive ? 
+            static_cast<int>(baseCost * (100 - Constants::COMMANDER_DISCOUNT_PERCENT) / 100.0) : 
+            baseCost;
+    }
+    
+    bool canUseAbility(int baseCost) const {
+        return score >= getAbilityCost(baseCost) && !abilityUsedThisTurn;
+    }
+    
+    void useAbility(int baseCost) {
+        score -= getAbilityCost(baseCost);
+        abilityUsedThisTurn = true;
+    }
+    
+    void resetTurn() {
+        abilityUsedThisTurn = false;
+    }
+    
+    void moveCursor(char direction, int boardSize) {
+        switch(direction) {
+            case 'w': case 'W': if (cursorY > 0) cursorY--; break;
+            case 's': case 'S': if (cursorY < static_cast<uint16_t>(boardSize-1)) cursorY++; break;
+            case 'a': case 'A': if (cursorX > 0) cursorX--; break;
+            case 'd': case 'D': if (cursorX < static_cast<uint16_t>(boardSize-1)) cursorX++; break;
+        }
+    }
+};
+
+// Открытое состояние клетки - без тумана, курсоров и доступности - в 16
+// битах: владелец (4 бита), король, укрепление, диверсия и ее очки (3 бита).
+// Так клетку видят журнал изменений и зрители.
+inline uint16_t packCell(const Cell& cell) {
+    return static_cast<uint16_t>((cell.ownerId & 0x0F) |
+                                 (cell.kingCell ? 1 << 4 : 0) |
+                                 (cell.isFortified ? 1 << 5 : 0) |
+                                 (cell.sabotageCell ? 1 << 6 : 0) |
+                                 (cell.sabotageValue << 7));
+}
+
+inline void unpackCell(uint16_t packed, Cell& cell) {
+    cell.ownerId = static_cast<uint8_t>(packed & 0x0F);
+    cell.kingCell = (packed >> 4) & 1;
+    cell.isFortified = (packed >> 5) & 1;
+    cell.sabotageCell = (packed >> 6) & 1;
+    cell.sabotageValue = static_cast<uint8_t>((packed >> 7) & 0x07);
+}
+
+// Изменение открытого состояния клетки (packCell до и после)
+struct CellDiff {
+    uint16_t x, y;
+    uint16_t before, after;
+};
+
+// Событие правил для журнала партии
+struct GameEvent {
+    enum Type : uint8_t { ABILITY_USED = 0 };
+    
+    uint8_t type;
+    uint8_t playerId;
+    uint8_t ability;
+    char direction;
+    uint16_t x, y;
+};
+
+// Счетчики игрока. Правила обновляют их при каждом изменении клетки, так
+// что прочитать их можно в любой момент без прохода по полю.
+struct PlayerStats {
+    int territory = 0;        // Своих клеток, включая королевскую и укрепленные
+    int fortified = 0;        // Своих укрепленных клеток
+    int frontier = 0;         // Своих клеток с чужим или нейтральным соседом
+    int sabotagePoints = 0;   // Очков, собранных с диверсий
+    int lostToBombs = 0;      // Своих клеток, сброшенных кассетной бомбой
+    int lostToArtillery = 0;  // Своих клеток, уничтоженных артиллерией
+    int autoCaptured = 0;     // Клеток, полученных автозахватом окруженных областей
+};
+
+// Сколько работы ушло на производное состояние (см. Game::updateAvailableMoves()).
+// Без учета изменений каждый запрос был полным проходом по полю.
+struct DerivedCounters {
+    uint64_t requests = 0;          // Запросов видимости и доступности ходов
+    uint64_t fullPasses = 0;
+    uint64_t partialPasses = 0;
+    uint64_t cellsRecomputed = 0;   // Клеток, пересчитанных частичными проходами
+    uint64_t enclosureRequests = 0; // Запросов проходов автозахвата
+    uint64_t enclosureRuns = 0;     // Из них выполнено: остальные пропущены - поле не менялось
+    
+    DerivedCounters& operator+=(const DerivedCounters& other) {
+        requests += other.requests;
+        fullPasses += other.fullPasses;
+        partialPasses += other.partialPasses;
+        cellsRecomputed += other.cellsRecomputed;
+        enclosureRequests += other.enclosureRequests;
+        enclosureRuns += other.enclosureRuns;
+        return *this;
+    }
+};
+
+// Снимок счетчиков на конец хода
+struct StatsSample {
+    uint32_t turn = 0;
+    int scores[Constants::MAX_PLAYERS] = {};
+    PlayerStats players[Constants::MAX_PLAYERS];
+};
+
+// Кольцо снимков по ходам (включается Game::setStatsHistory()). Как и
+// TurnObserver, принадлежит одной партии: копия партии начинает без истории,
+// поэтому пробные ходы бота ее не копируют.
+class StatsHistory {
+private:
+    std::vector<StatsSample> samples;
+    size_t next = 0;
+    uint64_t recorded = 0;
+
+public:
+    StatsHistory() {}
+    StatsHistory(const StatsHistory&) {}
+    StatsHistory& operator=(const StatsHistory&) { return *this; }
+
+    void setCapacity(size_t turns) {
+        samples.assign(turns, StatsSample());
+        clear();
+    }
+
+    void clear() {
+        next = 0;
+        recorded = 0;
+    }
+
+    void push(const StatsSample& sample) {
+        if (samples.empty()) return;
+        samples[next] = sample;
+        next = (next + 1) % samples.size();
+        ++recorded;
+    }
+
+    size_t capacity() const { return samples.size(); }
+
+    // Сколько снимков хранится; старые вытесняются новыми
+    size_t count() const {
+        return recorded < samples.size() ? static_cast<size_t>(recorded) : samples.size();
+    }
+
+    // i-й хранимый снимок, от старого к новому
+    const StatsSample& at(size_t i) const {
+        size_t oldest = recorded < samples.size() ? 0 : next;
+        return samples[(oldest + i) % samples.size()];
+    }
+};
+
+// Поток событий (events.h), в который пишет партия. Поток принадлежит
+// вызывающему; копия партии, как и с TurnObserver, событий не шлет.
+class EventOutput {
+private:
+    Events::Stream* stream;
+    
+public:
+    EventOutput() : stream(nullptr) {}
+    EventOutput(const EventOutput&) : stream(nullptr) {}
+    EventOutput& operator=(const EventOutput&) { return *this; }
+    
+    void set(Events::Stream* target) { stream = target; }
+    Events::Stream* get() const { return stream; }
+};
+
+class Game;
+
+// Подсказки во время хода человека (см. hint.h). playTurn() сообщает о
+// начале хода и о действиях игрока, а по клавише H просит показать
+// готовую подсказку.
+class HintProvider {
+public:
+    virtual ~HintProvider() {}
+    virtual void turnStarted(const Game& game) = 0;
+    virtual void turnEnded() = 0;
+    virtual void show(std::ostream& os) const = 0;
+};
+
+// Подписчик на конец хода. Принадлежит одной партии: копия партии (пробные
+// ходы бота, снимки для пула) его не получает.
+class TurnObserver {
+private:
+    std::function<void(const Game&)> callback;
+    
+public:
+    TurnObserver() {}
+    TurnObserver(const TurnObserver&) {}
+    TurnObserver& operator=(const TurnObserver&) { return *this; }
+    
+    void set(std::function<void(const Game&)> fn) { callback = std::move(fn); }
+    void notify(const Game& game) const {
+        if (callback) callback(game);
+    }
+};
+
+// Ход в партии без терминала (сервер, боты, симуляции)
+struct Action {
+    enum Kind : uint8_t { CAPTURE = 0, ABILITY = 1, PASS = 2 };
+    
+    uint8_t kind;
+    uint8_t ability;      // Индекс в ABILITIES для ABILITY
+    uint16_t x, y;
+    char direction;       // W/A/S/D для Штурмовика и Укреплений
+    
+    Action() : kind(PASS), ability(0), x(0), y(0), direction(0) {}
+    
+    static Action capture(int x, int y) {
+        Action a;
+        a.kind = CAPTURE;
+        a.x = static_cast<uint16_t>(x);
+        a.y = static_cast<uint16_t>(y);
+        return a;
+    }
+    
+    static Action useAbility(int index, int x, int y, char direction = 0) {
+        Action a = capture(x, y);
+        a.kind = ABILITY;
+        a.ability = static_cast<uint8_t>(index);
+        a.direction = direction;
+        return a;
+    }
+    
+    static Action pass() {
+        return Action();
+    }
+};
+
+static_assert(KingThreat::MAX_KINGS == Constants::MAX_PLAYERS, "поле расстояний - на каждого короля");
+static_assert(MoveFrontier::MAX_PLAYERS == Constants::MAX_PLAYERS, "множество захватов - на каждого игрока");
+static_assert(Constants::PARALLEL_BAND_ROWS % CowGrid<Cell>::TILE_ROWS == 0, "полоса пишет только в свои плитки");
+
+// Основной класс игры
+class Game {
+private:
+    int size;
+    CowGrid<Cell> board;  // Плитки общие с копиями партии (см. cow_grid.h)
+    Player players[Constants::MAX_PLAYERS];
+    int playerCount;
+    int currentPlayer;
+    bool gameOver;
+    int winner;
+    int abilitiesUsed[NUM_ABILITIES];
+    int visibilityRadius;
+    int scoutingRadius;
+    int initialTerritorySize;
+    int sabotageDivisor;
+    int minSabotage;
+    bool interactive;     // false - игра без терминала (сервер, симуляции)
+    bool parallelBands;   // false - полосы forEachBand() всегда в текущем потоке
+    MapGen::Options mapOptions;           // Шаблон карты для reset()
+    WorkBuffer<uint8_t> ownerSnapshot;      // Рабочий буфер captureSurroundedTerritories()
+    
+    // Журнал изменений клеток и событий (включается setJournalEnabled())
+    bool journalEnabled;
+    std::vector<CellDiff> cellJournal;
+    std::vector<GameEvent> eventJournal;
+    WorkBuffer<std::vector<CellDiff>> bandEdits; // Свои у каждой полосы forEachBand()
+    TurnObserver turnObserver;
+    EventOutput events;
+    HintProvider* hints;  // Только для playTurn(), копии партии его не зовут
+    
+    // Счетчики игроков (см. applyEdit()) и их история по ходам
+    PlayerStats stats[Constants::MAX_PLAYERS];
+    CowArray<uint8_t> frontierOwner;      // Чьей границе клетка сейчас засчитана, 0 - ничьей
+    uint8_t editCause;                    // EDIT_* для изменений, сделанных сейчас
+    uint32_t turnsPlayed;
+    StatsHistory statsHistory;
+    KingThreat threats;                   // Расстояния до королей (см. king_threat.h)
+    MoveFrontier moves;                   // Доступные захваты игроков (см. move_frontier.h)
+    // Слои видимости игроков: [игрок][клетка] - сколько своих клеток
+    // игрока в радиусе видимости от клетки (см. shiftVision())
+    CowGrid<uint16_t> visionCount[Constants::MAX_PLAYERS];
+    bool threatOverlay;                   // display() показывает расстояния до короля
+    
+    // Видимость игроков - не в Cell, а в своем слое: бит p - клетка видна
+    // игроку p (с 0). Так смена игрока не переписывает туман по всему полю
+    // (и ветка партии не копирует из-за него все плитки), а слой игрока
+    // пересчитывается, только когда он ходит, и только вокруг клеток,
+    // изменившихся с его прошлого пересчета (см. updateAvailableMoves())
+    CowGrid<uint8_t> visibleTo;
+    struct PlayerView {
+        int dirtyFromX, dirtyFromY, dirtyToX, dirtyToY; // Пусто - dirtyFromX > dirtyToX
+        bool valid;                       // false - пересчитать все поле
+        uint16_t cursorX, cursorY;        // Курсор на момент пересчета
+    };
+    PlayerView views[Constants::MAX_PLAYERS];
+    // Версия поля растет с каждым изменением клетки; проход автозахвата,
+    // ничего не нашедший на версии, на ней же не повторяется
+    uint64_t boardVersion;
+    uint64_t territoriesStableAt;
+    uint64_t neutralStableAt;
+    DerivedCounters derivedCounters;
+    
+    // Разметка нейтральных областей (см. labelNeutralRegions())
+    AtomicScratch<int> neutralParent;
+    WorkBuffer<int> neutralLabel;
+    AtomicScratch<uint32_t> neutralContacts;
+    AtomicScratch<int> neutralRegionCells;
+    AtomicScratch<int> neutralRegionPoints;
+    
+    void clearInputBuffer() {
+        std::cin.clear();
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    
+    // Событие правил: в подключенный поток, а без него в интерактивной
+    // игре - сразу текстом
+    void emit(const Events::Event& event) const {
+        if (Events::Stream* stream = events.get()) {
+            stream->publish(event);
+        } else if (interactive) {
+            Events::writeText(event, std::cout);
+        }
+    }
+    
+    // Перед выводом в терминал мимо потока событий ждем, пока поток
+    // напечатает все, что было раньше
+    void flushEvents() const {
+        if (Events::Stream* stream = events.get()) stream->flush();
+    }
+    
+    // Сообщения правил идут в терминал только в интерактивной игре
+    std::ostream& out() const {
+        if (!interactive) return ColorManager::nullStream();
+        flushEvents();
+        return std::cout;
+    }
+    
+    void pause() const {
+        if (!interactive) return;
+        flushEvents();
+        ColorManager::waitForEnter();
+    }
+    
+    char askDirection(const char* prompt) const {
+        if (!interactive) return 0;
+        flushEvents();
+        std::cout << prompt;
+        char direction = _getch();
+        std::cout << direction << std::endl;
+        return direction;
+    }
+    
+    // Установка параметров в зависимости от размера поля
+    void setGameParameters() {
+        if (size == Constants::BOARD_SIZE_SMALL) {
+            visibilityRadius = Constants::VISIBILITY_RADIUS_SMALL;
+            scoutingRadius = Constants::SCOUTING_RADIUS_SMALL;
+            initialTerritorySize = Constants::INITIAL_TERRITORY_SIZE_SMALL;
+            sabotageDivisor = Constants::SABOTAGE_DIVISOR_SMALL;
+            minSabotage = Constants::MIN_SABOTAGE_SMALL;
+        } else if (size == Constants::BOARD_SIZE_MEDIUM) {
+            visibilityRadius = Constants::VISIBILITY_RADIUS_MEDIUM;
+            scoutingRadius = Constants::SCOUTING_RADIUS_MEDIUM;
+            initialTerritorySize = Constants::INITIAL_TERRITORY_SIZE_MEDIUM;
+            sabotageDivisor = Constants::SABOTAGE_DIVISOR_MEDIUM;
+            minSabotage = Constants::MIN_SABOTAGE_MEDIUM;
+        } else { // size == Constants::BOARD_SIZE_LARGE
+            visibilityRadius = Constants::VISIBILITY_RADIUS_LARGE;
+            scoutingRadius = Constants::SCOUTING_RADIUS_LARGE;
+            initialTerritorySize = Constants::INITIAL_TERRITORY_SIZE_LARGE;
+            sabotageDivisor = Constants::SABOTAGE_DIVISOR_LARGE;
+            minSabotage = Constants::MIN_SABOTAGE_LARGE;
+        }
+    }
+    
+    // Рабочие буферы правил под размер поля. Размер меняется только при
+    // первом вызове и после копирования партии.
+    void sizeScratchBuffers() {
+        int cells = size * size;
+        neutralParent.resize(cells);
+        neutralLabel.resize(cells);
+        neutralContacts.resize(cells);
+        neutralRegionCells.resize(cells);
+        neutralRegionPoints.resize(cells);
+        ownerSnapshot.resize(cells);
+        // Полоса меняет каждую свою клетку не больше раза за проход
+        int rows = Constants::PARALLEL_BAND_ROWS;
+        bandEdits.resize((size + rows - 1) / rows);
+        for (auto& band : bandEdits) band.reserve(rows * size);
+    }
+    
+    // Выполняет fn(fromX, toX) по полосам строк. Маленькие поля (16x16)
+    // обрабатываются одним вызовом в текущем потоке, большие - на общем пуле.
+    // Каждая полоса пишет только в свои строки, поэтому результат не зависит
+    // от числа потоков. В текущем потоке fn вызывается напрямую, без
+    // std::function и без выделения памяти.
+    template <typename Fn>
+    void forEachBand(const Fn& fn) const {
+        if (!parallelBands || size * size < Constants::PARALLEL_MIN_CELLS) {
+            fn(0, size);
+            return;
+        }
+        ThreadPool::instance().parallelFor(0, size, Constants::PARALLEL_BAND_ROWS, [&fn](int fromX, int toX) {
+            PROFILE_SCOPE("band");
+            fn(fromX, toX);
+        });
+    }
+    
+    // Все изменения владельца, укреплений и диверсий проходят внутри
+    // CellEdit: он запоминает клетку при создании и, если ее открытое
+    // состояние изменилось, при выходе из блока передает разницу в
+    // applyEdit(). Внутри forEachBand() разница копится в буфере полосы и
+    // применяется после прохода (mergeBandEdits()).
+    class CellEdit {
+    private:
+        Game& game;
+        std::vector<CellDiff>* band;
+        uint16_t x, y;
+        uint16_t before;
+        
+    public:
+        CellEdit(Game& owner, int cx, int cy, std::vector<CellDiff>* bandBuffer = nullptr) :
+            game(owner), band(bandBuffer),
+            x(static_cast<uint16_t>(cx)), y(static_cast<uint16_t>(cy)),
+            before(packCell(owner.board.at(cx, cy))) {}
+        
+        ~CellEdit() {
+            uint16_t after = packCell(game.board.at(x, y));
+            if (after == before) {
+                // Туман и исследованность клетки могли измениться и без
+                // разницы открытого состояния
+                if (!band) game.markDirty(x, y);
+                return;
+            }
+            if (band) band->push_back({x, y, before, after});
+            else game.applyEdit({x, y, before, after});
+        }
+        
+        CellEdit(const CellEdit&) = delete;
+        CellEdit& operator=(const CellEdit&) = delete;
+    };
+    
+    class EditCauseScope {
+    private:
+        Game& game;
+        uint8_t saved;
+        
+    public:
+        EditCauseScope(Game& owner, EditCause cause) : game(owner), saved(owner.editCause) {
+            game.editCause = cause;
+        }
+        ~EditCauseScope() { game.editCause = saved; }
+        
+        EditCauseScope(const EditCauseScope&) = delete;
+        EditCauseScope& operator=(const EditCauseScope&) = delete;
+    };
+    
+    // Пересчитывает, засчитана ли клетка границе владельца: достаточно
+    // проверить ее четырех соседей, поэтому изменение клетки обходится
+    // пятью такими пересчетами
+    void refreshFrontier(int x, int y) {
+        int owner = board.at(x, y).ownerId;
+        uint8_t flag = 0;
+        if (owner != 0) {
+            if ((x > 0 && board.at(x-1, y).ownerId != owner) || (x + 1 < size && board.at(x+1, y).ownerId != owner) ||
+                (y > 0 && board.at(x, y-1).ownerId != owner) || (y + 1 < size && board.at(x, y+1).ownerId != owner)) {
+                flag = static_cast<uint8_t>(owner);
+            }
+        }
+        uint8_t counted = frontierOwner[x * size + y];
+        if (counted == flag) return;
+        if (counted != 0) stats[counted - 1].frontier--;
+        if (flag != 0) stats[flag - 1].frontier++;
+        frontierOwner.edit(x * size + y) = flag;
+    }
+    
+    // Одно изменение клетки: журнал и счетчики игроков за O(1), поля
+    // расстояний до королей - локальной починкой
+    void applyEdit(const CellDiff& diff) {
+        if (journalEnabled) cellJournal.push_back(diff);
+        markDirty(diff.x, diff.y);
+        ++boardVersion;
+        
+        Cell before, after;
+        unpackCell(diff.before, before);
+        unpackCell(diff.after, after);
+        if (before.ownerId != 0) {
+            stats[before.ownerId - 1].territory--;
+            if (before.isFortified) stats[before.ownerId - 1].fortified--;
+        }
+        if (after.ownerId != 0) {
+            stats[after.ownerId - 1].territory++;
+            if (after.isFortified) stats[after.ownerId - 1].fortified++;
+        }
+        if (before.ownerId != after.ownerId || before.isFortified != after.isFortified) {
+            threats.cellChanged(diff.x, diff.y, after.ownerId, after.isFortified);
+            moves.cellChanged(diff.x, diff.y, after.ownerId, after.isFortified);
+        }
+        if (before.ownerId == after.ownerId) return;
+        
+        if (before.ownerId != 0) shiftVision(before.ownerId, diff.x, diff.y, -1);
+        if (after.ownerId != 0) shiftVision(after.ownerId, diff.x, diff.y, +1);
+        if (after.ownerId != 0) {
+            PlayerStats& gainer = stats[after.ownerId - 1];
+            if (before.sabotageCell && !after.sabotageCell) gainer.sabotagePoints += before.sabotageValue;
+            if (editCause == EDIT_AUTO_CAPTURE) gainer.autoCaptured++;
+        } else if (before.ownerId != 0) {
+            if (editCause == EDIT_BOMB) stats[before.ownerId - 1].lostToBombs++;
+            if (editCause == EDIT_ARTILLERY) stats[before.ownerId - 1].lostToArtillery++;
+        }
+        
+        refreshFrontier(diff.x, diff.y);
+        if (diff.x > 0) refreshFrontier(diff.x - 1, diff.y);
+        if (diff.x + 1 < size) refreshFrontier(diff.x + 1, diff.y);
+        if (diff.y > 0) refreshFrontier(diff.x, diff.y - 1);
+        if (diff.y + 1 < size) refreshFrontier(diff.x, diff.y + 1);
+    }
+    
+    // Видимость игрока playerId: квадрат радиуса видимости вокруг клетки
+    // (x, y), которая стала (sign = 1) или перестала (-1) быть его. Так
+    // слой меняется на O(r^2) за измененную клетку, а не пересчитывается
+    // по всему полю каждый ход.
+    void shiftVision(int playerId, int x, int y, int sign) {
+        int r = visibilityRadius;
+        CowGrid<uint16_t>& layer = visionCount[playerId - 1];
+        int fromY = std::max(0, y - r), toY = std::min(size - 1, y + r);
+        for (int nx = std::max(0, x - r); nx <= std::min(size - 1, x + r); ++nx) {
+            uint16_t* row = layer.editRow(nx);
+            for (int ny = fromY; ny <= toY; ++ny) row[ny] = static_cast<uint16_t>(row[ny] + sign);
+        }
+    }
+    
+    const CowGrid<uint16_t>& visionLayer(int playerId) const {
+        return visionCount[playerId - 1];
+    }
+    
+    // Выполняет fn(player) для каждого игрока (индекс с 0). Слои игроков не
+    // пересекаются, поэтому на больших полях они считаются параллельно.
+    template <typename Fn>
+    void forEachPlayer(const Fn& fn) const {
+        if (!parallelBands || size * size < Constants::PARALLEL_MIN_CELLS) {
+            for (int p = 0; p < playerCount; ++p) fn(p);
+            return;
+        }
+        ThreadPool::instance().parallelFor(0, playerCount, 1, [&fn](int from, int to) {
+            PROFILE_SCOPE("player");
+            for (int p = from; p < to; ++p) fn(p);
+        });
+    }
+    
+    // Счетчики, слои видимости и поля расстояний с нуля по всему полю -
+    // только при создании партии
+    void recountStats() {
+        invalidateDerived();
+        for (auto& s : stats) s = PlayerStats();
+        frontierOwner.assign(static_cast<size_t>(size) * size, 0);
+        int kingsX[Constants::MAX_PLAYERS], kingsY[Constants::MAX_PLAYERS];
+        for (int p = 0; p < playerCount; ++p) {
+            kingsX[p] = players[p].kingX;
+            kingsY[p] = players[p].kingY;
+        }
+        threats.reset(size, playerCount, kingsX, kingsY);
+        moves.reset(size, playerCount);
+        visibleTo.reset(size, 0);
+        for (int p = 0; p < Constants::MAX_PLAYERS; ++p) {
+            if (p < playerCount) visionCount[p].reset(size, 0);
+            else visionCount[p].clear();
+        }
+        forEachPlayer([&](int p) {
+            for (int x = 0; x < size; ++x) {
+                for (int y = 0; y < size; ++y) {
+                    if (board.at(x, y).ownerId == p + 1) shiftVision(p + 1, x, y, +1);
+                }
+            }
+        });
+        for (int x = 0; x < size; ++x) {
+            for (int y = 0; y < size; ++y) {
+                const Cell& cell = board.at(x, y);
+                threats.setInitial(x, y, cell.ownerId, cell.isFortified);
+                moves.setInitial(x, y, cell.ownerId, cell.isFortified, cell.kingCell);
+                if (cell.ownerId == 0) continue;
+                stats[cell.ownerId - 1].territory++;
+                if (cell.isFortified) stats[cell.ownerId - 1].fortified++;
+                refreshFrontier(x, y);
+            }
+        }
+        threats.rebuild();
+        moves.rebuild();
+    }
+    
+    // Снимок счетчиков в историю; зовется в конце каждого хода
+    void recordTurnStats() {
+        StatsSample sample;
+        sample.turn = ++turnsPlayed;
+        for (int i = 0; i < playerCount; ++i) {
+            sample.scores[i] = players[i].score;
+            sample.players[i] = stats[i];
+        }
+        statsHistory.push(sample);
+        PROFILE_COUNTER("territory.p1", stats[0].territory);
+        PROFILE_COUNTER("territory.p2", stats[1].territory);
+        PROFILE_COUNTER("frontier.p1", stats[0].frontier);
+        PROFILE_COUNTER("frontier.p2", stats[1].frontier);
+    }
+    
+    // Буферы полос для изменений внутри forEachBand(): после прохода
+    // mergeBandEdits() применяет их по порядку полос, т.е. в том же
+    // порядке x, y, что дал бы последовательный обход. Граница клеток
+    // пересчитывается уже по итоговому полю, поэтому порядок ей не важен.
+    void prepareBandEdits() {
+        sizeScratchBuffers();
+        for (auto& band : bandEdits) band.clear();
+    }
+    
+    std::vector<CellDiff>* bandBuffer(int fromX) {
+        return &bandEdits[fromX / Constants::PARALLEL_BAND_ROWS];
+    }
+    
+    void mergeBandEdits() {
+        for (const auto& band : bandEdits) {
+            for (const CellDiff& diff : band) applyEdit(diff);
+        }
+    }
+    
+    // Клетка видна игроку playerId, если она в радиусе видимости от его
+    // территорий, а исследованные чужие клетки, короли и укрепления видны
+    // всегда
+    bool seenBy(int playerId, const Cell& cell, bool inVision) const {
+        return inVision || (cell.isExplored && ((cell.ownerId != 0 && cell.ownerId != playerId) ||
+                                                cell.kingCell || cell.isFortified));
+    }
+    
+    // Клетка изменилась: видимость вокруг нее устарела у всех игроков
+    void markDirty(int x, int y) {
+        for (int p = 0; p < playerCount; ++p) {
+            PlayerView& view = views[p];
+            view.dirtyFromX = std::min(view.dirtyFromX, x);
+            view.dirtyToX = std::max(view.dirtyToX, x);
+            view.dirtyFromY = std::min(view.dirtyFromY, y);
+            view.dirtyToY = std::max(view.dirtyToY, y);
+        }
+    }
+    
+    void clearDirty(PlayerView& view) {
+        view.dirtyFromX = view.dirtyFromY = size;
+        view.dirtyToX = view.dirtyToY = -1;
+    }
+    
+    void invalidateDerived() {
+        for (PlayerView& view : views) {
+            view.valid = false;
+            view.cursorX = view.cursorY = 0;
+            clearDirty(view);
+        }
+        territoriesStableAt = neutralStableAt = 0;
+    }
+    
+    // Видимость клеток [fromX, toX) x [fromY, toY) для текущего игрока по
+    // его слою видимости. Клетка пишется, только если что-то в ней
+    // меняется: плитки, общие с копиями партии, не копируются зря. true -
+    // впервые исследована хоть одна клетка: исследованные чужие клетки
+    // видны всем, так что у остальных игроков видимость тут устарела.
+    bool updateVisibility(int fromX, int toX, int fromY, int toY) {
+        PROFILE_SCOPE("updateVisibility");
+        int playerId = currentPlayer + 1;
+        uint8_t bit = static_cast<uint8_t>(1u << currentPlayer);
+        const CowGrid<uint16_t>& vision = visionLayer(playerId);
+        bool explored = false;
+        for (int x = fromX; x < toX; ++x) {
+            for (int y = fromY; y < toY; ++y) {
+                const Cell& cell = board.at(x, y);
+                bool inVision = vision.at(x, y) != 0;
+                bool visible = seenBy(playerId, cell, inVision);
+                if (((visibleTo.at(x, y) & bit) != 0) != visible) visibleTo.edit(x, y) ^= bit;
+                if (!inVision || (cell.isExplored && cell.lastSeenOwner == cell.ownerId)) continue;
+                explored = explored || !cell.isExplored;
+                Cell& target = board.edit(x, y);
+                target.isExplored = true;
+                target.lastSeenOwner = target.ownerId;
+            }
+        }
+        return explored;
+    }
+    
+    void showCell(int x, int y) {
+        uint8_t bit = static_cast<uint8_t>(1u << currentPlayer);
+        if (!(visibleTo.at(x, y) & bit)) visibleTo.edit(x, y) |= bit;
+    }
+    
+    // Королевская клетка текущего игрока и клетка курсора видны всегда
+    void showKingAndCursor() {
+        const Player& player = players[currentPlayer];
+        showCell(player.kingX, player.kingY);
+        showCell(player.cursorX, player.cursorY);
+    }
+    
+    // Нейтральная клетка, через которую растет область для автозахвата
+    bool isOpenNeutral(int x, int y) const {
+        const Cell& cell = board.at(x, y);
+        return cell.ownerId == 0 && !cell.isFortified;
+    }
+    
+    // Корень системы непересекающихся множеств. Корнем всегда остается
+    // наименьший индекс области, т.е. ее первая клетка в порядке обхода x, y.
+    // Путь укорачивается делением пополам: клетка перевешивается на деда.
+    // Полосы на последнем проходе ищут корни одновременно, поэтому
+    // перевешивание идет через CAS - проигравший просто идет дальше, а
+    // любой записанный дед остается предком, и корень не меняется.
+    int findNeutralRoot(int i) {
+        int parent = neutralParent[i].load(std::memory_order_relaxed);
+        while (parent != i) {
+            int grandparent = neutralParent[parent].load(std::memory_order_relaxed);
+            if (grandparent != parent) {
+                neutralParent[i].compare_exchange_weak(parent, grandparent, std::memory_order_relaxed);
+            }
+            i = grandparent;
+            parent = neutralParent[i].load(std::memory_order_relaxed);
+        }
+        return i;
+    }
+    
+    void uniteNeutral(int a, int b) {
+        a = findNeutralRoot(a);
+        b = findNeutralRoot(b);
+        if (a == b) return;
+        if (a < b) neutralParent[b].store(a, std::memory_order_relaxed);
+        else neutralParent[a].store(b, std::memory_order_relaxed);
+    }
+    
+    // Разметка 4-связных нейтральных областей в два прохода:
+    // 1) каждая полоса строк независимо склеивает клетки с соседями слева и
+    //    сверху внутри себя;
+    // 2) склеиваются пары клеток на стыках полос, после чего каждая клетка
+    //    получает метку - индекс корня своей области.
+    // Заодно для каждой области собирается маска контактов: край поля,
+    // укрепление и владельцы соседних клеток.
+    void labelNeutralRegions() {
+        int s = size;
+        sizeScratchBuffers();
+        
+        forEachBand([&](int fromX, int toX) {
+            for (int x = fromX; x < toX; ++x) {
+                for (int y = 0; y < s; ++y) {
+                    int i = x * s + y;
+                    neutralParent[i].store(i, std::memory_order_relaxed);
+                    neutralContacts[i].store(0, std::memory_order_relaxed);
+                    neutralRegionCells[i].store(0, std::memory_order_relaxed);
+                    neutralRegionPoints[i].store(0, std::memory_order_relaxed);
+                    if (!isOpenNeutral(x, y)) continue;
+                    if (y > 0 && isOpenNeutral(x, y - 1)) uniteNeutral(i, i - 1);
+                    if (x > fromX && isOpenNeutral(x - 1, y)) uniteNeutral(i, i - s);
+                }
+            }
+        });
+        
+        // Стыки полос: первая строка каждой полосы, кроме самой первой
+        int bandRows = (s * s < Constants::PARALLEL_MIN_CELLS) ? s : Constants::PARALLEL_BAND_ROWS;
+        for (int x = bandRows; x < s; x += bandRows) {
+            for (int y = 0; y < s; ++y) {
+                if (isOpenNeutral(x, y) && isOpenNeutral(x - 1, y)) {
+                    uniteNeutral(x * s + y, (x - 1) * s + y);
+                }
+            }
+        }
+        
+        forEachBand([&](int fromX, int toX) {
+            const int dx[] = {-1, 0, 1, 0};
+            const int dy[] = {0, -1, 0, 1};
+            for (int x = fromX; x < toX; ++x) {
+                for (int y = 0; y < s; ++y) {
+                    int i = x * s + y;
+                    if (!isOpenNeutral(x, y)) {
+                        neutralLabel[i] = -1;
+                        continue;
+                    }
+                    int root = findNeutralRoot(i);
+                    neutralLabel[i] = root;
+                    
+                    uint32_t contacts = 0;
+                    for (int d = 0; d < 4; ++d) {
+                        int nx = x + dx[d];
+                        int ny = y + dy[d];
+                        if (nx < 0 || nx >= s || ny < 0 || ny >= s) {
+                            contacts |= NEUTRAL_TOUCHES_EDGE;
+                        } else if (board.at(nx, ny).isFortified) {
+                            contacts |= NEUTRAL_TOUCHES_FORTIFICATION;
+                        } else if (board.at(nx, ny).ownerId != 0) {
+                            contacts |= neutralOwnerBit(board.at(nx, ny).ownerId);
+                        }
+                    }
+                    // Внутренние клетки области ничего не добавляют - не
+                    // нагружаем общий счетчик корня
+                    if (contacts != 0) {
+                        neutralContacts[root].fetch_or(contacts, std::memory_order_relaxed);
+                    }
+                }
+            }
+        });
+    }
+    
+    static constexpr uint32_t NEUTRAL_TOUCHES_EDGE = 1u << 0;
+    static constexpr uint32_t NEUTRAL_TOUCHES_FORTIFICATION = 1u << 1;
+    
+    static uint32_t neutralOwnerBit(int ownerId) {
+        return 1u << (1 + ownerId);
+    }
+    
+    // Владелец, окружающий область, или 0, если область не окружена: она не
+    // касается края поля и укреплений, а по соседству ровно один игрок
+    static int surroundingOwnerOf(uint32_t contacts) {
+        if (contacts & (NEUTRAL_TOUCHES_EDGE | NEUTRAL_TOUCHES_FORTIFICATION)) return 0;
+        uint32_t owners = contacts >> 2;
+        if (owners == 0 || (owners & (owners - 1)) != 0) return 0;
+        int ownerId = 1;
+        while ((owners & 1u) == 0) {
+            owners >>= 1;
+            ++ownerId;
+        }
+        return ownerId;
+    }
+    
+    // Захват окруженных нейтральных территорий
+    void captureSurroundedNeutralTerritories() {
+        derivedCounters.enclosureRequests++;
+        if (boardVersion == neutralStableAt) return;
+        derivedCounters.enclosureRuns++;
+        uint64_t startVersion = boardVersion;
+        int s = size;
+        bool capturedAny = false;
+        EditCauseScope cause(*this, EDIT_AUTO_CAPTURE);
+        PROFILE_SCOPE("captureSurroundedNeutralTerritories");
+        
+        labelNeutralRegions();
+        
+        // Один проход по клеткам: клетки окруженных областей переходят к
+        // владельцу, а размер области и очки копятся в ее корне
+        prepareBandEdits();
+        forEachBand([&](int fromX, int toX) {
+            std::vector<CellDiff>* edits = bandBuffer(fromX);
+            for (int x = fromX; x < toX; ++x) {
+                for (int y = 0; y < s; ++y) {
+                    int root = neutralLabel[x * s + y];
+                    if (root < 0) continue;
+                    int surroundingOwner = surroundingOwnerOf(neutralContacts[root].load(std::memory_order_relaxed));
+                    if (surroundingOwner == 0) continue;
+                    
+                    CellEdit edit(*this, x, y, edits);
+                    Cell& cell = board.edit(x, y);
+                    int pointsEarned = 1;
+                    // Если были саботажные клетки
+                    if (cell.sabotageCell) {
+                        pointsEarned += cell.sabotageValue;
+                        cell.sabotageCell = false;
+                        cell.sabotageValue = 0;
+                    }
+                    cell.ownerId = static_cast<uint8_t>(surroundingOwner);
+                    
+                    neutralRegionCells[root] += 1;
+                    neutralRegionPoints[root] += pointsEarned;
+                }
+            }
+        });
+        mergeBandEdits();
+        
+        // Сообщения и очки - в порядке обхода, как раньше при BFS
+        for (int root = 0; root < s * s; ++root) {
+            if (neutralRegionCells[root] == 0) continue;
+            int surroundingOwner = surroundingOwnerOf(neutralContacts[root].load(std::memory_order_relaxed));
+            int pointsEarned = neutralRegionPoints[root].load();
+            
+            players[surroundingOwner - 1].score += pointsEarned;
+            capturedAny = true;
+            
+            emit(Events::make(Events::AUTO_CAPTURE_REGION, surroundingOwner, root / s, root % s,
+                              neutralRegionCells[root].load(), pointsEarned));
+        }
+        
+        if (boardVersion == startVersion) neutralStableAt = boardVersion;
+        if (capturedAny) {
+            pause();
+        }
+    }
+    
+    // Захват окруженных территорий противника (старая механика)
+    void captureSurroundedTerritories() {
+        derivedCounters.enclosureRequests++;
+        if (boardVersion == territoriesStableAt) return;
+        derivedCounters.enclosureRuns++;
+        uint64_t startVersion = boardVersion;
+        int s = size;
+        EditCauseScope cause(*this, EDIT_AUTO_CAPTURE);
+        PROFILE_SCOPE("captureSurroundedTerritories");
+        
+        WorkBuffer<uint8_t>& temp = ownerSnapshot;
+        temp.resize(s * s);
+        forEachBand([&](int fromX, int toX) {
+            for (int x = fromX; x < toX; ++x) {
+                for (int y = 0; y < s; ++y) {
+                    temp[x * s + y] = board.at(x, y).ownerId;
+                }
+            }
+        });
+        
+        // Решение по клетке зависит только от снимка temp, поэтому полосы
+        // независимы; очки копим по полосам и складываем в конце
+        std::atomic<int> gained[Constants::MAX_PLAYERS] = {};
+        std::atomic<bool> capturedAny(false);
+        
+        prepareBandEdits();
+        forEachBand([&](int fromX, int toX) {
+            int bandGained[Constants::MAX_PLAYERS] = {};
+            bool bandCaptured = false;
+            std::vector<CellDiff>* edits = bandBuffer(fromX);
+            
+            for (int x = std::max(fromX, 1); x < std::min(toX, s-1); ++x) {
+                for (int y = 1; y < s-1; ++y) {
+                    if (temp[x * s + y] == 0 || board.at(x, y).isFortified) continue;
+                    
+                    uint8_t currentOwner = temp[x * s + y];
+                    uint8_t surroundingOwner = temp[(x-1) * s + y];
+                    
+                    const int dx[] = {-1, 0, 1, -1, 1, -1, 0, 1};
+                    const int dy[] = {-1, -1, -1, 0, 0, 1, 1, 1};
+                    
+                    bool surrounded = true;
+                    for (int i = 0; i < 8; ++i) {
+                        int nx = x + dx[i];
+                        int ny = y + dy[i];
+                        
+                        uint8_t neighbor = temp[nx * s + ny];
+                        if (neighbor == 0) {
+                            surrounded = false;
+                            break;
+                        }
+                        if (i == 0) {
+                            surroundingOwner = neighbor;
+                        } else if (neighbor != surroundingOwner) {
+                            surrounded = false;
+                            break;
+                        }
+                    }
+                    
+                    if (surrounded && surroundingOwner != 0 && surroundingOwner != currentOwner) {
+                        CellEdit edit(*this, x, y, edits);
+                        board.edit(x, y).ownerId = surroundingOwner;
+                        bandGained[surroundingOwner-1] += 2;
+                        bandCaptured = true;
+                    }
+                }
+            }
+            
+            if (bandCaptured) {
+                for (int i = 0; i < playerCount; ++i) gained[i] += bandGained[i];
+                capturedAny = true;
+            }
+        });
+        mergeBandEdits();
+        
+        for (int i = 0; i < playerCount; ++i) players[i].score += gained[i];
+        if (boardVersion == startVersion) territoriesStableAt = boardVersion;
+        
+        // В событии по-прежнему очки первых двух игроков: формат журнала
+        // событий общий для всех партий
+        if (capturedAny) {
+            emit(Events::make(Events::AUTO_CAPTURE_TERRITORY, 0, 0, 0, gained[0], gained[1]));
+        }
+    }
+    
+    // Короли равномерно по периметру поля по часовой стрелке от (0, 0).
+    // Для двух игроков - прежние противоположные углы.
+    void placeKings() {
+        int side = size - 1;
+        for (int p = 0; p < playerCount; ++p) {
+            int along = (4 * side * p + playerCount / 2) / playerCount;
+            int x, y;
+            if (along < side) { x = along; y = 0; }
+            else if (along < 2 * side) { x = side; y = along - side; }
+            else if (along < 3 * side) { x = 3 * side - along; y = side; }
+            else { x = 0; y = 4 * side - along; }
+            players[p] = Player(p + 1, x, y);
+        }
+        for (int p = playerCount; p < Constants::MAX_PLAYERS; ++p) players[p] = Player();
+    }
+    
+    // Сторона стартовой территории: территории соседних королей не должны
+    // пересекаться
+    int startTerritorySize() const {
+        int nearest = size;
+        for (int p = 0; p < playerCount; ++p) {
+            for (int q = p + 1; q < playerCount; ++q) {
+                nearest = std::min(nearest, std::max(std::abs(players[p].kingX - players[q].kingX),
+                                                     std::abs(players[p].kingY - players[q].kingY)));
+            }
+        }
+        return std::min({initialTerritorySize, size, (nearest + 1) / 2});
+    }
+    
+    // Стартовые территории - квадраты вокруг королей (у углового короля -
+    // угол поля)
+    void createInitialTerritories() {
+        int reach = startTerritorySize() - 1;
+        
+        for (int p = 0; p < playerCount; ++p) {
+            int kx = players[p].kingX, ky = players[p].kingY;
+            for (int x = std::max(0, kx - reach); x <= std::min(size - 1, kx + reach); ++x) {
+                for (int y = std::max(0, ky - reach); y <= std::min(size - 1, ky + reach); ++y) {
+                    if (!board.at(x, y).kingCell) {
+                        Cell& cell = board.edit(x, y);
+                        cell.ownerId = static_cast<uint8_t>(p + 1);
+                        cell.isExplored = true;
+                    }
+                }
+            }
+        }
+    }
+    
+    // Клетки диверсии и нейтральные препятствия по шаблону mapOptions.
+    // Генератор свой у потока, так что копии партии его не тащат.
+    void placeMap(uint32_t seed) {
+        MapGen::Params params;
+        params.size = size;
+        params.territory = startTerritorySize();
+        params.sabotage = std::max(minSabotage, (size * size) / sabotageDivisor);
+        params.obstacles = mapOptions.obstacles;
+        params.layout = mapOptions.layout;
+        const MapGen::Map& map = MapGen::Generator::local().generate(params, seed);
+        // Генератор знает только угловые территории: при трех и более
+        // игроках клетки на чужих стартовых территориях пропускаются
+        for (const MapGen::Sabotage& s : map.sabotage) {
+            Cell& cell = board.edit(s.cell / size, s.cell % size);
+            if (cell.ownerId != 0) continue;
+            cell.sabotageCell = true;
+            cell.sabotageValue = s.value;
+        }
+        for (uint32_t i : map.obstacles) {
+            Cell& cell = board.edit(i / size, i % size);
+            if (cell.ownerId == 0) cell.isFortified = true;
+        }
+    }
+    
+    // Видимость текущего игрока. Зовется после каждого действия, но
+    // пересчитывает только то, что могло измениться с прошлого пересчета
+    // этого игрока: клетки в радиусе видимости от изменившихся (их слой
+    // видимости сдвинулся) и клетки курсора. Все поле - только после сброса
+    // и при больших изменениях. Результат тот же, что у полного прохода:
+    // вне этой области ни слой, ни сами клетки не менялись. Доступность
+    // ходов ведет moves при каждом изменении клетки.
+    void updateAvailableMoves() {
+        derivedCounters.requests++;
+        const Player& player = players[currentPlayer];
+        PlayerView& view = views[currentPlayer];
+        bool cursorMoved = player.cursorX != view.cursorX || player.cursorY != view.cursorY;
+        bool dirty = view.dirtyFromX <= view.dirtyToX;
+        if (view.valid && !dirty && !cursorMoved) return;
+        PROFILE_SCOPE("updateAvailableMoves");
+        
+        int r = visibilityRadius;
+        int fromX = std::max(0, view.dirtyFromX - r), toX = std::min(size, view.dirtyToX + r + 1);
+        int fromY = std::max(0, view.dirtyFromY - r), toY = std::min(size, view.dirtyToY + r + 1);
+        bool full = !view.valid || (dirty && 2 * (toX - fromX) * (toY - fromY) > size * size);
+        bool explored = false;
+        if (full) {
+            derivedCounters.fullPasses++;
+            std::atomic<bool> bandExplored(false);
+            forEachBand([&](int bandFrom, int bandTo) {
+                if (updateVisibility(bandFrom, bandTo, 0, size)) bandExplored.store(true, std::memory_order_relaxed);
+            });
+            explored = bandExplored.load(std::memory_order_relaxed);
+            fromX = fromY = 0;
+            toX = toY = size;
+            showKingAndCursor();
+        } else {
+            derivedCounters.partialPasses++;
+            if (dirty) {
+                explored = updateVisibility(fromX, toX, fromY, toY);
+                derivedCounters.cellsRecomputed += static_cast<uint64_t>((toX - fromX) * (toY - fromY));
+            }
+            // Прежняя клетка курсора больше не видна принудительно
+            updateVisibility(view.cursorX, view.cursorX + 1, view.cursorY, view.cursorY + 1);
+            showKingAndCursor();
+            derivedCounters.cellsRecomputed += 2;
+        }
+        if (explored) {
+            markDirty(fromX, fromY);
+            markDirty(toX - 1, toY - 1);
+        }
+        
+        view.valid = true;
+        view.cursorX = player.cursorX;
+        view.cursorY = player.cursorY;
+        clearDirty(view);
+    }
+    
+    bool canCapture(int x, int y) const {
+        return moves.contains(currentPlayer, x, y);
+    }
+    
+    // Чей король стоит на клетке (индекс с 0), -1 - ничей
+    int kingOwnerAt(int x, int y) const {
+        for (int p = 0; p < playerCount; ++p) {
+            if (players[p].kingX == x && players[p].kingY == y) return p;
+        }
+        return -1;
+    }
+    
+    // Текущий игрок взял королевскую клетку (x, y). Вдвоем партия на этом
+    // кончается; при трех и более игроках хозяин короля выбывает, а партия
+    // кончается, когда в ней остается один игрок.
+    void captureKing(int x, int y) {
+        int capturer = currentPlayer + 1;
+        if (playerCount > 2) {
+            int owner = kingOwnerAt(x, y);
+            if (owner < 0 || players[owner].eliminated) return; // Этот король уже взят
+            players[owner].eliminated = true;
+            emit(Events::make(Events::PLAYER_ELIMINATED, owner + 1, x, y, capturer));
+            int remaining = 0;
+            for (int p = 0; p < playerCount; ++p) remaining += !players[p].eliminated;
+            if (remaining > 1) return;
+        }
+        gameOver = true;
+        winner = capturer;
+        emit(Events::make(Events::KING_CAPTURED, winner, x, y));
+    }
+    
+    // Бит p - игрок p (с 0) выбыл; для угроз королям (king_threat.h)
+    uint32_t eliminatedMask() const {
+        uint32_t mask = 0;
+        for (int p = 0; p < playerCount; ++p) {
+            if (players[p].eliminated) mask |= 1u << p;
+        }
+        return mask;
+    }
+    
+    // Ход переходит к следующему по кругу невыбывшему игроку
+    void advancePlayer() {
+        do {
+            currentPlayer = (currentPlayer + 1) % playerCount;
+        } while (players[currentPlayer].eliminated);
+    }
+    
+    // Невыбывший соперник, чей король ближе всего к клетке (индекс с 0)
+    int nearestEnemyKing(int x, int y) const {
+        int best = (currentPlayer + 1) % playerCount, bestDistance = -1;
+        for (int p = 0; p < playerCount; ++p) {
+            if (p == currentPlayer || players[p].eliminated) continue;
+            int d = std::max(std::abs(x - players[p].kingX), std::abs(y - players[p].kingY));
+            if (bestDistance < 0 || d < bestDistance) {
+                best = p;
+                bestDistance = d;
+            }
+        }
+        return best;
+    }
+    
+    bool captureCell() {
+        PROFILE_SCOPE("captureCell");
+        Player& player = players[currentPlayer];
+        
+        if (player.abilityUsedThisTurn) {
+            out() << "❌ Вы уже использовали способность в этом ходу!\n";
+            pause();
+            return false;
+        }
+        
+        int cursorX = player.cursorX;
+        int cursorY = player.cursorY;
+        
+        if (!canCapture(cursorX, cursorY)) {
+            out() << "❌ Нельзя захватить эту клетку!\n";
+            pause();
+            return false;
+        }
+        
+        // Проверяем, не укреплена ли клетка. Проверки читают поле без
+        // edit(): отказ не должен копировать общую с ветками плитку
+        if (board.at(cursorX, cursorY).isFortified) {
+            out() << "❌ Нельзя захватить укрепленную клетку! Используйте артиллерию.\n";
+            pause();
+            return false;
+        }
+        
+        Cell& cell = board.edit(cursorX, cursorY);
+        int sabotagePoints = 0;
+        int previousOwner = cell.ownerId;
+        {
+            CellEdit edit(*this, cursorX, cursorY);
+            if (cell.sabotageCell) {
+                sabotagePoints = cell.sabotageValue;
+                cell.sabotageCell = false;
+                cell.sabotageValue = 0;
+            }
+            
+            cell.ownerId = static_cast<uint8_t>(currentPlayer + 1);
+            cell.isExplored = true;
+        }
+        showCell(cursorX, cursorY);
+        
+        int pointsEarned = (previousOwner == 0) ? 1 : 2;
+        player.score += pointsEarned + sabotagePoints;
+        
+        if (sabotagePoints > 0) {
+            emit(Events::make(Events::SABOTAGE_COLLECTED, currentPlayer + 1, cursorX, cursorY, sabotagePoints));
+        }
+        emit(Events::make(Events::CELL_CAPTURED, currentPlayer + 1, cursorX, cursorY, previousOwner, sabotagePoints));
+        
+        if (cell.kingCell && previousOwner != currentPlayer + 1) {
+            captureKing(cursorX, cursorY);
+        }
+        
+        // Захватываем окруженные территории
+        captureSurroundedTerritories();
+        captureSurroundedNeutralTerritories();
+        updateAvailableMoves();
+        return true;
+    }
+    
+    void display() const {
+        PROFILE_SCOPE("display");
+        flushEvents();
+        ColorManager::clearScreen();
+        
+        const Player& player = players[currentPlayer];
+        int playerId = currentPlayer + 1;
+        int cursorX = player.cursorX;
+        int cursorY = player.cursorY;
+        
+        std::cout << ColorManager::get(1) << "=== CELL WARFARE ===\n";
+        std::cout << "🎯 Сейчас ходит: ";
+        
+        std::cout << ColorManager::get(ColorManager::playerColor(playerId)) << " ИГРОК " << playerId << " "
+                  << ColorManager::get(1);
+        
+        if (player.commanderActive) {
+            std::cout << " [💎 КОМАНДИР АКТИВЕН -35%]";
+        }
+        
+        if (player.abilityUsedThisTurn) {
+            std::cout << " [✋ СПОСОБНОСТЬ ИСПОЛЬЗОВАНА]";
+        } else {
+            std::cout << " [✅ СПОСОБНОСТЬ ДОСТУПНА]";
+        }
+        
+        std::cout << "\n";
+        
+        std::cout << "📊 Счет: ";
+        for (int i = 0; i < playerCount; ++i) {
+            if (i > 0) std::cout << " | ";
+            std::cout << ColorManager::get(ColorManager::playerColor(i + 1)) << " Игрок" << i + 1 << "="
+                      << players[i].score << (players[i].eliminated ? " (выбыл)" : "") << " " << ColorManager::get(1);
+        }
+        std::cout << "\n";
+        std::cout << "💎 Ваши очки: " << player.score << "\n";
+        std::cout << "🗺️ Территория: " << stats[currentPlayer].territory << " клеток, граница "
+                  << stats[currentPlayer].frontier << ", укреплено " << stats[currentPlayer].fortified << "\n";
+        uint32_t eliminated = eliminatedMask();
+        int attack = threats.threat(currentPlayer, eliminated);
+        int drop = threats.paratrooperThreat(currentPlayer, eliminated);
+        int danger = threats.danger(currentPlayer, eliminated);
+        std::cout << "👑 До " << (playerCount > 2 ? "ближайшего короля соперников: " : "короля соперника: ");
+        if (attack < 0) std::cout << "путь перекрыт";
+        else std::cout << attack << " захв.";
+        if (drop >= 0) std::cout << " (с Десантником: " << drop << ")";
+        std::cout << "\n";
+        if (danger >= 0 && danger <= Constants::KING_DANGER_DISTANCE) {
+            std::cout << "⚠️ Соперник в " << danger << " захв. от вашего короля!\n";
+        }
+        std::cout << "👁️ Видимость: " << visibilityRadius << " клетки от ваших территорий\n";
+        std::cout << "📏 Размер поля: " << size << "x" << size << "\n\n";
+        
+        // Для больших полей показываем только часть вокруг курсора
+        int displaySize = std::min(size, 20); // Максимум 20 клеток для отображения
+        int startX = std::max(0, static_cast<int>(cursorX) - displaySize/2);
+        int startY = std::max(0, static_cast<int>(cursorY) - displaySize/2);
+        int endX = std::min(size, startX + displaySize);
+        int endY = std::min(size, startY + displaySize);
+        // Соперник, чей король ближе всего к курсору, - для слоя расстояний
+        int target = nearestEnemyKing(cursorX, cursorY);
+        
+        if (size > 20) {
+            std::cout << "📋 Показана область " << startX << "," << startY 
+                      << " - " << endX-1 << "," << endY-1 
+                      << " (все поле " << size << "x" << size << ")\n";
+            std::cout << "📍 Курсор в центре области (" << cursorX << "," << cursorY << ")\n";
+        }
+        
+        std::cout << "   ";
+        for (int i = startX; i < endX; ++i) std::cout << i % 10 << " ";
+        std::cout << "\n";
+        
+        for (int y = startY; y < endY; ++y) {
+            std::cout << ColorManager::get(1) << y % 10 << " ";
+            for (int x = startX; x < endX; ++x) {
+                const Cell& cell = board.at(x, y);
+                
+                // Проверяем видимость
+                if (!isCellVisible(x, y)) {
+                    std::cout << ColorManager::get(9) << "? " << ColorManager::get(0);
+                    continue;
+                }
+                
+                if (x == cursorX && y == cursorY) {
+                    std::cout << ColorManager::get(8);
+                }
+                else if (isCellAvailable(x, y)) {
+                    std::cout << ColorManager::get(7);
+                }
+                else if (cell.isFortified) {
+                    std::cout << ColorManager::get(10); // Коричневый для укреплений
+                }
+                else if (cell.ownerId != 0) {
+                    std::cout << ColorManager::get(ColorManager::playerColor(cell.ownerId));
+                }
+                else {
+                    std::cout << ColorManager::get(6);
+                }
+                
+                if (cell.kingCell) {
+                    std::cout << (cell.ownerId == 1 ? "K" : "Q");
+                } else if (cell.sabotageCell) {
+                    std::cout << "O";
+                } else if (cell.isFortified) {
+                    std::cout << "S"; // S для укреплений (Stronghold)
+                } else if (threatOverlay && cell.ownerId != playerId &&
+                           threats.distance(target, x, y) >= 0 &&
+                           threats.distance(target, x, y) <= 9) {
+                    // Шагов от клетки до вражеского короля
+                    std::cout << threats.distance(target, x, y);
+                } else if (cell.ownerId != 0) {
+                    std::cout << static_cast<int>(cell.ownerId);
+                } else {
+                    std::cout << ".";
+                }
+                
+                std::cout << " " << ColorManager::get(0);
+            }
+            std::cout << ColorManager::get(1) << "\n";
+        }
+        
+        std::cout << "\n🎯 Управление: WASD - движение, Space - выбрать, E - способности, P - пропуск, T - угрозы";
+        if (hints) std::cout << ", H - подсказка";
+        std::cout << "\n";
+        std::cout << "📍 Курсор Игрока " << playerId << ": (" << cursorX << "," << cursorY << ")";
+        
+        const Cell& cursor = board.at(cursorX, cursorY);
+        bool cursorVisible = isCellVisible(cursorX, cursorY);
+        if (cursorVisible && isCellAvailable(cursorX, cursorY)) {
+            std::cout << " ✅ Доступно для захвата";
+        } else if (!cursorVisible) {
+            std::cout << " ❌ Невидимая клетка";
+        } else if (cursor.isFortified) {
+            std::cout << " 🏰 Укрепленная клетка (S)";
+        }
+        
+        std::cout << "\n👁️ Клетки с '?' невидимы (радиус видимости: " << visibilityRadius << " клетки)\n";
+        std::cout << "🔄 Нейтральные территории, окруженные одним игроком, захватываются автоматически!\n";
+        std::cout << "💣 Кассетная бомба: 2x2 | 🏰 Укрепления: 1x2 (только артиллерия, обозначение: S)\n";
+        std::cout << ColorManager::get(0);
+    }
+    
+    void displayAbilities() const {
+        ColorManager::clearScreen();
+        const Player& player = players[currentPlayer];
+        
+        std::cout << ColorManager::get(1) << "💪 СПОСОБНОСТИ ";
+        std::cout << ColorManager::get(ColorManager::playerColor(currentPlayer + 1)) << " Игрока "
+                  << currentPlayer + 1 << " " << ColorManager::get(1);
+        
+        if (player.abilityUsedThisTurn) {
+            std::cout << " [✋ УЖЕ ИСПОЛЬЗОВАНА В ЭТОМ ХОДУ]\n\n";
+        } else {
+            std::cout << " [✅ ДОСТУПНА]\n\n";
+        }
+        
+        for (int i = 0; i < NUM_ABILITIES; ++i) {
+            const auto& ability = ABILITIES[i];
+            int actualCost = player.getAbilityCost(ability.baseCost);
+            
+            std::cout << i + 1 << ". " << ability.name << " - " << actualCost << " очков";
+            if (actualCost != ability.baseCost) {
+                std::cout << " (базовая: " << ability.baseCost << ")";
+            }
+            if (i == 3 && player.commanderActive) {
+                std::cout << " [💎 АКТИВЕН]";
+            }
+            
+            if (player.abilityUsedThisTurn) {
+                std::cout << " ❌ НЕДОСТУПНО (способность уже использована)";
+            } else if (!player.canUseAbility(ability.baseCost)) {
+                std::cout << " ❌ НЕДОСТУПНО (недостаточно очков)";
+            } else {
+                std::cout << " ✅ ДОСТУПНО";
+            }
+            
+            std::cout << "\n   " << ability.description << "\n";
+            
+            if (abilitiesUsed[i] > 0) {
+                std::cout << "   Использовано: " << abilitiesUsed[i] << " раз\n";
+            }
+            std::cout << "\n";
+        }
+        
+        if (player.abilityUsedThisTurn) {
+            std::cout << "\n⚠️ Вы уже использовали способность в этом ходу!\n";
+            std::cout << "Нажмите любую клавишу для возврата..." << ColorManager::get(0);
+            _getch();
+            return;
+        }
+        
+        std::cout << "Выберите способность (1-7) или 0 для отмены: " << ColorManager::get(0);
+    }
+    
+    bool useCommander() {
+        players[currentPlayer].commanderActive = true;
+        out() << "💎 КОМАНДИР АКТИВИРОВАН! Стоимость способностей снижена на 35%!\n";
+        return true;
+    }
+    
+    static bool directionStep(char direction, int& dx, int& dy) {
+        dx = dy = 0;
+        switch (direction) {
+            case 'w': case 'W': dy = -1; return true;
+            case 's': case 'S': dy = 1; return true;
+            case 'a': case 'A': dx = -1; return true;
+            case 'd': case 'D': dx = 1; return true;
+            default: return false;
+        }
+    }
+    
+    // Шаги i из [from, to], при которых c + d * i остается на поле
+    void clipLine(int c, int d, int& from, int& to) const {
+        if (d > 0) {
+            from = std::max(from, -c);
+            to = std::min(to, size - 1 - c);
+        } else if (d < 0) {
+            from = std::max(from, c - (size - 1));
+            to = std::min(to, c);
+        }
+    }
+    
+    int stencilScale(const AbilityStencil& st) const {
+        return st.scoutingScale ? scoutingRadius : 1;
+    }
+    
+    // Клеток в трафарете без обрезки по полю
+    int stencilCells(const AbilityStencil& st) const {
+        int side = (st.to - st.from) * stencilScale(st) + 1;
+        return st.shape == StencilShape::RECT ? side * side : side;
+    }
+    
+    // fn(nx, ny) для клеток трафарета с целью (x, y), уже обрезанного по
+    // полю: квадрат - по x, затем по y, линия - от цели по направлению.
+    // С clipped = false - все клетки трафарета, в том числе за краем поля
+    template <typename Fn>
+    void forStencil(const AbilityStencil& st, int x, int y, int dx, int dy, const Fn& fn,
+                    bool clipped = true) const {
+        if (st.shape == StencilShape::RECT) {
+            int scale = stencilScale(st);
+            int fromX = x + st.from * scale, toX = x + st.to * scale;
+            int fromY = y + st.from * scale, toY = y + st.to * scale;
+            if (clipped) {
+                fromX = std::max(0, fromX);
+                toX = std::min(size - 1, toX);
+                fromY = std::max(0, fromY);
+                toY = std::min(size - 1, toY);
+            }
+            for (int nx = fromX; nx <= toX; ++nx) {
+                for (int ny = fromY; ny <= toY; ++ny) fn(nx, ny);
+            }
+        } else if (st.shape == StencilShape::LINE) {
+            int from = st.from, to = st.to;
+            if (clipped) {
+                clipLine(x, dx, from, to);
+                clipLine(y, dy, from, to);
+            }
+            for (int i = from; i <= to; ++i) fn(x + dx * i, y + dy * i);
+        }
+    }
+    
+    struct AreaResult {
+        int cells = 0;
+        int fortifications = 0;
+    };
+    
+    // Подходит ли клетка под действие Effect; неподходящая пропускается,
+    // а в трафарете allOrNothing отменяет способность
+    template <AreaEffect Effect>
+    static bool cellAccepts(const Cell& cell, int playerId) {
+        if constexpr (Effect == AreaEffect::CAPTURE) {
+            return !cell.isFortified;
+        } else if constexpr (Effect == AreaEffect::NEUTRALIZE) {
+            return !cell.kingCell;
+        } else if constexpr (Effect == AreaEffect::FORTIFY) {
+            return cell.ownerId == playerId && !cell.isFortified && !cell.kingCell;
+        }
+        return true;
+    }
+    
+    // Изменит ли Effect открытое состояние подходящей клетки
+    template <AreaEffect Effect>
+    static bool cellChanges(const Cell& cell, int playerId) {
+        if constexpr (Effect == AreaEffect::CAPTURE) {
+            return cell.ownerId != playerId || cell.sabotageCell;
+        } else if constexpr (Effect == AreaEffect::NEUTRALIZE) {
+            return cell.ownerId != 0 || cell.isFortified || cell.sabotageCell;
+        } else if constexpr (Effect == AreaEffect::FORTIFY) {
+            return true;
+        }
+        return false;
+    }
+    
+    // cellAccepts() для текущего игрока; отказ печатается текстом способности
+    template <AreaEffect Effect>
+    bool acceptsCell(const AbilityStencil& st, int nx, int ny) const {
+        const Cell& cell = board.at(nx, ny);
+        if (cellAccepts<Effect>(cell, currentPlayer + 1)) return true;
+        if constexpr (Effect == AreaEffect::CAPTURE) {
+            if (st.fortifiedCell) {
+                out() << st.fortifiedCell;
+                if (st.namesCell) out() << " (" << nx << "," << ny << ")";
+                out() << "!\n";
+            }
+        } else if constexpr (Effect == AreaEffect::FORTIFY) {
+            if (cell.ownerId != currentPlayer + 1) {
+                out() << "❌ Клетка (" << nx << "," << ny << ") не принадлежит вам!\n";
+            } else if (cell.isFortified) {
+                out() << "❌ Клетка (" << nx << "," << ny << ") уже укреплена!\n";
+            } else {
+                out() << "❌ Нельзя укреплять королевскую клетку!\n";
+            }
+        }
+        return false;
+    }
+    
+    // Цель (x, y) не ближе st.kingClearance к королям соперников игрока
+    // player (с 0)
+    bool clearOfEnemyKings(const AbilityStencil& st, int player, int x, int y) const {
+        if (st.kingClearance == 0) return true;
+        for (int p = 0; p < playerCount; ++p) {
+            const Player& other = players[p];
+            if (p == player || other.eliminated) continue;
+            int distance = std::max(std::abs(x - static_cast<int>(other.kingX)),
+                                    std::abs(y - static_cast<int>(other.kingY)));
+            if (distance < st.kingClearance) return false;
+        }
+        return true;
+    }
+    
+    // Примерка applyStencil<Effect>() без изменения поля (см. previewAbility())
+    template <AreaEffect Effect, typename Fn>
+    bool previewStencil(int ability, int player, int x, int y, int dx, int dy, const Fn& fn) const {
+        const AbilityStencil& st = ABILITY_STENCILS[ability];
+        int playerId = player + 1;
+        if (st.allOrNothing) {
+            int inside = 0;
+            bool accepted = true;
+            forStencil(st, x, y, dx, dy, [&](int nx, int ny) {
+                ++inside;
+                accepted = accepted && cellAccepts<Effect>(board.at(nx, ny), playerId);
+            });
+            if (!accepted || inside < stencilCells(st)) return false;
+        }
+        bool changed = false;
+        forStencil(st, x, y, dx, dy, [&](int nx, int ny) {
+            const Cell& cell = board.at(nx, ny);
+            if (!cellAccepts<Effect>(cell, playerId) || !cellChanges<Effect>(cell, playerId)) return;
+            changed = true;
+            fn(nx, ny);
+        });
+        return changed;
+    }
+    
+    // Действие Effect на одну клетку способности ability
+    template <AreaEffect Effect>
+    void applyCell(int ability, int nx, int ny, AreaResult& result) {
+        Cell& cell = board.edit(nx, ny);
+        int playerId = currentPlayer + 1;
+        result.cells++;
+        if constexpr (Effect == AreaEffect::REVEAL) {
+            // Открытое состояние не меняется - журналу и счетчикам нечего сообщать
+            cell.isExplored = true;
+            cell.lastSeenOwner = cell.ownerId;
+            showCell(nx, ny);
+            markDirty(nx, ny);
+        } else {
+            int previousOwner = cell.ownerId;
+            {
+                CellEdit edit(*this, nx, ny);
+                if constexpr (Effect == AreaEffect::CAPTURE) {
+                    if (cell.sabotageCell) {
+                        emit(Events::make(Events::SABOTAGE_COLLECTED, playerId, nx, ny, cell.sabotageValue));
+                        players[currentPlayer].score += cell.sabotageValue;
+                    }
+                    cell.ownerId = static_cast<uint8_t>(playerId);
+                } else if constexpr (Effect == AreaEffect::NEUTRALIZE) {
+                    if (cell.isFortified) {
+                        emit(Events::make(Events::FORTIFICATION_DESTROYED, playerId, nx, ny, 0, 0, ability));
+                        cell.isFortified = false;
+                        result.fortifications++;
+                    }
+                    if (cell.sabotageCell) {
+                        emit(Events::make(Events::SABOTAGE_DESTROYED, playerId, nx, ny, 0, 0, ability));
+                    }
+                    cell.ownerId = 0;
+                } else if constexpr (Effect == AreaEffect::FORTIFY) {
+                    cell.isFortified = true;
+                }
+                // Диверсия не переживает ни захвата, ни взрыва, ни укрепления
+                cell.sabotageCell = false;
+                cell.sabotageValue = 0;
+                cell.isExplored = true;
+            }
+            showCell(nx, ny);
+            // Обычным захватом короля не взять (canCapture()), только
+            // трафаретом Штурмовика - и только при трех и более игроках:
+            // правила партии на двоих этим не меняются
+            if constexpr (Effect == AreaEffect::CAPTURE) {
+                if (playerCount > 2 && cell.kingCell && previousOwner != playerId) captureKing(nx, ny);
+            }
+        }
+    }
+    
+    // Ядро всех способностей на поле: трафарет ability с целью (x, y)
+    template <AreaEffect Effect>
+    bool applyStencil(int ability, int x, int y, int dx, int dy, char direction) {
+        const AbilityStencil& st = ABILITY_STENCILS[ability];
+        if (st.allOrNothing) {
+            // Клетки проверяются по порядку, включая лежащие за краем поля:
+            // первая неподходящая отменяет способность
+            bool accepted = true;
+            forStencil(st, x, y, dx, dy, [&](int nx, int ny) {
+                if (!accepted) return;
+                if (!isOnBoard(nx, ny)) {
+                    out() << "❌ Клетка (" << nx << "," << ny << ") выходит за границы поля!\n";
+                    accepted = false;
+                } else {
+                    accepted = acceptsCell<Effect>(st, nx, ny);
+                }
+            }, false);
+            if (!accepted) {
+                if (st.pauseOnError) pause();
+                return false;
+            }
+        }
+        
+        EditCauseScope cause(*this, st.cause);
+        AreaResult result;
+        forStencil(st, x, y, dx, dy, [&](int nx, int ny) {
+            if (st.allOrNothing || acceptsCell<Effect>(st, nx, ny)) applyCell<Effect>(ability, nx, ny, result);
+        });
+        
+        if constexpr (Effect == AreaEffect::NEUTRALIZE) {
+            emit(Events::make(Events::AREA_DESTROYED, currentPlayer + 1, x, y, result.cells,
+                              st.reportFortifications ? result.fortifications : 0, ability));
+        } else if constexpr (Effect == AreaEffect::FORTIFY) {
+            out() << "✅ Укрепления (S) установлены в направлении " << direction << "!\n";
+            out() << "🏰 Клетки ";
+            int listed = 0;
+            forStencil(st, x, y, dx, dy, [&](int nx, int ny) {
+                out() << (listed++ > 0 ? " и (" : "(") << nx << "," << ny << ")";
+            });
+            out() << " теперь укреплены (S)\n";
+            out() << "⚠️ Укрепления (S) нельзя захватить обычным способом, только артиллерией!\n";
+        } else if constexpr (Effect == AreaEffect::REVEAL) {
+            out() << "Область теперь исследована!\n";
+        }
+        return true;
+    }
+    
+    // Способность ability по таблице ABILITY_STENCILS: проверки цели, затем
+    // ядро с нужным действием
+    bool applyAbility(int ability, int x, int y, char& direction) {
+        const AbilityStencil& st = ABILITY_STENCILS[ability];
+        PROFILE_SCOPE(st.profileName);
+        if (st.effect == AreaEffect::NONE) return useCommander();
+        
+        if (st.title) out() << st.title << " на клетке (" << x << "," << y << ")\n";
+        if (st.area) {
+            int side = (st.to - st.from) * stencilScale(st) + 1;
+            out() << st.area << side << "x" << side;
+            if (st.areaAtTarget) out() << " вокруг (" << x << "," << y << ")\n";
+            else out() << " клетки\n";
+        }
+        if (st.showPrice) {
+            out() << "Цена: " << players[currentPlayer].getAbilityCost(ABILITIES[ability].baseCost) << " очков\n";
+        }
+        
+        if (!clearOfEnemyKings(st, currentPlayer, x, y)) {
+            out() << "❌ Слишком близко к вражеской королевской клетке!\n";
+            if (st.pauseOnError) pause();
+            return false;
+        }
+        
+        int dx = 0, dy = 0;
+        if (st.shape == StencilShape::LINE) {
+            if (direction == 0) direction = askDirection(st.prompt);
+            if (!directionStep(direction, dx, dy)) {
+                out() << "❌ Неверное направление!\n";
+                if (st.pauseOnError) pause();
+                return false;
+            }
+        }
+        
+        switch (st.effect) {
+            case AreaEffect::CAPTURE: return applyStencil<AreaEffect::CAPTURE>(ability, x, y, dx, dy, direction);
+            case AreaEffect::NEUTRALIZE: return applyStencil<AreaEffect::NEUTRALIZE>(ability, x, y, dx, dy, direction);
+            case AreaEffect::FORTIFY: return applyStencil<AreaEffect::FORTIFY>(ability, x, y, dx, dy, direction);
+            case AreaEffect::REVEAL: return applyStencil<AreaEffect::REVEAL>(ability, x, y, dx, dy, direction);
+            default: return false;
+        }
+    }
+    
+    // direction нужен Штурмовику и Укреплениям; 0 - спросить у игрока
+    bool useAbility(int abilityIndex, char direction = 0) {
+        Player& player = players[currentPlayer];
+        
+        if (player.abilityUsedThisTurn) {
+            out() << "❌ Вы уже использовали способность в этом ходу!\n";
+            out() << "Можно использовать только одну способность за ход.\n";
+            pause();
+            return false;
+        }
+        
+        int cursorX = player.cursorX;
+        int cursorY = player.cursorY;
+        
+        if (abilityIndex < 0 || abilityIndex >= NUM_ABILITIES) {
+            out() << "❌ Неверный выбор способности!\n";
+            pause();
+            return false;
+        }
+        
+        const auto& ability = ABILITIES[abilityIndex];
+        if (!player.canUseAbility(ability.baseCost)) {
+            out() << "❌ Недостаточно очков или способность уже использована!\n";
+            pause();
+            return false;
+        }
+        
+        bool success = applyAbility(abilityIndex, cursorX, cursorY, direction);
+        
+        if (success) {
+            player.useAbility(ability.baseCost);
+            abilitiesUsed[abilityIndex]++;
+            if (journalEnabled) {
+                eventJournal.push_back({GameEvent::ABILITY_USED, static_cast<uint8_t>(currentPlayer + 1),
+                                        static_cast<uint8_t>(abilityIndex), direction,
+                                        static_cast<uint16_t>(cursorX), static_cast<uint16_t>(cursorY)});
+            }
+            out() << "✅ Способность использована успешно!\n";
+            out() << "⚠️ Теперь вы не можете использовать другие способности в этом ходу.\n";
+            
+            // После использования способности обновляем состояние
+            captureSurroundedTerritories();
+            captureSurroundedNeutralTerritories();
+            updateAvailableMoves();
+            pause();
+        }
+        
+        return success;
+    }
+    
+    void abilitiesMenu() {
+        Player& player = players[currentPlayer];
+        
+        if (player.abilityUsedThisTurn) {
+            std::cout << "❌ Вы уже использовали способность в этом ходу!\n";
+            std::cout << "Можно использовать только одну способность за ход.\n";
+            ColorManager::waitForEnter();
+            return;
+        }
+        
+        displayAbilities();
+        
+        if (player.abilityUsedThisTurn) {
+            return;
+        }
+        
+        char choice = _getch();
+        std::cout << choice << std::endl;
+        
+        if (choice == '0') {
+            return;
+        }
+        
+        int abilityIndex = choice - '1';
+        if (abilityIndex >= 0 && abilityIndex < NUM_ABILITIES) {
+            useAbility(abilityIndex);
+            updateAvailableMoves();
+        } else {
+            std::cout << "❌ Неверный выбор!\n";
+            ColorManager::waitForEnter();
+        }
+    }
+    
+    void playTurn() {
+        players[currentPlayer].resetTurn();
+        
+        updateAvailableMoves();
+        bool turnCompleted = false;
+        if (hints) hints->turnStarted(*this);
+        
+        while (!turnCompleted && !gameOver) {
+            display();
+            std::cout << "\nВыберите действие: ";
+            char choice;
+            {
+                PROFILE_SCOPE("input.wait");
+                choice = _getch();
+            }
+            std::cout << choice << std::endl;
+            
+            Player& player = players[currentPlayer];
+            
+            // Игрок действует - поиск подсказки останавливается; если ход
+            // не закончился, он продолжится с новой позиции
+            bool acting = choice == ' ' || choice == '\r' || choice == 'e' || choice == 'E' ||
+                          choice == 'p' || choice == 'P';
+            if (hints && acting) hints->turnEnded();
+            
+            switch (choice) {
+                case 'w': case 'W':
+                case 's': case 'S':
+                case 'a': case 'A':
+                case 'd': case 'D':
+                    player.moveCursor(choice, size);
+                    updateAvailableMoves(); // Курсор виден всегда: пересчет только двух клеток
+                    break;
+                    
+                case ' ': case '\r':
+                    if (captureCell()) {
+                        turnCompleted = true;
+                    }
+                    break;
+                    
+                case 'e': case 'E':
+                    abilitiesMenu();
+                    break;
+                    
+                case 'p': case 'P':
+                    std::cout << "⏭️ Ход пропущен.\n";
+                    ColorManager::waitForEnter();
+                    turnCompleted = true;
+                    break;
+                    
+                case 't': case 'T':
+                    threatOverlay = !threatOverlay;
+                    break;
+                    
+                case 'h': case 'H':
+                    if (hints) {
+                        hints->show(std::cout);
+                        ColorManager::waitForEnter();
+                        break;
+                    }
+                    std::cout << "❌ Неверная команда!\n";
+                    ColorManager::waitForEnter();
+                    break;
+                    
+                default:
+                    std::cout << "❌ Неверная команда!\n";
+                    ColorManager::waitForEnter();
+                    break;
+            }
+            
+            if (hints && acting && !turnCompleted && !gameOver) hints->turnStarted(*this);
+        }
+        
+        if (!gameOver) {
+            advancePlayer();
+        }
+        recordTurnStats();
+        turnObserver.notify(*this);
+    }
+    
+    void showStatistics() const {
+        flushEvents();
+        ColorManager::clearScreen();
+        std::cout << ColorManager::get(1) << "=== СТАТИСТИКА ИГРЫ ===\n\n";
+        std::cout << "📊 Итоговый счет:\n";
+        for (int i = 0; i < playerCount; ++i) {
+            std::cout << "Игрок " << i + 1 << ": " << players[i].score << " очков"
+                      << (players[i].eliminated ? " (выбыл)" : "") << "\n";
+        }
+        std::cout << "\n";
+        
+        std::cout << "💪 Использованные способности:\n";
+        for (int i = 0; i < NUM_ABILITIES; ++i) {
+            if (abilitiesUsed[i] > 0) {
+                std::cout << ABILITIES[i].name << ": " << abilitiesUsed[i] << " раз\n";
+            }
+        }
+        
+        std::cout << "\n🏰 Укрепления на поле (обозначение: S):\n";
+        for (int i = 0; i < playerCount; ++i) {
+            std::cout << "Игрок " << i + 1 << ": " << stats[i].fortified << " укрепленных клеток\n";
+        }
+        
+        std::cout << "\n🗺️ Территория и потери:\n";
+        for (int i = 0; i < playerCount; ++i) {
+            const PlayerStats& st = stats[i];
+            std::cout << "Игрок " << i + 1 << ": " << st.territory << " клеток, граница " << st.frontier
+                      << ", диверсии +" << st.sabotagePoints << ", автозахват " << st.autoCaptured
+                      << ", потеряно от бомб " << st.lostToBombs << ", от артиллерии " << st.lostToArtillery << "\n";
+        }
+        
+        std::cout << "\n🏆 Победитель: Игрок " << winner << "!\n";
+        
+        if (winner > 0) {
+            std::cout << "🎉 Поздравляем Игрока " << winner << " с победой!\n";
+        }
+        
+        std::cout << "\n📏 Размер поля: " << size << "x" << size << "\n";
+        ColorManager::waitForEnter();
+    }
+    
+    // Передача хода следующему игроку (для игры без терминала; в
+    // интерактивной игре то же самое делает playTurn())
+    void endTurn() {
+        if (!gameOver) {
+            advancePlayer();
+            players[currentPlayer].resetTurn();
+            updateAvailableMoves();
+        }
+        recordTurnStats();
+        turnObserver.notify(*this);
+    }
+    
+    // Курсор - часть видимости (клетка под ним всегда видна), поэтому ходы
+    // без терминала ставят его так же, как игрок стрелками
+    void moveCursorTo(int x, int y) {
+        Player& player = players[currentPlayer];
+        player.cursorX = static_cast<uint16_t>(x);
+        player.cursorY = static_cast<uint16_t>(y);
+        updateAvailableMoves();
+    }
+    
+    bool isOnBoard(int x, int y) const {
+        return x >= 0 && x < size && y >= 0 && y < size;
+    }
+    
+    static int clampPlayers(int count) {
+        return std::max(Constants::MIN_PLAYERS, std::min(Constants::MAX_PLAYERS, count));
+    }
+    
+public:
+    Game(int s) : Game(s, std::random_device{}(), true) {}
+    
+    Game(int s, uint32_t seed, bool interactiveMode) : 
+        size(s), playerCount(Constants::MIN_PLAYERS), interactive(interactiveMode), parallelBands(true), journalEnabled(false),
+        hints(nullptr), editCause(EDIT_DIRECT), turnsPlayed(0), threatOverlay(false) {
+        reset(seed);
+    }
+    
+    Game(int s, uint32_t seed, bool interactiveMode, const MapGen::Options& map,
+         int playerTotal = Constants::MIN_PLAYERS) : 
+        size(s), playerCount(clampPlayers(playerTotal)), interactive(interactiveMode), parallelBands(true),
+        mapOptions(map), journalEnabled(false),
+        hints(nullptr), editCause(EDIT_DIRECT), turnsPlayed(0), threatOverlay(false) {
+        reset(seed);
+    }
+    
+    // Новая партия того же размера на месте старой: поле и рабочие буферы
+    // переиспользуются, поэтому сброс не выделяет память
+    void reset(uint32_t seed) {
+        currentPlayer = 0;
+        gameOver = false;
+        winner = 0;
+        setGameParameters(); // Устанавливаем параметры в зависимости от размера
+        
+        for (int i = 0; i < NUM_ABILITIES; ++i) {
+            abilitiesUsed[i] = 0;
+        }
+        
+        placeKings();
+        
+        board.reset(size, Cell());
+        
+        // Инициализация королевских клеток
+        for (int p = 0; p < playerCount; ++p) {
+            Cell& king = board.edit(players[p].kingX, players[p].kingY);
+            king.kingCell = true;
+            king.ownerId = static_cast<uint8_t>(p + 1);
+            king.isExplored = true;
+        }
+        
+        createInitialTerritories();
+        placeMap(seed);
+        sizeScratchBuffers();
+        boardVersion = 1;
+        recountStats();
+        turnsPlayed = 0;
+        statsHistory.clear();
+        derivedCounters = DerivedCounters();
+        updateAvailableMoves();
+        clearJournal();
+    }
+    
+    // ============= ХОДЫ БЕЗ ТЕРМИНАЛА =============
+    // Захват клетки (x, y). При успехе ход переходит к сопернику.
+    bool playCapture(int x, int y) {
+        if (gameOver || !isOnBoard(x, y)) return false;
+        moveCursorTo(x, y);
+        if (!captureCell()) return false;
+        endTurn();
+        return true;
+    }
+    
+    // Способность на клетке (x, y); ход после нее продолжается, как и в
+    // интерактивной игре. direction - W/A/S/D для Штурмовика и Укреплений.
+    bool playAbility(int abilityIndex, int x, int y, char direction) {
+        if (gameOver || !isOnBoard(x, y)) return false;
+        moveCursorTo(x, y);
+        return useAbility(abilityIndex, direction);
+    }
+    
+    void playPass() {
+        endTurn();
+    }
+    
+    bool playAction(const Action& action) {
+        switch (action.kind) {
+            case Action::CAPTURE: return playCapture(action.x, action.y);
+            case Action::ABILITY: return playAbility(action.ability, action.x, action.y, action.direction);
+            case Action::PASS: playPass(); return true;
+        }
+        return false;
+    }
+    
+    // ============= ОТКАТ ХОДОВ =============
+    // Перебор (king_solver.h) ходит вперед и откатывается на той же партии,
+    // а не копирует ее на каждый узел. Точка отката - длины журналов и то,
+    // что меняется не через клетки: игроки, счетчики, очередь хода. Откат
+    // проигрывает журнал клеток назад через те же CellEdit, так что
+    // множества захватов, поля расстояний до королей и слои видимости
+    // чинятся сами. Туман (исследованность клеток) и история счетчиков не
+    // откатываются: на правила они не влияют.
+    struct UndoPoint {
+        size_t cells = 0;
+        size_t events = 0;
+        Player players[Constants::MAX_PLAYERS];
+        PlayerStats stats[Constants::MAX_PLAYERS];
+        int abilitiesUsed[NUM_ABILITIES] = {};
+        int currentPlayer = 0;
+        int winner = 0;
+        bool gameOver = false;
+        uint32_t turnsPlayed = 0;
+    };
+    
+    // Только с включенным журналом (setJournalEnabled()); до отката журнал
+    // не очищается
+    void saveUndo(UndoPoint& point) const {
+        point.cells = cellJournal.size();
+        point.events = eventJournal.size();
+        for (int p = 0; p < Constants::MAX_PLAYERS; ++p) {
+            point.players[p] = players[p];
+            point.stats[p] = stats[p];
+        }
+        for (int i = 0; i < NUM_ABILITIES; ++i) point.abilitiesUsed[i] = abilitiesUsed[i];
+        point.currentPlayer = currentPlayer;
+        point.winner = winner;
+        point.gameOver = gameOver;
+        point.turnsPlayed = turnsPlayed;
+    }
+    
+    void undo(const UndoPoint& point) {
+        journalEnabled = false;
+        for (size_t i = cellJournal.size(); i > point.cells; --i) {
+            const CellDiff& diff = cellJournal[i - 1];
+            CellEdit edit(*this, diff.x, diff.y);
+            unpackCell(diff.before, board.edit(diff.x, diff.y));
+        }
+        journalEnabled = true;
+        cellJournal.resize(point.cells);
+        eventJournal.resize(point.events);
+        for (int p = 0; p < Constants::MAX_PLAYERS; ++p) {
+            players[p] = point.players[p];
+            stats[p] = point.stats[p];
+        }
+        for (int i = 0; i < NUM_ABILITIES; ++i) abilitiesUsed[i] = point.abilitiesUsed[i];
+        currentPlayer = point.currentPlayer;
+        winner = point.winner;
+        gameOver = point.gameOver;
+        turnsPlayed = point.turnsPlayed;
+        updateAvailableMoves();
+    }
+    
+    // Клетки, которые изменила бы способность ability игрока player (с 0)
+    // с целью (x, y), без изменения поля и без проверки очков: fn(nx, ny)
+    // для каждой клетки, чье открытое состояние сменится. false - правила
+    // способность отклонят или она не изменит ничего, кроме тумана. Так
+    // перебор отбрасывает пустые способности, не играя их.
+    template <typename Fn>
+    bool previewAbility(int player, int ability, int x, int y, char direction, const Fn& fn) const {
+        if (ability < 0 || ability >= NUM_ABILITIES || !isOnBoard(x, y)) return false;
+        const AbilityStencil& st = ABILITY_STENCILS[ability];
+        if (st.effect == AreaEffect::NONE) return !players[player].commanderActive;
+        if (!clearOfEnemyKings(st, player, x, y)) return false;
+        int dx = 0, dy = 0;
+        if (st.shape == StencilShape::LINE && !directionStep(direction, dx, dy)) return false;
+        switch (st.effect) {
+            case AreaEffect::CAPTURE: return previewStencil<AreaEffect::CAPTURE>(ability, player, x, y, dx, dy, fn);
+            case AreaEffect::NEUTRALIZE:
+                return previewStencil<AreaEffect::NEUTRALIZE>(ability, player, x, y, dx, dy, fn);
+            case AreaEffect::FORTIFY: return previewStencil<AreaEffect::FORTIFY>(ability, player, x, y, dx, dy, fn);
+            default: return false;
+        }
+    }
+    
+    // Видимость клеток для игрока playerId (с 1) по тем же правилам, что и
+    // updateVisibility(), но без изменения поля: можно спросить про любого
+    // игрока, а не только про того, чей сейчас ход
+    void computeVisibility(int playerId, std::vector<uint8_t>& visible) const {
+        visible.resize(size * size);
+        const CowGrid<uint16_t>& vision = visionLayer(playerId);
+        const Player& player = players[playerId - 1];
+        forEachBand([&](int fromX, int toX) {
+            for (int x = fromX; x < toX; ++x) {
+                for (int y = 0; y < size; ++y) {
+                    visible[x * size + y] = seenBy(playerId, board.at(x, y), vision.at(x, y) != 0);
+                }
+            }
+        });
+        visible[player.kingX * size + player.kingY] = 1;
+        visible[player.cursorX * size + player.cursorY] = 1;
+    }
+    
+    // Журнал: изменения открытого состояния клеток и события способностей
+    // с момента последнего clearJournal(). По умолчанию выключен.
+    void setJournalEnabled(bool value) {
+        journalEnabled = value;
+        clearJournal();
+        // Обычно журнал держит один ход: место под все поле заранее, чтобы
+        // запись не выделяла память посреди партии
+        if (value) cellJournal.reserve(static_cast<size_t>(size) * size);
+    }
+    
+    const std::vector<CellDiff>& getCellJournal() const { return cellJournal; }
+    const std::vector<GameEvent>& getEventJournal() const { return eventJournal; }
+    
+    void clearJournal() {
+        cellJournal.clear();
+        eventJournal.clear();
+    }
+    
+    // События правил идут в stream (events.h), пока он не сброшен в nullptr.
+    // Поток должен жить дольше подключения.
+    void setEventStream(Events::Stream* stream) {
+        flushEvents();
+        events.set(stream);
+    }
+    
+    // Подсказки в интерактивной игре (hint.h); nullptr - выключены
+    void setHintProvider(HintProvider* provider) { hints = provider; }
+    
+    // Копии партии для перебора ходов не должны писать в терминал
+    void setInteractive(bool value) { interactive = value; }
+    
+    // Ветка партии для анализа "что если" (перебор ходов, подсказки, ветки
+    // зрителей) - копия без терминала. Поле и поклеточные счетчики ветка
+    // делит с партией (cow_grid.h): копирование стоит O(плиток), а ход в
+    // ветке копирует только плитки, которые меняет. Ветки можно вести в
+    // разных потоках, пока сама партия не меняется.
+    Game fork() const {
+        Game branch = *this;
+        branch.setInteractive(false);
+        return branch;
+    }
+    
+    // Позиция глазами игрока, чей сейчас ход: клетки, которых он не видит,
+    // заменяются тем, что он о них знает. Исследованная клетка остается за
+    // тем, за кем ее видели в последний раз, неисследованная считается
+    // нейтральной; диверсий под туманом не видно. Для перебора ходов за
+    // человека (hint.h): иначе он опирался бы на клетки, которых игрок не
+    // видит. Счетчики поля и слои пересчитываются заново.
+    void maskFog() {
+        for (int x = 0; x < size; ++x) {
+            for (int y = 0; y < size; ++y) {
+                if (isCellVisible(x, y) || board.at(x, y).kingCell) continue;
+                Cell& cell = board.edit(x, y);
+                cell.ownerId = cell.isExplored ? cell.lastSeenOwner : 0;
+                cell.isFortified = false;
+                cell.sabotageCell = false;
+                cell.sabotageValue = 0;
+            }
+        }
+        PlayerStats saved[Constants::MAX_PLAYERS];
+        for (int p = 0; p < Constants::MAX_PLAYERS; ++p) saved[p] = stats[p];
+        recountStats();
+        for (int p = 0; p < Constants::MAX_PLAYERS; ++p) {
+            stats[p].sabotagePoints = saved[p].sabotagePoints;
+            stats[p].lostToBombs = saved[p].lostToBombs;
+            stats[p].lostToArtillery = saved[p].lostToArtillery;
+            stats[p].autoCaptured = saved[p].autoCaptured;
+        }
+        ++boardVersion;
+        updateAvailableMoves();
+        clearJournal();
+    }
+    
+    // Все плитки своими, как у полной копии: для ветки, которая все равно
+    // перепишет все поле, и для сравнения с fork() в forkbench.cpp
+    void detach() {
+        board.detach();
+        for (auto& layer : visionCount) layer.detach();
+        visibleTo.detach();
+        frontierOwner.detach();
+        threats.detach();
+        moves.detach();
+    }
+    
+    // fn вызывается после каждого хода, в том числе последнего
+    void setTurnObserver(std::function<void(const Game&)> fn) { turnObserver.set(std::move(fn)); }
+    
+    // Когда параллельно идут сами партии (пакетная среда), правила каждой
+    // партии лучше считать в ее потоке
+    void setParallel(bool value) { parallelBands = value; }
+    
+    // Шаблон карты (см. map_gen.h) для следующих reset()
+    void setMapOptions(const MapGen::Options& options) { mapOptions = options; }
+    // Число игроков (MIN_PLAYERS-MAX_PLAYERS), как и карта, - со следующего reset()
+    void setPlayerCount(int count) { playerCount = clampPlayers(count); }
+    int getPlayerCount() const { return playerCount; }
+    const MapGen::Options& getMapOptions() const { return mapOptions; }
+    
+    int getSize() const { return size; }
+    // Размеры, для которых есть набор параметров (setGameParameters()): на
+    // любом другом партия молча получила бы параметры большого поля
+    static bool isKnownSize(int s) {
+        return s == Constants::BOARD_SIZE_SMALL || s == Constants::BOARD_SIZE_MEDIUM ||
+               s == Constants::BOARD_SIZE_LARGE;
+    }
+    const Cell& getCell(int x, int y) const { return board.at(x, y); }
+    // Туман и доступность - для игрока, чей сейчас ход
+    bool isCellVisible(int x, int y) const { return (visibleTo.at(x, y) >> currentPlayer) & 1; }
+    bool isCellAvailable(int x, int y) const { return moves.contains(currentPlayer, x, y); }
+    const Player& getPlayer(int index) const { return players[index]; }
+    int getCurrentPlayer() const { return currentPlayer; }
+    bool isGameOver() const { return gameOver; }
+    int getWinner() const { return winner; }
+    
+    // Клетки (x * size + y), которые может захватить текущий игрок, в
+    // произвольном порядке - без прохода по полю. Случайный захват -
+    // элемент по случайному индексу.
+    const std::vector<uint32_t>& getAvailableCells() const { return moves.capturable(currentPlayer); }
+    // То же для любого игрока (индекс с 0), не только того, чей ход
+    const std::vector<uint32_t>& getCapturableCells(int index) const { return moves.capturable(index); }
+    
+    // Живые счетчики игрока (индекс с 0), без прохода по полю
+    const PlayerStats& getStats(int index) const { return stats[index]; }
+    uint32_t getTurnsPlayed() const { return turnsPlayed; }
+    // Работа на видимость и автозахват с последнего reset()
+    const DerivedCounters& getDerivedCounters() const { return derivedCounters; }
+    
+    // Угроза королям (индексы игроков с 0), без BFS на каждый вызов:
+    // шагов от клетки до короля kingOwner, -1 - путь перекрыт укреплениями
+    int getKingDistance(int kingOwner, int x, int y) const { return threats.distance(kingOwner, x, y); }
+    // Захватов от ближайшей своей клетки до невыбывшего вражеского короля,
+    // -1 - пути нет
+    int getKingThreat(int index) const { return threats.threat(index, eliminatedMask()); }
+    // Захватов от ближайшей клетки любого невыбывшего соперника до короля игрока
+    int getKingDanger(int index) const { return threats.danger(index, eliminatedMask()); }
+    // То же, если начать с высадки Десантника
+    int getParatrooperThreat(int index) const { return threats.paratrooperThreat(index, eliminatedMask()); }
+    
+    void setThreatOverlay(bool value) { threatOverlay = value; }
+
+    // История счетчиков за последние turns ходов; 0 - не вести
+    void setStatsHistory(size_t turns) { statsHistory.setCapacity(turns); }
+    const StatsHistory& getStatsHistory() const { return statsHistory; }
+    
+    // История в CSV: строка на ход и игрока
+    void exportStatsCsv(std::ostream& os) const {
+        os << "turn,player,score,territory,fortified,frontier,sabotage_points,"
+              "lost_to_bombs,lost_to_artillery,auto_captured\n";
+        for (size_t i = 0; i < statsHistory.count(); ++i) {
+            const StatsSample& sample = statsHistory.at(i);
+            for (int p = 0; p < playerCount; ++p) {
+                const PlayerStats& st = sample.players[p];
+                os << sample.turn << ',' << p + 1 << ',' << sample.scores[p] << ',' << st.territory << ','
+                   << st.fortified << ',' << st.frontier << ',' << st.sabotagePoints << ','
+                   << st.lostToBombs << ',' << st.lostToArtillery << ',' << st.autoCaptured << '\n';
+            }
+        }
+    }
+    
+    void start() {
+        std::cout << ColorManager::get(1) << "\n=== Добро пожаловать в Cell Warfare! ===\n";
+        std::cout << "🎮 ОБНОВЛЕННЫЕ СПОСОБНОСТИ:\n";
+        std::cout << "💣 КАССЕТНАЯ БОМБА: теперь действует на область 2x2 клетки\n";
+        std::cout << "🏰 УКРЕПЛЕНИЯ: 2 клетки в выбранном направлении, цена 6 очков\n";
+        std::cout << "   - Обозначение: S (Stronghold)\n";
+        std::cout << "   - Нельзя захватить обычным способом\n";
+        std::cout << "   - Уничтожаются только артиллерией\n";
+        std::cout << "👁️  ТУМАН ВОЙНЫ: Видно только клетки в радиусе " 
+                  << visibilityRadius << " от ваших территорий\n";
+        std::cout << "🔄 АВТОЗАХВАТ: Нейтральные территории, окруженные одним игроком, захватываются автоматически\n";
+        std::cout << "✋ ОГРАНИЧЕНИЕ: только одна способность за ход!\n";
+        std::cout << "📏 РАЗМЕР ПОЛЯ: " << size << "x" << size << "\n";
+        std::cout << "Нажмите Enter чтобы начать игру..." << ColorManager::get(0);
+        ColorManager::waitForEnter();
+        
+        while (!gameOver) {
+            playTurn();
+        }
+        
+        display();
+        showStatistics();
+    }
+};
@@ -0,0 +1,370 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "bot.h"
+
+// ============= ПОДСКАЗКИ ВО ВРЕМЯ ХОДА =============
+// Пока человек думает над ходом, HintEngine перебирает позицию в своем
+// потоке и держит готовый список лучших ходов; клавиша H показывает его
+// сразу, без ожидания. Поиск идет по копии позиции глазами игрока
+// (Game::maskFog()): клетки под туманом он знает только такими, какими их
+// видел, поэтому подсказка не выдает того, что скрыто. Живую партию поиск
+// не трогает и останавливается, как только игрок начал действие.
+//
+// Поиск по стадиям, после каждой список публикуется заново:
+//   1. каждый захват и каждое применение способности на видимой клетке
+//      оценивается Bot::evaluate на один ход;
+//   2. для лидеров ищется лучший ответ соперника, и оценка берется после
+//      него (после способности захватывать уже нельзя - ход заканчивается);
+//   3. позиция после лучшего хода и предсказанного ответа считается
+//      заранее. Если соперник ответил как предсказано, следующий ход
+//      начинается с готового узла.
+//
+//   HintEngine hints;
+//   game.setHintProvider(&hints);
+
+class HintEngine : public HintProvider {
+public:
+    // Ход-кандидат: захват или способность; reply - предсказанный ответ
+    // соперника, replyVisible - его клетку игрок видит (иначе ответ не
+    // показывается)
+    struct Candidate {
+        Action move;
+        Action reply;
+        bool replyVisible = false;
+        int score = INT_MIN;
+        int depth = 0;
+    };
+
+    // Опубликованный результат поиска: только для чтения
+    struct Snapshot {
+        std::vector<Candidate> best;   // Лучшие по убыванию оценки
+        int evaluated = 0;
+        int total = 0;
+        int depth = 0;
+        bool reused = false;           // Узел посчитан заранее, во время прошлого хода
+    };
+
+    static const int SHOWN = 5;        // Сколько ходов показывать
+    static const int REFINED = 8;      // Сколько лидеров уточнять на стадии 2
+
+private:
+    // Узел дерева: позиция и ее кандидаты. Узлы ищутся по ключу позиции.
+    struct Node {
+        std::vector<Candidate> candidates;
+        int evaluated = 0;
+        bool enumerated = false;   // Стадия 1 пройдена целиком
+        bool refined = false;      // Стадия 2 пройдена целиком
+        uint64_t ponderKey = 0;    // Узел после лучшего хода и ответа
+    };
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool stopping = false;
+    bool hasJob = false;
+    std::unique_ptr<Game> job;                   // Позиция для следующего поиска
+    // Каждый новый ход и каждое действие игрока увеличивают поколение;
+    // поиск работает, пока поколение то же, с каким он начался
+    std::atomic<uint64_t> generation{0};
+    uint64_t searchGeneration = 0;
+    std::shared_ptr<const Snapshot> published;   // Читается через atomic_load
+
+    // Дерево трогает только поток поиска
+    std::unordered_map<uint64_t, std::shared_ptr<Node>> tree;
+
+    // Ключ позиции: открытое состояние клеток, очки и флаги игроков, чей ход
+    static uint64_t positionKey(const Game& game) {
+        uint64_t h = 1469598103934665603ull;
+        auto mix = [&h](uint64_t v) {
+            h ^= v;
+            h *= 1099511628211ull;
+        };
+        int size = game.getSize();
+        for (int x = 0; x < size; ++x) {
+            for (int y = 0; y < size; ++y) mix(packCell(game.getCell(x, y)));
+        }
+        for (int i = 0; i < 2; ++i) {
+            const Player& p = game.getPlayer(i);
+            mix(static_cast<uint64_t>(p.score));
+            mix(p.commanderActive | (p.abilityUsedThisTurn << 1));
+        }
+        mix(static_cast<uint64_t>(game.getCurrentPlayer()));
+        return h;
+    }
+
+    bool stop() const {
+        return generation.load(std::memory_order_relaxed) != searchGeneration;
+    }
+
+    static Game trialCopy(const Game& game) {
+        Game trial = game.fork();
+        trial.setParallel(false);
+        return trial;
+    }
+
+    // Лучший захват игрока, чей ход, по Bot::evaluate; pass, если захватов нет
+    Action bestCapture(const Game& game, int& score) const {
+        int size = game.getSize();
+        int playerId = game.getCurrentPlayer() + 1;
+        Action best = Action::pass();
+        score = Bot::evaluate(game, playerId);
+        bool found = false;
+        for (int x = 0; x < size && !stop(); ++x) {
+            for (int y = 0; y < size; ++y) {
+                if (!game.isCellAvailable(x, y)) continue;
+                Game trial = trialCopy(game);
+                if (!trial.playCapture(x, y)) continue;
+                int s = Bot::evaluate(trial, playerId);
+                if (!found || s > score) {
+                    found = true;
+                    score = s;
+                    best = Action::capture(x, y);
+                }
+            }
+        }
+        return best;
+    }
+
+    // Все ходы игрока, который сейчас ходит: захваты доступных клеток и
+    // способности по карману на видимых клетках
+    static void enumerate(const Game& game, std::vector<Candidate>& out) {
+        int size = game.getSize();
+        const Player& player = game.getPlayer(game.getCurrentPlayer());
+        const char directions[] = {'W', 'A', 'S', 'D'};
+        for (int x = 0; x < size; ++x) {
+            for (int y = 0; y < size; ++y) {
+                if (game.isCellAvailable(x, y)) {
+                    Candidate c;
+                    c.move = Action::capture(x, y);
+                    out.push_back(c);
+                }
+            }
+        }
+        for (int a = 0; a < NUM_ABILITIES; ++a) {
+            if (!player.canUseAbility(ABILITIES[a].baseCost)) continue;
+            bool directed = (a == 2 || a == 5);   // Штурмовик, Укрепления
+            bool placed = (a != 3);               // Командиру клетка не нужна
+            for (int x = 0; x < (placed ? size : 1); ++x) {
+                for (int y = 0; y < (placed ? size : 1); ++y) {
+                    if (placed && !game.isCellVisible(x, y)) continue;
+                    for (int d = 0; d < (directed ? 4 : 1); ++d) {
+                        Candidate c;
+                        c.move = Action::useAbility(a, x, y, directed ? directions[d] : 0);
+                        out.push_back(c);
+                    }
+                }
+            }
+        }
+    }
+
+    void publish(const Node& node, bool reused) {
+        auto snapshot = std::make_shared<Snapshot>();
+        snapshot->evaluated = node.evaluated;
+        snapshot->total = static_cast<int>(node.candidates.size());
+        snapshot->reused = reused;
+        for (const Candidate& c : node.candidates) {
+            if (c.score == INT_MIN) continue;
+            snapshot->best.push_back(c);
+            snapshot->depth = std::max(snapshot->depth, c.depth);
+        }
+        // Уточненные оценки точнее: сначала глубина, потом оценка
+        std::stable_sort(snapshot->best.begin(), snapshot->best.end(), [](const Candidate& a, const Candidate& b) {
+            if (a.depth != b.depth) return a.depth > b.depth;
+            return a.score > b.score;
+        });
+        if (snapshot->best.size() > static_cast<size_t>(SHOWN)) snapshot->best.resize(SHOWN);
+        std::atomic_store(&published, std::shared_ptr<const Snapshot>(std::move(snapshot)));
+    }
+
+    // Стадия 1: оценка на один ход. Список публикуется каждые 32 оценки,
+    // чтобы подсказка была почти сразу.
+    void evaluateAll(const Game& root, Node& node, bool show, bool reused) {
+        int playerId = root.getCurrentPlayer() + 1;
+        if (node.candidates.empty()) enumerate(root, node.candidates);
+        for (size_t i = node.evaluated; i < node.candidates.size() && !stop(); ++i) {
+            Candidate& c = node.candidates[i];
+            Game trial = trialCopy(root);
+            if (trial.playAction(c.move)) c.score = Bot::evaluate(trial, playerId);
+            c.depth = 1;
+            node.evaluated = static_cast<int>(i) + 1;
+            if (show && node.evaluated % 32 == 0) publish(node, reused);
+        }
+        node.enumerated = !stop();
+        if (show) publish(node, reused);
+    }
+
+    // Стадия 2: лидеры с ответом соперника
+    void refine(const Game& root, Node& node, bool show, bool reused) {
+        int playerId = root.getCurrentPlayer() + 1;
+        std::vector<size_t> order;
+        for (size_t i = 0; i < node.candidates.size(); ++i) {
+            if (node.candidates[i].score != INT_MIN && node.candidates[i].depth < 2) order.push_back(i);
+        }
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return node.candidates[a].score > node.candidates[b].score;
+        });
+        if (order.size() > static_cast<size_t>(REFINED)) order.resize(REFINED);
+
+        for (size_t i : order) {
+            if (stop()) return;
+            Candidate& c = node.candidates[i];
+            Game trial = trialCopy(root);
+            if (!trial.playAction(c.move)) continue;
+            if (c.move.kind == Action::ABILITY && !trial.isGameOver()) trial.playPass();
+            if (!trial.isGameOver()) {
+                int ignored;
+                c.reply = bestCapture(trial, ignored);
+                c.replyVisible = c.reply.kind == Action::CAPTURE && root.isCellVisible(c.reply.x, c.reply.y);
+                if (!trial.playAction(c.reply)) trial.playPass();
+            }
+            if (stop()) return;
+            c.score = Bot::evaluate(trial, playerId);
+            c.depth = 2;
+            if (show) publish(node, reused);
+        }
+        node.refined = true;
+    }
+
+    // Позиция после лучшего уточненного хода и предсказанного ответа
+    bool predictedPosition(const Game& root, const Node& node, Game& out) const {
+        const Candidate* best = nullptr;
+        for (const Candidate& c : node.candidates) {
+            if (c.depth == 2 && (!best || c.score > best->score)) best = &c;
+        }
+        if (!best) return false;
+        out = trialCopy(root);
+        if (!out.playAction(best->move)) return false;
+        if (best->move.kind == Action::ABILITY) out.playPass();
+        if (!out.playAction(best->reply)) out.playPass();
+        return !out.isGameOver();
+    }
+
+    void search(const Game& root) {
+        uint64_t key = positionKey(root);
+        std::shared_ptr<Node> node;
+        auto found = tree.find(key);
+        bool reused = found != tree.end();
+        if (reused) {
+            node = found->second;
+        } else {
+            node = std::make_shared<Node>();
+        }
+        // Из дерева остается только текущий узел и то, что посчитаем дальше
+        tree.clear();
+        tree[key] = node;
+        publish(*node, reused);
+
+        if (!node->enumerated) evaluateAll(root, *node, true, reused);
+        if (!stop() && !node->refined) refine(root, *node, true, reused);
+
+        // Стадия 3: думаем за следующий ход, пока игрок думает над этим
+        Game predicted = root;
+        if (stop() || !predictedPosition(root, *node, predicted)) return;
+        node->ponderKey = positionKey(predicted);
+        auto next = std::make_shared<Node>();
+        tree[node->ponderKey] = next;
+        evaluateAll(predicted, *next, false, false);
+        if (!stop()) refine(predicted, *next, false, false);
+    }
+
+    void run() {
+        for (;;) {
+            std::unique_ptr<Game> position;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeUp.wait(lock, [this] { return stopping || hasJob; });
+                if (stopping) return;
+                position = std::move(job);
+                hasJob = false;
+                searchGeneration = generation.load(std::memory_order_relaxed);
+            }
+            search(*position);
+        }
+    }
+
+    static void printAction(std::ostream& os, const Action& a) {
+        if (a.kind == Action::CAPTURE) {
+            os << "захват (" << a.x << "," << a.y << ")";
+        } else if (a.kind == Action::ABILITY) {
+            os << ABILITIES[a.ability].name;
+            if (a.ability != 3) os << " на (" << a.x << "," << a.y << ")";
+            if (a.direction) os << " " << a.direction;
+        } else {
+            os << "пропуск";
+        }
+    }
+
+public:
+    HintEngine() : worker([this] { run(); }) {}
+
+    ~HintEngine() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            generation.fetch_add(1, std::memory_order_relaxed);
+        }
+        wakeUp.notify_one();
+        worker.join();
+    }
+
+    HintEngine(const HintEngine&) = delete;
+    HintEngine& operator=(const HintEngine&) = delete;
+
+    // Начать поиск позиции game; прошлый поиск бросается
+    void turnStarted(const Game& game) override {
+        std::unique_ptr<Game> position(new Game(game));
+        position->setInteractive(false);
+        position->setParallel(false);
+        position->maskFog();
+        std::atomic_store(&published, std::shared_ptr<const Snapshot>());
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = std::move(position);
+            hasJob = true;
+            generation.fetch_add(1, std::memory_order_relaxed);
+        }
+        wakeUp.notify_one();
+    }
+
+    // Игрок действует: поиск бросает работу на ближайшей проверке, не
+    // дожидаясь ее здесь
+    void turnEnded() override {
+        generation.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::shared_ptr<const Snapshot> snapshot() const {
+        return std::atomic_load(&published);
+    }
+
+    void show(std::ostream& os) const override {
+        std::shared_ptr<const Snapshot> s = snapshot();
+        if (!s || s->best.empty()) {
+            os << "💡 Подсказка еще считается...\n";
+            return;
+        }
+        os << "💡 Подсказка (проверено " << s->evaluated << " из " << s->total << " ходов, глубина " << s->depth
+           << (s->reused ? ", посчитано заранее" : "") << "):\n";
+        for (size_t i = 0; i < s->best.size(); ++i) {
+            const Candidate& c = s->best[i];
+            os << "  " << i + 1 << ". ";
+            printAction(os, c.move);
+            os << " - оценка " << c.score;
+            if (c.depth >= 2 && c.replyVisible) {
+                os << ", ответ соперника: ";
+                printAction(os, c.reply);
+            }
+            os << "\n";
+        }
+    }
+};
@@ -0,0 +1,438 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "game.h"
+
+// ============= ПОИСК ВЫНУЖДЕННОГО ВЗЯТИЯ КОРОЛЯ =============
+// Может ли ходящий игрок (сторона), как бы ни отвечали соперники, взять
+// клетку вражеского короля за k своих ходов. Обычным захватом королевскую
+// клетку не взять - ее нет среди доступных, - поэтому взять короля значит
+// получить его клетку способностью с действием захвата. В нынешних
+// правилах это Штурмовик: ему не нужны ни соседняя своя клетка, ни
+// расстояние до королей, так что перебор - это гонка очков, и очки и цены
+// считают сами правила (Player::canUseAbility(), скидка Командира,
+// диверсии, автозахват).
+//
+// Поиск - доказательство числами в глубину (df-pn): узел - начало хода,
+// ходы стороны - узлы ИЛИ, ходы соперников - узлы И. Ход берется целиком:
+// захват, способность (после нее правила оставляют только пас) или пас.
+// Гонка: если соперник раньше возьмет королевскую клетку стороны, позиция
+// опровергнута. Узел сначала проверяется без развертки:
+// - сторона может взять короля сейчас - доказано;
+// - соперник может взять короля стороны - опровергнуто;
+// - следом ходит сторона, и очков на удар у нее уже хватает - доказано:
+//   соперники не отнимают чужих очков, а короля нельзя укрепить;
+// - у стороны последний ход - он может быть только ударом по королю.
+// Удары не предполагаются, а играются и проверяются по полю. Способности,
+// которые ничего не меняют, кроме тумана, не перебираются: они хуже паса
+// для того, кто за них платит.
+//
+// Ходы делаются и откатываются на одной копии партии (Game::saveUndo() и
+// undo()), хеш клеток правится по журналу изменений. Таблица
+// транспозиций фиксированного размера, запись вытесняется всегда.
+class KingSolver {
+public:
+    enum Verdict : uint8_t { PROVEN, DISPROVEN, UNKNOWN };
+
+    struct Result {
+        Verdict verdict = UNKNOWN;
+        Action move;            // Первый ход доказательства
+        uint64_t nodes = 0;     // Сыгранных ходов, вместе с проверками ударов
+        double seconds = 0;
+
+        double nodesPerSecond() const { return seconds > 0 ? static_cast<double>(nodes) / seconds : 0; }
+    };
+
+private:
+    static constexpr uint32_t INF = 1u << 30;
+    static constexpr int FAR = 1 << 20;  // Удара нет вовсе
+
+    struct Entry {
+        uint64_t key = 0;
+        uint32_t pn = 0, dn = 0;
+    };
+
+    struct Child {
+        Action action;
+        uint64_t key;
+        uint32_t pn, dn;
+    };
+
+    // Все, что нужно узлу на своей глубине; векторы переиспользуются
+    struct Frame {
+        Game::UndoPoint undo;
+        uint64_t hash = 0;
+        std::vector<Action> moves;
+        std::vector<Child> children;
+    };
+
+    Game game;
+    int side;
+    uint64_t maxNodes;
+    uint64_t nodes;
+    uint64_t hash;                 // Хеш клеток текущей позиции
+    std::vector<Entry> table;
+    std::vector<Frame> frames;     // По глубине
+    Game::UndoPoint probe;         // Для проверки ударов
+    std::vector<Action> hits;
+    Action lastHit;
+
+    static uint64_t mix(uint64_t v) {
+        v += 0x9E3779B97F4A7C15ull;
+        v = (v ^ (v >> 30)) * 0xBF58476D1CE4E5B9ull;
+        v = (v ^ (v >> 27)) * 0x94D049BB133111EBull;
+        return v ^ (v >> 31);
+    }
+
+    static uint64_t cellKey(int cell, uint16_t packed) {
+        return mix(static_cast<uint64_t>(cell) << 16 | packed);
+    }
+
+    static uint32_t add(uint32_t a, uint32_t b) {
+        return std::min<uint64_t>(static_cast<uint64_t>(a) + b, INF);
+    }
+
+    // Клетки, очки, Командир, выбывшие, очередь хода и оставшиеся ходы стороны
+    uint64_t positionKey(int remaining) const {
+        uint64_t key = hash ^ mix(0xC0DE0000ull + static_cast<uint64_t>(game.getCurrentPlayer()) * 1024 +
+                                  static_cast<uint64_t>(remaining));
+        for (int p = 0; p < game.getPlayerCount(); ++p) {
+            const Player& player = game.getPlayer(p);
+            key ^= mix(static_cast<uint64_t>(p + 1) << 56 | static_cast<uint64_t>(static_cast<uint32_t>(player.score)) << 2 |
+                       static_cast<uint64_t>(player.commanderActive) << 1 | static_cast<uint64_t>(player.eliminated));
+        }
+        return key;
+    }
+
+    Entry* lookup(uint64_t key) {
+        Entry& e = table[key & (table.size() - 1)];
+        return e.key == key ? &e : nullptr;
+    }
+
+    void store(uint64_t key, uint32_t pn, uint32_t dn) {
+        Entry& e = table[key & (table.size() - 1)];
+        e.key = key;
+        e.pn = pn;
+        e.dn = dn;
+    }
+
+    // Ход целиком: после способности правила оставляют только пас.
+    // false - правила ход не приняли; откатывать нужно в любом случае.
+    bool play(const Action& action, Game::UndoPoint& undo) {
+        game.saveUndo(undo);
+        size_t mark = game.getCellJournal().size();
+        bool ok = game.playAction(action);
+        if (ok && action.kind == Action::ABILITY) game.playPass();
+        ++nodes;
+        const std::vector<CellDiff>& journal = game.getCellJournal();
+        int size = game.getSize();
+        for (size_t i = mark; i < journal.size(); ++i) {
+            const CellDiff& d = journal[i];
+            int cell = d.x * size + d.y;
+            hash ^= cellKey(cell, d.before) ^ cellKey(cell, d.after);
+        }
+        return ok;
+    }
+
+    // Исход, уже записанный на поле: чья королевская клетка у кого
+    Verdict settled() const {
+        if (game.isGameOver()) return game.getWinner() == side + 1 ? PROVEN : DISPROVEN;
+        for (int p = 0; p < game.getPlayerCount(); ++p) {
+            const Player& player = game.getPlayer(p);
+            int owner = game.getCell(player.kingX, player.kingY).ownerId;
+            if (p == side && owner != side + 1) return DISPROVEN;
+            if (p != side && !player.eliminated && owner == side + 1) return PROVEN;
+        }
+        return UNKNOWN;
+    }
+
+    // Чьих королей бьет игрок player: сторона - любых соперников,
+    // соперники - только короля стороны
+    bool isTarget(int player, int king) const {
+        return king != player && !game.getPlayer(king).eliminated && (player == side || king == side);
+    }
+
+    // Удары игрока player в состоянии state: способности с действием
+    // захвата, на которые хватает очков, с целями, чей трафарет накрывает
+    // королевскую клетку
+    void kingHits(int player, const Player& state, std::vector<Action>& out) const {
+        out.clear();
+        int size = game.getSize();
+        for (int a = 0; a < NUM_ABILITIES; ++a) {
+            const AbilityStencil& st = ABILITY_STENCILS[a];
+            if (st.effect != AreaEffect::CAPTURE || !state.canUseAbility(ABILITIES[a].baseCost)) continue;
+            bool line = st.shape == StencilShape::LINE;
+            int reach = std::max(std::abs(st.from), std::abs(st.to));
+            for (int king = 0; king < game.getPlayerCount(); ++king) {
+                if (!isTarget(player, king)) continue;
+                int kx = game.getPlayer(king).kingX, ky = game.getPlayer(king).kingY;
+                for (int x = std::max(0, kx - reach); x <= std::min(size - 1, kx + reach); ++x) {
+                    for (int y = std::max(0, ky - reach); y <= std::min(size - 1, ky + reach); ++y) {
+                        for (int d = 0; d < (line ? 4 : 1); ++d) {
+                            char direction = line ? "WASD"[d] : 0;
+                            bool covers = false;
+                            game.previewAbility(player, a, x, y, direction, [&](int nx, int ny) {
+                                covers = covers || (nx == kx && ny == ky);
+                            });
+                            if (covers) out.push_back(Action::useAbility(a, x, y, direction));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Удар текущего игрока по королю, сыгранный и проверенный по полю
+    bool findKingHit() {
+        int mover = game.getCurrentPlayer();
+        kingHits(mover, game.getPlayer(mover), hits);
+        Verdict wanted = mover == side ? PROVEN : DISPROVEN;
+        for (const Action& action : hits) {
+            uint64_t saved = hash;
+            bool taken = play(action, probe) && settled() == wanted;
+            game.undo(probe);
+            hash = saved;
+            if (taken) {
+                lastHit = action;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int nextMover() const {
+        int p = game.getCurrentPlayer();
+        do {
+            p = (p + 1) % game.getPlayerCount();
+        } while (game.getPlayer(p).eliminated);
+        return p;
+    }
+
+    // Хватит ли стороне очков на удар в начале ее хода: очки с тех пор
+    // только растут, а королевская клетка не укрепляется
+    bool sideHitsNextTurn() {
+        Player state = game.getPlayer(side);
+        state.resetTurn();
+        kingHits(side, state, hits);
+        return !hits.empty();
+    }
+
+    // Исход узла без развертки; remaining - ходов стороны, включая текущий,
+    // если ходит она
+    Verdict evaluate(int remaining) {
+        Verdict known = settled();
+        if (known != UNKNOWN) return known;
+        if (remaining == 0) return DISPROVEN;
+        if (game.getCurrentPlayer() == side) {
+            if (findKingHit()) return PROVEN;
+            return remaining == 1 ? DISPROVEN : UNKNOWN;
+        }
+        if (findKingHit()) return DISPROVEN;
+        if (nextMover() == side && sideHitsNextTurn()) return PROVEN;
+        return UNKNOWN;
+    }
+
+    // Очков до самого дешевого удара по королю
+    int deficit(int player) const {
+        const Player& state = game.getPlayer(player);
+        int best = FAR;
+        for (int a = 0; a < NUM_ABILITIES; ++a) {
+            const AbilityStencil& st = ABILITY_STENCILS[a];
+            if (st.effect != AreaEffect::CAPTURE || st.kingClearance > 0) continue;
+            best = std::min(best, std::max(0, state.getAbilityCost(ABILITIES[a].baseCost) - state.score));
+        }
+        return best;
+    }
+
+    // Оценка еще не развернутого узла (df-pn+): чем ближе сторона к удару,
+    // тем меньше pn, чем ближе соперник - тем меньше dn
+    void estimate(uint32_t& pn, uint32_t& dn) const {
+        int enemy = FAR;
+        for (int p = 0; p < game.getPlayerCount(); ++p) {
+            if (p != side && !game.getPlayer(p).eliminated) enemy = std::min(enemy, deficit(p));
+        }
+        pn = 1 + static_cast<uint32_t>(std::min(deficit(side), 64));
+        dn = 1 + static_cast<uint32_t>(std::min(enemy, 64));
+    }
+
+    // Ходы текущего игрока: захваты (сначала самые дорогие), способности,
+    // которые что-то меняют, и пас
+    void generate(std::vector<Action>& moves) const {
+        moves.clear();
+        int size = game.getSize();
+        int mover = game.getCurrentPlayer();
+        for (uint32_t i : game.getAvailableCells()) moves.push_back(Action::capture(i / size, i % size));
+        auto gain = [&](const Action& a) {
+            const Cell& cell = game.getCell(a.x, a.y);
+            return (cell.ownerId == 0 ? 1 : 2) + (cell.sabotageCell ? cell.sabotageValue : 0);
+        };
+        std::stable_sort(moves.begin(), moves.end(),
+                         [&](const Action& a, const Action& b) { return gain(a) > gain(b); });
+
+        const Player& state = game.getPlayer(mover);
+        for (int a = 0; a < NUM_ABILITIES; ++a) {
+            if (!state.canUseAbility(ABILITIES[a].baseCost)) continue;
+            const AbilityStencil& st = ABILITY_STENCILS[a];
+            if (st.effect == AreaEffect::NONE) {
+                if (game.previewAbility(mover, a, state.kingX, state.kingY, 0, [](int, int) {})) {
+                    moves.push_back(Action::useAbility(a, state.kingX, state.kingY));
+                }
+                continue;
+            }
+            bool line = st.shape == StencilShape::LINE;
+            for (int x = 0; x < size; ++x) {
+                for (int y = 0; y < size; ++y) {
+                    for (int d = 0; d < (line ? 4 : 1); ++d) {
+                        char direction = line ? "WASD"[d] : 0;
+                        if (game.previewAbility(mover, a, x, y, direction, [](int, int) {})) {
+                            moves.push_back(Action::useAbility(a, x, y, direction));
+                        }
+                    }
+                }
+            }
+        }
+        moves.push_back(Action::pass());
+    }
+
+    // Развертка узла (df-pn): числа узла по детям, спуск в самого
+    // перспективного ребенка, пока числа не выйдут за пороги
+    void search(int depth, int remaining, uint64_t key, uint32_t thpn, uint32_t thdn, uint32_t& pn, uint32_t& dn) {
+        bool orNode = game.getCurrentPlayer() == side;
+        int next = orNode ? remaining - 1 : remaining;
+        Frame& frame = frames[depth];
+        std::vector<Child>& children = frame.children;
+        frame.hash = hash;
+        generate(frame.moves);
+        children.clear();
+        for (const Action& action : frame.moves) {
+            Child child{action, 0, 1, 1};
+            bool ok = play(action, frame.undo);
+            if (ok) {
+                child.key = positionKey(next);
+                if (const Entry* e = lookup(child.key)) {
+                    child.pn = e->pn;
+                    child.dn = e->dn;
+                } else {
+                    Verdict v = evaluate(next);
+                    if (v == UNKNOWN) {
+                        estimate(child.pn, child.dn);
+                    } else {
+                        child.pn = v == PROVEN ? 0 : INF;
+                        child.dn = v == PROVEN ? INF : 0;
+                        store(child.key, child.pn, child.dn);
+                    }
+                }
+            }
+            game.undo(frame.undo);
+            hash = frame.hash;
+            if (!ok) continue;
+            children.push_back(child);
+            if (orNode ? child.pn == 0 : child.dn == 0) break;
+        }
+
+        while (true) {
+            uint32_t best = 0, second = INF;
+            if (orNode) {
+                pn = INF;
+                dn = 0;
+                for (size_t i = 0; i < children.size(); ++i) {
+                    dn = add(dn, children[i].dn);
+                    if (children[i].pn < pn) {
+                        second = pn;
+                        pn = children[i].pn;
+                        best = static_cast<uint32_t>(i);
+                    } else if (children[i].pn < second) {
+                        second = children[i].pn;
+                    }
+                }
+            } else {
+                pn = 0;
+                dn = INF;
+                for (size_t i = 0; i < children.size(); ++i) {
+                    pn = add(pn, children[i].pn);
+                    if (children[i].dn < dn) {
+                        second = dn;
+                        dn = children[i].dn;
+                        best = static_cast<uint32_t>(i);
+                    } else if (children[i].dn < second) {
+                        second = children[i].dn;
+                    }
+                }
+            }
+            if (children.empty()) {
+                pn = orNode ? INF : 0;
+                dn = orNode ? 0 : INF;
+            }
+            if (pn >= thpn || dn >= thdn || nodes >= maxNodes) break;
+
+            Child& child = children[best];
+            uint32_t childPn, childDn;
+            if (orNode) {
+                childPn = std::min(thpn, add(second, 1));
+                childDn = add(thdn - dn, child.dn);
+            } else {
+                childPn = add(thpn - pn, child.pn);
+                childDn = std::min(thdn, add(second, 1));
+            }
+            play(child.action, frame.undo);
+            search(depth + 1, next, child.key, childPn, childDn, child.pn, child.dn);
+            game.undo(frame.undo);
+            hash = frame.hash;
+        }
+        store(key, pn, dn);
+    }
+
+public:
+    // Копия позиции; сторона - игрок, чей сейчас ход. Таблица - 2^tableBits
+    // записей, общая для всех solve() этой позиции.
+    KingSolver(const Game& position, int tableBits = 20) :
+        game(position), side(position.getCurrentPlayer()), maxNodes(0), nodes(0), hash(0),
+        table(size_t(1) << tableBits) {
+        game.setInteractive(false);
+        game.setParallel(false);
+        game.setEventStream(nullptr);
+        game.setStatsHistory(0);
+        game.setJournalEnabled(true);
+        int size = game.getSize();
+        for (int x = 0; x < size; ++x) {
+            for (int y = 0; y < size; ++y) hash ^= cellKey(x * size + y, packCell(game.getCell(x, y)));
+        }
+    }
+
+    // Берет ли сторона вражеского короля не позже чем за turns своих ходов.
+    // После maxNodes сыгранных ходов поиск сдается (UNKNOWN).
+    Result solve(int turns, uint64_t nodeLimit) {
+        auto started = std::chrono::steady_clock::now();
+        Result result;
+        nodes = 0;
+        maxNodes = nodeLimit;
+        frames.resize(static_cast<size_t>(std::max(1, turns)) * game.getPlayerCount() + 1);
+
+        Verdict verdict = evaluate(turns);
+        if (verdict == PROVEN && game.getCurrentPlayer() == side) result.move = lastHit;
+        if (verdict == UNKNOWN) {
+            uint32_t pn, dn;
+            search(0, turns, positionKey(turns), INF, INF, pn, dn);
+            if (pn == 0) {
+                verdict = PROVEN;
+                for (const Child& child : frames[0].children) {
+                    if (child.pn == 0) {
+                        result.move = child.action;
+                        break;
+                    }
+                }
+            } else if (dn == 0) {
+                verdict = DISPROVEN;
+            }
+        }
+        result.verdict = verdict;
+        result.nodes = nodes;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return result;
+    }
+};
@@ -0,0 +1,342 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+#include "cow_grid.h"
+
+// ============= ПОЛЯ РАССТОЯНИЙ ДО КОРОЛЕЙ =============
+// Для каждого короля - BFS-расстояние от него до каждой клетки по
+// неукрепленным клеткам (укрепление нельзя захватить и с него нельзя
+// захватывать, поэтому путь через него не идет). Расстояние клетки - число
+// захватов, которые нужны, чтобы дойти от нее до короля.
+//
+// Угроза игрока p королю k - минимум расстояния по неукрепленным клеткам p
+// до короля k. Чтобы не искать минимум по полю, клетки разложены по
+// корзинам расстояний: attackers[k * kings + p][d] - клеток игрока p на
+// расстоянии d от короля k. Так же считаются клетки, куда может сесть
+// Десантник: не ближе PARATROOPER_MIN_DISTANCE к королю k, а при трех и
+// более игроках - ко всем королям (кто высаживается, здесь неизвестно;
+// клетки у своего короля все равно далеко от чужих).
+//
+// Наименьшая непустая корзина каждого массива хранится рядом и
+// поправляется вместе с корзинами, так что запрос угрозы - O(королей).
+//
+// Поле не строится заново на каждый ход. Смена владельца двигает клетку
+// между корзинами за O(1) на короля. Появление или снятие укрепления чинит
+// поле локально: при снятии расстояния только уменьшаются - волна от
+// клетки; при появлении находятся клетки, потерявшие все кратчайшие пути (у
+// них не осталось соседа на d - 1), и только они пересчитываются от границы
+// уцелевших.
+//
+// Состояние клеток здесь свое, его меняет только cellChanged(): изменения
+// после прохода по полосам применяются по одному, когда поле уже итоговое.
+// Массивы - CowArray: копия партии делит их с оригиналом, пока не тронет.
+class KingThreat {
+public:
+    static constexpr uint16_t UNREACHABLE = 0xFFFF;
+    static constexpr int PARATROOPER_MIN_DISTANCE = 5;
+    static constexpr int MAX_KINGS = 8;
+
+private:
+    int size = 0;
+    int kings = 0;
+    int kingX[MAX_KINGS] = {};
+    int kingY[MAX_KINGS] = {};
+    CowArray<uint8_t> owner;      // 0 - нейтральная, иначе номер игрока с 1
+    CowArray<uint8_t> blocked;    // Укреплена
+    CowArray<uint8_t> nearKings;  // Бит k - ближе PARATROOPER_MIN_DISTANCE к королю k
+    CowArray<uint16_t> dist[MAX_KINGS];
+    CowArray<uint16_t> attackers[MAX_KINGS * MAX_KINGS]; // [король * kings + игрок]
+    CowArray<uint16_t> landings[MAX_KINGS];
+    uint16_t attackersLow[MAX_KINGS * MAX_KINGS] = {}; // Наименьшая непустая корзина, UNREACHABLE - пусто
+    uint16_t landingsLow[MAX_KINGS] = {};
+    int excluded = -1;               // Клетка, чьи корзины ведет cellChanged()
+
+    // Рабочие буферы починки; копия получает пустые
+    WorkBuffer<int> queue;
+    WorkBuffer<uint8_t> affected;
+    WorkBuffer<uint64_t> heap;       // (расстояние << 32) | клетка
+
+    int kingIndex(int k) const { return kingX[k] * size + kingY[k]; }
+
+    bool isLanding(int k, int i) const {
+        return kings == 2 ? (nearKings[i] & (1u << k)) == 0 : nearKings[i] == 0;
+    }
+
+    // Вклад клетки в корзины поля k
+    void count(int k, int i, int sign) {
+        if (i == excluded) return;
+        uint16_t d = dist[k][i];
+        if (d == UNREACHABLE || blocked[i]) return;
+        if (owner[i] != 0 && owner[i] != k + 1) {
+            int j = k * kings + owner[i] - 1;
+            add(attackers[j], attackersLow[j], d, sign);
+        }
+        if (isLanding(k, i)) add(landings[k], landingsLow[k], d, sign);
+    }
+
+    // Корзина d меняется на sign, low - наименьшая непустая корзина массива.
+    // Опустевший минимум ищется дальше вверх: клетки обычно есть рядом
+    static void add(CowArray<uint16_t>& buckets, uint16_t& low, uint16_t d, int sign) {
+        uint16_t& bucket = buckets.edit(d);
+        bucket = static_cast<uint16_t>(bucket + sign);
+        if (sign > 0) {
+            low = std::min(low, d);
+        } else if (bucket == 0 && d == low) {
+            low = UNREACHABLE;
+            for (size_t next = d + 1u; next < buckets.size(); ++next) {
+                if (buckets[next] > 0) {
+                    low = static_cast<uint16_t>(next);
+                    break;
+                }
+            }
+        }
+    }
+
+    void setDistance(int k, int i, uint16_t d) {
+        count(k, i, -1);
+        dist[k].edit(i) = d;
+        count(k, i, +1);
+    }
+
+    template <typename Fn>
+    void forNeighbours(int i, Fn&& fn) const {
+        int x = i / size, y = i % size;
+        if (x > 0) fn(i - size);
+        if (x + 1 < size) fn(i + size);
+        if (y > 0) fn(i - 1);
+        if (y + 1 < size) fn(i + 1);
+    }
+
+    void rebuildField(int k) {
+        for (int p = 0; p < kings; ++p) {
+            attackers[k * kings + p].assign(attackers[k * kings + p].size(), 0);
+            attackersLow[k * kings + p] = UNREACHABLE;
+        }
+        landings[k].assign(landings[k].size(), 0);
+        landingsLow[k] = UNREACHABLE;
+        dist[k].assign(dist[k].size(), UNREACHABLE);
+        int king = kingIndex(k);
+        if (!blocked[king]) {
+            queue.clear();
+            dist[k].edit(king) = 0;
+            queue.push_back(king);
+            for (size_t head = 0; head < queue.size(); ++head) {
+                int cur = queue[head];
+                uint16_t next = static_cast<uint16_t>(dist[k][cur] + 1);
+                forNeighbours(cur, [&](int n) {
+                    if (blocked[n] || dist[k][n] != UNREACHABLE) return;
+                    dist[k].edit(n) = next;
+                    queue.push_back(n);
+                });
+            }
+        }
+        for (int i = 0; i < size * size; ++i) count(k, i, +1);
+    }
+
+    // Клетка i только что укреплена: пересчет клеток, у которых все
+    // кратчайшие пути шли через нее
+    void repairBlocked(int k, int i) {
+        if (dist[k][i] == UNREACHABLE) return;
+        if (affected.size() != owner.size()) affected.assign(owner.size(), 0);
+        queue.clear();
+        queue.push_back(i);
+        affected[i] = 1;
+        for (size_t head = 0; head < queue.size(); ++head) {
+            int cur = queue[head];
+            forNeighbours(cur, [&](int n) {
+                if (affected[n] || blocked[n] || dist[k][n] != dist[k][cur] + 1) return;
+                bool supported = false;
+                forNeighbours(n, [&](int m) {
+                    if (!affected[m] && !blocked[m] && dist[k][m] + 1 == dist[k][n]) supported = true;
+                });
+                if (supported) return;
+                affected[n] = 1;
+                queue.push_back(n);
+            });
+        }
+
+        for (int j : queue) setDistance(k, j, UNREACHABLE);
+        heap.clear();
+        for (int j : queue) {
+            if (j == i) continue;
+            uint16_t best = UNREACHABLE;
+            forNeighbours(j, [&](int m) {
+                if (!affected[m] && !blocked[m] && dist[k][m] != UNREACHABLE) {
+                    best = std::min<uint16_t>(best, static_cast<uint16_t>(dist[k][m] + 1));
+                }
+            });
+            if (best != UNREACHABLE) pushHeap(best, j);
+        }
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), std::greater<uint64_t>());
+            uint16_t d = static_cast<uint16_t>(heap.back() >> 32);
+            int j = static_cast<int>(heap.back() & 0xFFFFFFFFu);
+            heap.pop_back();
+            if (d >= dist[k][j]) continue;
+            setDistance(k, j, d);
+            forNeighbours(j, [&](int n) {
+                if (affected[n] && !blocked[n] && d + 1 < dist[k][n]) pushHeap(static_cast<uint16_t>(d + 1), n);
+            });
+        }
+        for (int j : queue) affected[j] = 0;
+    }
+
+    // Клетка i только что стала проходимой: расстояния могут только
+    // уменьшиться, волна идет от нее
+    void repairUnblocked(int k, int i) {
+        uint16_t best = UNREACHABLE;
+        forNeighbours(i, [&](int m) {
+            if (!blocked[m] && dist[k][m] != UNREACHABLE) best = std::min<uint16_t>(best, static_cast<uint16_t>(dist[k][m] + 1));
+        });
+        if (best == UNREACHABLE) return;
+        setDistance(k, i, best);
+        queue.clear();
+        queue.push_back(i);
+        for (size_t head = 0; head < queue.size(); ++head) {
+            int cur = queue[head];
+            uint16_t next = static_cast<uint16_t>(dist[k][cur] + 1);
+            forNeighbours(cur, [&](int n) {
+                if (blocked[n] || dist[k][n] <= next) return;
+                setDistance(k, n, next);
+                queue.push_back(n);
+            });
+        }
+    }
+
+    void pushHeap(uint16_t d, int i) {
+        heap.push_back((static_cast<uint64_t>(d) << 32) | static_cast<uint32_t>(i));
+        std::push_heap(heap.begin(), heap.end(), std::greater<uint64_t>());
+    }
+
+    // Наименьшее d с непустой корзиной, -1 - корзины пусты
+    static int lowest(uint16_t low) {
+        return low == UNREACHABLE ? -1 : low;
+    }
+
+    // Меньшее из расстояний, -1 - пути нет
+    static int closer(int a, int b) {
+        if (a < 0) return b;
+        if (b < 0) return a;
+        return std::min(a, b);
+    }
+
+public:
+    // Новое поле: все клетки нейтральные и неукрепленные. Король k - игрока
+    // k + 1. Клетки задаются setInitial(), затем rebuild().
+    void reset(int boardSize, int kingCount, const int kingsX[], const int kingsY[]) {
+        size = boardSize;
+        kings = kingCount;
+        int cells = size * size;
+        nearKings.assign(cells, 0);
+        for (int k = kings; k < MAX_KINGS; ++k) {
+            dist[k].clear();
+            landings[k].clear();
+        }
+        for (int j = kings * kings; j < MAX_KINGS * MAX_KINGS; ++j) attackers[j].clear();
+        for (int k = 0; k < kings; ++k) {
+            kingX[k] = kingsX[k];
+            kingY[k] = kingsY[k];
+            dist[k].assign(cells, UNREACHABLE);
+            landings[k].assign(cells, 0);
+            landingsLow[k] = UNREACHABLE;
+            for (int p = 0; p < kings; ++p) {
+                attackersLow[k * kings + p] = UNREACHABLE;
+                if (p == k) attackers[k * kings + p].clear();
+                else attackers[k * kings + p].assign(cells, 0);
+            }
+            for (int i = 0; i < cells; ++i) {
+                if (std::max(std::abs(i / size - kingX[k]), std::abs(i % size - kingY[k])) < PARATROOPER_MIN_DISTANCE) {
+                    nearKings.edit(i) = static_cast<uint8_t>(nearKings[i] | (1u << k));
+                }
+            }
+        }
+        owner.assign(cells, 0);
+        blocked.assign(cells, 0);
+        affected.assign(cells, 0);
+        queue.reserve(cells);
+        heap.reserve(cells * 4);
+    }
+
+    void setInitial(int x, int y, int ownerId, bool fortified) {
+        owner.edit(x * size + y) = static_cast<uint8_t>(ownerId);
+        blocked.edit(x * size + y) = fortified;
+    }
+
+    void rebuild() {
+        excluded = -1;
+        for (int k = 0; k < kings; ++k) rebuildField(k);
+    }
+
+    // Все массивы своими (см. Game::detach())
+    void detach() {
+        owner.detach();
+        blocked.detach();
+        nearKings.detach();
+        for (int k = 0; k < MAX_KINGS; ++k) {
+            dist[k].detach();
+            landings[k].detach();
+        }
+        for (auto& buckets : attackers) buckets.detach();
+    }
+
+    // Клетка (x, y) сменила владельца или укрепление
+    void cellChanged(int x, int y, int ownerId, bool fortified) {
+        int i = x * size + y;
+        for (int k = 0; k < kings; ++k) count(k, i, -1);
+        owner.set(i, static_cast<uint8_t>(ownerId));
+        if (blocked[i] != static_cast<uint8_t>(fortified)) {
+            // Корзины самой клетки ведутся здесь, а не при починке
+            excluded = i;
+            blocked.edit(i) = fortified;
+            for (int k = 0; k < kings; ++k) {
+                if (i == kingIndex(k)) rebuildField(k);
+                else if (fortified) repairBlocked(k, i);
+                else repairUnblocked(k, i);
+            }
+            excluded = -1;
+        }
+        for (int k = 0; k < kings; ++k) count(k, i, +1);
+    }
+
+    // Шагов от клетки до короля игрока kingOwner (с 0), -1 - не дойти
+    int distance(int kingOwner, int x, int y) const {
+        uint16_t d = dist[kingOwner][x * size + y];
+        return d == UNREACHABLE ? -1 : d;
+    }
+
+    // Захватов от ближайшей своей клетки игрока (с 0) до ближайшего
+    // вражеского короля, -1 - пути нет. Бит p в eliminated - игрок p
+    // выбыл: его король уже взят, а клетки никому не угрожают
+    int threat(int player, uint32_t eliminated = 0) const {
+        int best = -1;
+        for (int k = 0; k < kings; ++k) {
+            if (k != player && !(eliminated & (1u << k))) best = closer(best, lowest(attackersLow[k * kings + player]));
+        }
+        return best;
+    }
+
+    // Захватов от ближайшей клетки любого невыбывшего соперника до короля
+    // игрока
+    int danger(int player, uint32_t eliminated = 0) const {
+        int best = -1;
+        for (int p = 0; p < kings; ++p) {
+            if (p != player && !(eliminated & (1u << p))) best = closer(best, lowest(attackersLow[player * kings + p]));
+        }
+        return best;
+    }
+
+    // То же, что threat(), если первым действием высадить Десантника: -1 -
+    // негде
+    int paratrooperThreat(int player, uint32_t eliminated = 0) const {
+        int best = -1;
+        for (int k = 0; k < kings; ++k) {
+            if (k != player && !(eliminated & (1u << k))) best = closer(best, lowest(landingsLow[k]));
+        }
+        return best < 0 ? -1 : best + 1;
+    }
+};
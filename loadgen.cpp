@@ -0,0 +1,414 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+#include "protocol.h"
+
+// ============= НАГРУЗОЧНЫЙ КЛИЕНТ СЕРВЕРА МАТЧЕЙ =============
+// Открывает несколько соединений, в каждом держит множество партий и играет
+// за обе стороны случайными доступными захватами. В конце печатает задержку
+// хода (p50/p99) и сколько партий сервер держит на одно ядро. С --vs-bot 1
+// клиент играет только первым игроком, а за второго ходит бот сервера.
+//
+//   ./loadgen --tcp 127.0.0.1:7878 --connections 8 --sessions 500 --seconds 10
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        std::string host = "127.0.0.1";
+        int port = 7878;
+        std::string unixPath;
+        int connections = 4;
+        int sessionsPerConnection = 250;
+        int seconds = 10;
+        int boardSize = Constants::BOARD_SIZE_SMALL;
+        int maxMoves = 400;      // Случайная игра может не дойти до короля
+        uint32_t seed = 1;
+        bool vsBot = false;      // Второй игрок - бот сервера
+    };
+
+    struct SessionState {
+        bool actionPending = false;
+        int actor = 0;
+        int moves = 0;
+        Clock::time_point sentAt;
+    };
+
+    struct ClientConnection {
+        int fd = -1;
+        std::vector<uint8_t> input;
+        std::vector<uint8_t> output;
+        std::unordered_map<uint32_t, SessionState> sessions;
+    };
+
+    struct ServerStats {
+        uint32_t sessions = 0;
+        uint32_t connections = 0;
+        uint64_t actions = 0;
+        uint64_t cpuMicros = 0;
+        uint64_t wallMicros = 0;
+    };
+
+    int connectToServer(const Options& options) {
+        int fd;
+        if (!options.unixPath.empty()) {
+            fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::strncpy(addr.sun_path, options.unixPath.c_str(), sizeof(addr.sun_path) - 1);
+            if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+                ::close(fd);
+                return -1;
+            }
+        } else {
+            fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(static_cast<uint16_t>(options.port));
+            inet_pton(AF_INET, options.host.c_str(), &addr.sin_addr);
+            if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+                ::close(fd);
+                return -1;
+            }
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        return fd;
+    }
+
+    bool sendAll(int fd, const std::vector<uint8_t>& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // Отдельное блокирующее соединение для MSG_STATS
+    bool queryStats(const Options& options, ServerStats& stats) {
+        int fd = connectToServer(options);
+        if (fd < 0) return false;
+
+        std::vector<uint8_t> request;
+        Protocol::Writer w(request);
+        w.begin(Protocol::MSG_STATS);
+        w.end();
+        if (!sendAll(fd, request)) {
+            ::close(fd);
+            return false;
+        }
+
+        std::vector<uint8_t> input;
+        uint8_t chunk[256];
+        size_t frame = 0;
+        while ((frame = Protocol::completeFrame(input.data(), input.size())) == 0) {
+            ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) {
+                ::close(fd);
+                return false;
+            }
+            input.insert(input.end(), chunk, chunk + n);
+        }
+        ::close(fd);
+
+        if (input[Protocol::HEADER_SIZE] != Protocol::MSG_STATS_REPLY) return false;
+        Protocol::Reader r(input.data() + Protocol::HEADER_SIZE + 1, frame - Protocol::HEADER_SIZE - 1);
+        stats.sessions = r.u32();
+        stats.connections = r.u32();
+        stats.actions = r.u64();
+        stats.cpuMicros = r.u64();
+        stats.wallMicros = r.u64();
+        return r.ok();
+    }
+
+    class LoadGenerator {
+    private:
+        Options options;
+        int epollFd;
+        std::vector<ClientConnection> connections;
+        std::mt19937 rng;
+        std::vector<uint32_t> latencies; // Микросекунды от отправки хода до ответа
+        std::vector<int> candidates;
+        uint64_t gamesFinished;
+        bool stopping;
+
+        void sendCreate(ClientConnection& conn) {
+            Protocol::Writer w(conn.output);
+            w.begin(Protocol::MSG_CREATE);
+            w.u8(static_cast<uint8_t>(options.boardSize));
+            w.u32(static_cast<uint32_t>(rng()));
+            w.u8(options.vsBot ? Protocol::BOT_PLAYER2 : 0);
+            w.end();
+        }
+
+        void sendView(ClientConnection& conn, uint32_t gameId, int playerId) {
+            Protocol::Writer w(conn.output);
+            w.begin(Protocol::MSG_VIEW);
+            w.u32(gameId);
+            w.u8(static_cast<uint8_t>(playerId));
+            w.end();
+        }
+
+        void sendLeave(ClientConnection& conn, uint32_t gameId) {
+            Protocol::Writer w(conn.output);
+            w.begin(Protocol::MSG_LEAVE);
+            w.u32(gameId);
+            w.end();
+        }
+
+        // Случайный доступный захват, а если его нет - пропуск хода
+        void sendMove(ClientConnection& conn, const Protocol::StateView& state, SessionState& session) {
+            candidates.clear();
+            int cells = state.size * state.size;
+            for (int i = 0; i < cells; ++i) {
+                if (state.cells[i] != Protocol::VIEW_FOG && (state.cells[i] & Protocol::VIEW_AVAILABLE)) {
+                    candidates.push_back(i);
+                }
+            }
+
+            Protocol::Writer w(conn.output);
+            w.begin(Protocol::MSG_ACTION);
+            w.u32(state.gameId);
+            w.u8(state.viewer);
+            if (candidates.empty()) {
+                w.u8(Protocol::ACTION_PASS);
+                w.u8(0);
+                w.u16(0);
+                w.u16(0);
+            } else {
+                int cell = candidates[rng() % candidates.size()];
+                w.u8(Protocol::ACTION_CAPTURE);
+                w.u8(0);
+                w.u16(static_cast<uint16_t>(cell / state.size));
+                w.u16(static_cast<uint16_t>(cell % state.size));
+            }
+            w.u8(0);
+            w.end();
+
+            session.actionPending = true;
+            session.actor = state.viewer;
+            session.sentAt = Clock::now();
+            ++session.moves;
+        }
+
+        void onState(ClientConnection& conn, const Protocol::StateView& state) {
+            auto it = conn.sessions.find(state.gameId);
+            if (it == conn.sessions.end()) return;
+            SessionState& session = it->second;
+
+            // Ответ на наш ход - первое состояние от лица того, кто ходил
+            if (session.actionPending && state.viewer == session.actor) {
+                latencies.push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                    Clock::now() - session.sentAt).count()));
+                session.actionPending = false;
+            }
+            if (session.actionPending) return;
+
+            if (state.gameOver || session.moves >= options.maxMoves) {
+                session.actionPending = true; // Больше не ходим в этой партии
+                sendLeave(conn, state.gameId);
+                return;
+            }
+            if (stopping) return;
+            if (state.viewer == state.toMove) {
+                sendMove(conn, state, session);
+            }
+        }
+
+        void onFrame(ClientConnection& conn, const uint8_t* frame, size_t length) {
+            Protocol::Reader r(frame + Protocol::HEADER_SIZE + 1, length - Protocol::HEADER_SIZE - 1);
+            switch (frame[Protocol::HEADER_SIZE]) {
+                case Protocol::MSG_CREATED: {
+                    uint32_t gameId = r.u32();
+                    conn.sessions[gameId] = SessionState();
+                    sendView(conn, gameId, 1);
+                    break;
+                }
+                case Protocol::MSG_STATE: {
+                    Protocol::StateView state;
+                    if (Protocol::readState(r, state)) onState(conn, state);
+                    break;
+                }
+                case Protocol::MSG_CLOSED: {
+                    conn.sessions.erase(r.u32());
+                    ++gamesFinished;
+                    if (!stopping) sendCreate(conn);
+                    break;
+                }
+                case Protocol::MSG_ERROR:
+                    std::fprintf(stderr, "Ошибка сервера: %d\n", r.u8());
+                    break;
+            }
+        }
+
+        bool pump(ClientConnection& conn) {
+            uint8_t chunk[65536];
+            for (;;) {
+                ssize_t n = ::recv(conn.fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+                if (n == 0) return false;
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                    return false;
+                }
+                conn.input.insert(conn.input.end(), chunk, chunk + n);
+            }
+            size_t consumed = 0;
+            for (;;) {
+                size_t frame = Protocol::completeFrame(conn.input.data() + consumed, conn.input.size() - consumed);
+                if (frame == 0) break;
+                onFrame(conn, conn.input.data() + consumed, frame);
+                consumed += frame;
+            }
+            conn.input.erase(conn.input.begin(), conn.input.begin() + consumed);
+
+            // Исходящие короткие, буфер сокета их вмещает - шлем блокирующе
+            bool ok = sendAll(conn.fd, conn.output);
+            conn.output.clear();
+            return ok;
+        }
+
+    public:
+        explicit LoadGenerator(const Options& opts) :
+            options(opts), epollFd(epoll_create1(EPOLL_CLOEXEC)), rng(opts.seed),
+            gamesFinished(0), stopping(false) {}
+
+        ~LoadGenerator() {
+            for (auto& conn : connections) if (conn.fd >= 0) ::close(conn.fd);
+            ::close(epollFd);
+        }
+
+        bool run() {
+            connections.resize(options.connections);
+            for (size_t c = 0; c < connections.size(); ++c) {
+                ClientConnection& conn = connections[c];
+                conn.fd = connectToServer(options);
+                if (conn.fd < 0) {
+                    std::perror("connect");
+                    return false;
+                }
+                epoll_event ev{};
+                ev.events = EPOLLIN;
+                ev.data.u32 = static_cast<uint32_t>(c);
+                epoll_ctl(epollFd, EPOLL_CTL_ADD, conn.fd, &ev);
+                for (int s = 0; s < options.sessionsPerConnection; ++s) sendCreate(conn);
+                if (!sendAll(conn.fd, conn.output)) return false;
+                conn.output.clear();
+            }
+
+            Clock::time_point deadline = Clock::now() + std::chrono::seconds(options.seconds);
+            std::vector<epoll_event> events(256);
+            while (Clock::now() < deadline) {
+                int n = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), 100);
+                if (n < 0 && errno != EINTR) return false;
+                for (int i = 0; i < n; ++i) {
+                    if (!pump(connections[events[i].data.u32])) {
+                        std::fprintf(stderr, "Сервер закрыл соединение\n");
+                        return false;
+                    }
+                }
+            }
+            stopping = true;
+            return true;
+        }
+
+        void report(const ServerStats& before, const ServerStats& after) {
+            std::sort(latencies.begin(), latencies.end());
+            auto percentile = [&](double p) -> uint32_t {
+                if (latencies.empty()) return 0;
+                size_t i = static_cast<size_t>(p * (latencies.size() - 1));
+                return latencies[i];
+            };
+
+            int sessions = options.connections * options.sessionsPerConnection;
+            double seconds = options.seconds;
+            double serverCpu = (after.cpuMicros - before.cpuMicros) / 1e6;
+            double serverWall = (after.wallMicros - before.wallMicros) / 1e6;
+            double cores = serverWall > 0 ? serverCpu / serverWall : 0;
+
+            std::printf("Партий одновременно: %d (%d соединений), поле %dx%d\n",
+                        sessions, options.connections, options.boardSize, options.boardSize);
+            std::printf("Ходов: %zu за %.1f с (%.0f ходов/с), партий доиграно: %llu\n",
+                        latencies.size(), seconds, latencies.size() / seconds,
+                        static_cast<unsigned long long>(gamesFinished));
+            std::printf("Задержка хода: p50 = %u мкс, p99 = %u мкс\n", percentile(0.50), percentile(0.99));
+            std::printf("Сервер: %.2f с CPU за %.2f с (%.2f ядра)\n", serverCpu, serverWall, cores);
+            if (cores > 0) {
+                std::printf("Партий на ядро: %.0f, ходов/с на ядро: %.0f\n",
+                            sessions / cores, latencies.size() / seconds / cores);
+            }
+        }
+    };
+
+    bool parseArgs(int argc, char** argv, Options& options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) return false;
+            std::string value = argv[++i];
+            if (arg == "--tcp") {
+                size_t colon = value.rfind(':');
+                if (colon == std::string::npos) return false;
+                options.host = value.substr(0, colon);
+                options.port = std::atoi(value.c_str() + colon + 1);
+            } else if (arg == "--unix") {
+                options.unixPath = value;
+            } else if (arg == "--connections") {
+                options.connections = std::max(1, std::atoi(value.c_str()));
+            } else if (arg == "--sessions") {
+                options.sessionsPerConnection = std::max(1, std::atoi(value.c_str()));
+            } else if (arg == "--seconds") {
+                options.seconds = std::max(1, std::atoi(value.c_str()));
+            } else if (arg == "--size") {
+                options.boardSize = std::atoi(value.c_str());
+            } else if (arg == "--max-moves") {
+                options.maxMoves = std::max(1, std::atoi(value.c_str()));
+            } else if (arg == "--vs-bot") {
+                options.vsBot = value != "0";
+            } else if (arg == "--seed") {
+                options.seed = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        std::fprintf(stderr, "Использование: %s [--tcp ХОСТ:ПОРТ | --unix ПУТЬ] [--connections N] "
+                             "[--sessions N] [--seconds N] [--size 16|32|64] [--max-moves N] [--seed N] [--vs-bot 1]\n", argv[0]);
+        return 2;
+    }
+
+    ServerStats before, after;
+    if (!queryStats(options, before)) {
+        std::fprintf(stderr, "Не удалось подключиться к серверу\n");
+        return 1;
+    }
+
+    LoadGenerator generator(options);
+    if (!generator.run()) return 1;
+
+    if (!queryStats(options, after)) return 1;
+    generator.report(before, after);
+    return 0;
+}
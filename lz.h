@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// ============= СЖАТИЕ LZ =============
+// Небольшой кодек в духе LZ4 без внешних зависимостей. Поток - цепочка
+// последовательностей:
+//   [токен][длина литералов+][литералы][смещение u16][длина совпадения+]
+// Старшие 4 бита токена - число литералов, младшие - длина совпадения
+// минус MIN_MATCH; значение 15 продолжается байтами по 255. Последняя
+// последовательность состоит только из литералов.
+namespace Lz {
+    const int MIN_MATCH = 4;
+    const int HASH_BITS = 14;
+    const int MAX_OFFSET = 0xFFFF;
+
+    inline uint32_t read32(const uint8_t* p) {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline uint32_t hash4(const uint8_t* p) {
+        return (read32(p) * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    inline void putLength(std::vector<uint8_t>& out, size_t length) {
+        while (length >= 255) {
+            out.push_back(255);
+            length -= 255;
+        }
+        out.push_back(static_cast<uint8_t>(length));
+    }
+
+    // Дописывает сжатые data[0, n) в конец out
+    inline void compress(const uint8_t* data, size_t n, std::vector<uint8_t>& out) {
+        std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0); // Позиция + 1, 0 - пусто
+        size_t anchor = 0;
+        size_t pos = 0;
+
+        auto emit = [&](size_t literalEnd, size_t matchLength, size_t offset) {
+            size_t literals = literalEnd - anchor;
+            uint8_t token = static_cast<uint8_t>((literals < 15 ? literals : 15) << 4);
+            if (matchLength > 0) {
+                size_t m = matchLength - MIN_MATCH;
+                token |= static_cast<uint8_t>(m < 15 ? m : 15);
+            }
+            out.push_back(token);
+            if (literals >= 15) putLength(out, literals - 15);
+            out.insert(out.end(), data + anchor, data + literalEnd);
+            if (matchLength > 0) {
+                out.push_back(static_cast<uint8_t>(offset));
+                out.push_back(static_cast<uint8_t>(offset >> 8));
+                if (matchLength - MIN_MATCH >= 15) putLength(out, matchLength - MIN_MATCH - 15);
+            }
+        };
+
+        while (n >= MIN_MATCH && pos + MIN_MATCH <= n) {
+            uint32_t h = hash4(data + pos);
+            size_t candidate = table[h];
+            table[h] = static_cast<uint32_t>(pos + 1);
+            if (candidate == 0 || pos - (candidate - 1) > MAX_OFFSET ||
+                read32(data + candidate - 1) != read32(data + pos)) {
+                ++pos;
+                continue;
+            }
+            size_t from = candidate - 1;
+            size_t length = MIN_MATCH;
+            while (pos + length < n && data[from + length] == data[pos + length]) ++length;
+
+            emit(pos, length, pos - from);
+            pos += length;
+            anchor = pos;
+        }
+        emit(n, 0, 0);
+    }
+
+    // Распаковывает ровно rawSize байт; false - поток поврежден
+    inline bool decompress(const uint8_t* in, size_t n, uint8_t* out, size_t rawSize) {
+        size_t ip = 0, op = 0;
+        auto readLength = [&](size_t& length) {
+            for (;;) {
+                if (ip >= n) return false;
+                uint8_t b = in[ip++];
+                length += b;
+                if (b != 255) return true;
+            }
+        };
+
+        while (ip < n) {
+            uint8_t token = in[ip++];
+            size_t literals = token >> 4;
+            if (literals == 15 && !readLength(literals)) return false;
+            if (ip + literals > n || op + literals > rawSize) return false;
+            std::memcpy(out + op, in + ip, literals);
+            ip += literals;
+            op += literals;
+            if (ip == n) break; // Последняя последовательность
+
+            if (ip + 2 > n) return false;
+            size_t offset = in[ip] | (in[ip + 1] << 8);
+            ip += 2;
+            size_t length = token & 0x0F;
+            if (length == 15 && !readLength(length)) return false;
+            length += MIN_MATCH;
+            if (offset == 0 || offset > op || op + length > rawSize) return false;
+            // Совпадение может перекрывать само себя - копируем побайтно
+            const uint8_t* from = out + op - offset;
+            for (size_t i = 0; i < length; ++i) out[op + i] = from[i];
+            op += length;
+        }
+        return op == rawSize;
+    }
+}
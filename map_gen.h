@@ -0,0 +1,302 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// ============= ГЕНЕРАТОР КАРТ =============
+// Раскладка клеток диверсии и нейтральных препятствий (укрепленных
+// нейтральных клеток) по зерну и шаблону. Карта зависит только от
+// параметров и зерна, поэтому партию по-прежнему задают размер и зерно.
+//
+// Шаблоны, кроме LEGACY, честные: каждая клетка ставится вместе с парной,
+// симметричной относительно королей, с тем же числом очков.
+//   LEGACY     - прежний addSabotageCells(): случайные попытки, без
+//                симметрии; оставлен, чтобы старые зерна (архивы, наборы,
+//                книги) давали те же партии
+//   MIRROR     - отражение по побочной диагонали: (x, y) -> (s-1-y, s-1-x)
+//   ROTATIONAL - поворот на 180 градусов: (x, y) -> (s-1-x, s-1-y)
+//   CLUSTERED  - как ROTATIONAL, но клетки кучками вокруг центров
+//   SPARSE     - как ROTATIONAL, но клетки не ближе SPARSE_SPACING друг
+//                к другу
+//
+// Свободные клетки (вне стартовых территорий и не на оси симметрии) - в
+// индексе, который строится один раз на размер поля и шаблон. Клетки из
+// него выбираются частичной перетасовкой Фишера-Йетса без повторных
+// попыток, после карты перестановки откатываются - индекс снова исходный,
+// и следующая карта не зависит от предыдущих. Карта стоит O(клеток на ней),
+// а не O(поля).
+//
+// Препятствия не касаются друг друга даже углами, поэтому не отрезают
+// никакую часть поля.
+namespace MapGen {
+    enum Template : uint8_t {
+        LEGACY,
+        MIRROR,
+        ROTATIONAL,
+        CLUSTERED,
+        SPARSE,
+        TEMPLATE_COUNT
+    };
+
+    const char* const TEMPLATE_NAMES[TEMPLATE_COUNT] = {"legacy", "mirror", "rotational", "clustered", "sparse"};
+
+    const int MIN_SABOTAGE_POINTS = 2;
+    const int MAX_SABOTAGE_POINTS = 5;
+    const int CLUSTER_SIZE = 6;      // Клеток в кучке CLUSTERED
+    const int CLUSTER_RADIUS = 2;
+    const int SPARSE_SPACING = 2;    // Чебышевское расстояние между клетками SPARSE
+
+    inline bool parseTemplate(const char* name, Template& layout) {
+        for (int i = 0; i < TEMPLATE_COUNT; ++i) {
+            if (std::strcmp(name, TEMPLATE_NAMES[i]) == 0) {
+                layout = static_cast<Template>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Что задает партия (см. Game::setMapOptions())
+    struct Options {
+        Template layout = LEGACY;
+        int obstacles = 0;           // Нейтральных препятствий
+    };
+
+    struct Params {
+        int size = 0;
+        int territory = 0;           // Сторона стартовых территорий в углах
+        int sabotage = 0;            // Клеток диверсии
+        int obstacles = 0;
+        Template layout = LEGACY;
+    };
+
+    struct Sabotage {
+        uint32_t cell;               // x * size + y
+        uint8_t value;
+    };
+
+    // Результат: клетки по порядку. В LEGACY клетка может повториться -
+    // тогда действует последняя запись, как и в старом коде.
+    struct Map {
+        int size = 0;
+        std::vector<Sabotage> sabotage;
+        std::vector<uint32_t> obstacles;
+    };
+
+    // SplitMix64: быстрый и одинаковый на всех платформах (в отличие от
+    // распределений std)
+    struct Rng {
+        uint64_t state;
+
+        explicit Rng(uint64_t seed) : state(seed) {}
+
+        uint64_t next() {
+            uint64_t v = (state += 0x9E3779B97F4A7C15ull);
+            v = (v ^ (v >> 30)) * 0xBF58476D1CE4E5B9ull;
+            v = (v ^ (v >> 27)) * 0x94D049BB133111EBull;
+            return v ^ (v >> 31);
+        }
+
+        // [0, bound) умножением вместо деления
+        uint32_t below(uint32_t bound) {
+            return static_cast<uint32_t>(((next() >> 32) * bound) >> 32);
+        }
+    };
+
+    class Generator {
+    private:
+        enum State : uint8_t { FREE, SABOTAGE, OBSTACLE };
+
+        // Для чего построен индекс
+        int indexSize = -1;
+        int indexTerritory = -1;
+        bool indexMirror = false;
+
+        int size = 0;
+        int territory = 0;
+        bool mirror = false;
+        std::vector<uint32_t> freeCells;  // Канонические клетки пар
+        std::vector<uint32_t> swaps;      // Перестановки текущей карты
+        std::vector<uint8_t> state;       // Все FREE между картами
+        Map map;
+
+        bool inTerritory(int x, int y) const {
+            return (x < territory && y < territory) || (x >= size - territory && y >= size - territory);
+        }
+
+        uint32_t partner(uint32_t cell) const {
+            int x = static_cast<int>(cell) / size, y = static_cast<int>(cell) % size;
+            if (mirror) return static_cast<uint32_t>((size - 1 - y) * size + (size - 1 - x));
+            return static_cast<uint32_t>(size * size - 1) - cell;
+        }
+
+        void buildIndex() {
+            freeCells.clear();
+            for (int x = 0; x < size; ++x) {
+                for (int y = 0; y < size; ++y) {
+                    uint32_t cell = static_cast<uint32_t>(x * size + y);
+                    if (!inTerritory(x, y) && cell < partner(cell)) freeCells.push_back(cell);
+                }
+            }
+            state.assign(static_cast<size_t>(size) * size, FREE);
+            indexSize = size;
+            indexTerritory = territory;
+            indexMirror = mirror;
+        }
+
+        // Следующая клетка из индекса, false - индекс исчерпан
+        bool draw(Rng& rng, uint32_t& cell) {
+            size_t taken = swaps.size();
+            if (taken >= freeCells.size()) return false;
+            size_t j = taken + rng.below(static_cast<uint32_t>(freeCells.size() - taken));
+            std::swap(freeCells[taken], freeCells[j]);
+            swaps.push_back(static_cast<uint32_t>(j));
+            cell = freeCells[taken];
+            return true;
+        }
+
+        void undoDraws() {
+            for (size_t t = swaps.size(); t-- > 0;) std::swap(freeCells[t], freeCells[swaps[t]]);
+            swaps.clear();
+        }
+
+        // Нет клетки в состоянии what ближе radius (по Чебышеву)
+        bool clearAround(uint32_t cell, int radius, State what) const {
+            int x = static_cast<int>(cell) / size, y = static_cast<int>(cell) % size;
+            for (int nx = std::max(0, x - radius); nx <= std::min(size - 1, x + radius); ++nx) {
+                for (int ny = std::max(0, y - radius); ny <= std::min(size - 1, y + radius); ++ny) {
+                    if (state[nx * size + ny] == what) return false;
+                }
+            }
+            return true;
+        }
+
+        bool near(uint32_t a, uint32_t b, int radius) const {
+            int ax = static_cast<int>(a) / size, ay = static_cast<int>(a) % size;
+            int bx = static_cast<int>(b) / size, by = static_cast<int>(b) % size;
+            return std::abs(ax - bx) <= radius && std::abs(ay - by) <= radius;
+        }
+
+        void putSabotage(uint32_t cell, uint8_t value) {
+            state[cell] = SABOTAGE;
+            map.sabotage.push_back({cell, value});
+        }
+
+        // Пара клеток диверсии, если обе свободны (и разнесены для SPARSE)
+        bool tryPair(uint32_t cell, Rng& rng, int spacing) {
+            uint32_t other = partner(cell);
+            if (cell == other || state[cell] != FREE || state[other] != FREE) return false;
+            if (spacing > 0 && (!clearAround(cell, spacing, SABOTAGE) || !clearAround(other, spacing, SABOTAGE) ||
+                                near(cell, other, spacing))) {
+                return false;
+            }
+            uint8_t value = static_cast<uint8_t>(MIN_SABOTAGE_POINTS +
+                                                 rng.below(MAX_SABOTAGE_POINTS - MIN_SABOTAGE_POINTS + 1));
+            putSabotage(cell, value);
+            putSabotage(other, value);
+            return true;
+        }
+
+        // Прежний addSabotageCells() бит в бит: те же вызовы mt19937
+        void placeLegacy(const Params& params, uint32_t seed) {
+            std::mt19937 rng(seed);
+            std::uniform_int_distribution<> distrib(0, size - 1);
+            std::uniform_int_distribution<> pointsDistrib(MIN_SABOTAGE_POINTS, MAX_SABOTAGE_POINTS);
+            int placed = 0;
+            int attempts = 0;
+            while (placed < params.sabotage && attempts < size * size * 2) {
+                int x = distrib(rng);
+                int y = distrib(rng);
+                if (!inTerritory(x, y)) {
+                    putSabotage(static_cast<uint32_t>(x * size + y), static_cast<uint8_t>(pointsDistrib(rng)));
+                    ++placed;
+                }
+                ++attempts;
+            }
+        }
+
+        void placeUniform(int pairs, Rng& rng, int spacing) {
+            uint32_t cell;
+            while (pairs > 0 && draw(rng, cell)) {
+                if (tryPair(cell, rng, spacing)) --pairs;
+            }
+        }
+
+        void placeClusters(int pairs, Rng& rng) {
+            uint32_t center;
+            int side = 2 * CLUSTER_RADIUS + 1;
+            while (pairs > 0 && draw(rng, center)) {
+                int cx = static_cast<int>(center) / size, cy = static_cast<int>(center) % size;
+                int want = std::min(pairs, CLUSTER_SIZE / 2);
+                for (int attempt = 0; want > 0 && attempt < CLUSTER_SIZE * 4; ++attempt) {
+                    uint32_t offset = rng.below(static_cast<uint32_t>(side * side));
+                    int x = cx + static_cast<int>(offset) / side - CLUSTER_RADIUS;
+                    int y = cy + static_cast<int>(offset) % side - CLUSTER_RADIUS;
+                    if (x < 0 || x >= size || y < 0 || y >= size || inTerritory(x, y)) continue;
+                    if (tryPair(static_cast<uint32_t>(x * size + y), rng, 0)) {
+                        --want;
+                        --pairs;
+                    }
+                }
+            }
+        }
+
+        void placeObstacles(int pairs, Rng& rng) {
+            uint32_t cell;
+            while (pairs > 0 && draw(rng, cell)) {
+                uint32_t other = partner(cell);
+                if (state[cell] != FREE || state[other] != FREE || near(cell, other, 1) ||
+                    !clearAround(cell, 1, OBSTACLE) || !clearAround(other, 1, OBSTACLE)) {
+                    continue;
+                }
+                state[cell] = OBSTACLE;
+                state[other] = OBSTACLE;
+                map.obstacles.push_back(cell);
+                map.obstacles.push_back(other);
+                --pairs;
+            }
+        }
+
+    public:
+        // Свой генератор у каждого потока: индекс и буферы переиспользуются
+        // от карты к карте
+        static Generator& local() {
+            static thread_local Generator generator;
+            return generator;
+        }
+
+        // Карта действительна до следующего вызова. Нечетные числа клеток в
+        // симметричных шаблонах округляются вверх до пар; если подходящие
+        // клетки в индексе кончились, их меньше.
+        const Map& generate(const Params& params, uint32_t seed) {
+            size = params.size;
+            territory = std::min(params.territory, size);
+            mirror = params.layout == MIRROR;
+            if (size != indexSize || territory != indexTerritory || mirror != indexMirror) buildIndex();
+            map.size = size;
+            map.sabotage.clear();
+            map.obstacles.clear();
+
+            Rng rng(seed * 0x2545F4914F6CDD1Dull + params.layout);
+            int pairs = (params.sabotage + 1) / 2;
+            switch (params.layout) {
+                case LEGACY: placeLegacy(params, seed); break;
+                case MIRROR:
+                case ROTATIONAL: placeUniform(pairs, rng, 0); break;
+                case CLUSTERED: placeClusters(pairs, rng); break;
+                case SPARSE: placeUniform(pairs, rng, SPARSE_SPACING); break;
+                default: break;
+            }
+            placeObstacles((params.obstacles + 1) / 2, rng);
+
+            undoDraws();
+            for (const Sabotage& s : map.sabotage) state[s.cell] = FREE;
+            for (uint32_t cell : map.obstacles) state[cell] = FREE;
+            return map;
+        }
+    };
+}
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "map_gen.h"
+#include "thread_pool.h"
+
+// ============= ГЕНЕРАТОР КАРТ: ЗАМЕР И ПРОВЕРКА =============
+// Строит --maps карт по шаблону map_gen.h на пуле потоков и печатает,
+// сколько карт в секунду получается и насколько карты честные: очки
+// диверсии ближе к королю 1 и ближе к королю 2 (по Манхэттену). С --print
+// печатает первую карту.
+//
+//   ./mapgen --size 1024 --template rotational --maps 2000
+//   ./mapgen --size 64 --template clustered --obstacles 40 --print
+
+namespace {
+    struct Options {
+        int size = 64;
+        int territory = 12;
+        int sabotage = -1;       // -1 - как на большом поле игры: клетки / 40
+        int obstacles = 0;
+        int maps = 1000;
+        uint32_t seed = 1;
+        MapGen::Template layout = MapGen::ROTATIONAL;
+        bool print = false;
+    };
+
+    // Перевес очков у одного из королей на карте
+    int imbalance(const MapGen::Map& map) {
+        int points[2] = {0, 0};
+        for (const MapGen::Sabotage& s : map.sabotage) {
+            int x = static_cast<int>(s.cell) / map.size, y = static_cast<int>(s.cell) % map.size;
+            int toFirst = x + y;
+            int toSecond = 2 * (map.size - 1) - x - y;
+            if (toFirst < toSecond) points[0] += s.value;
+            if (toSecond < toFirst) points[1] += s.value;
+        }
+        return std::abs(points[0] - points[1]);
+    }
+
+    void printMap(const MapGen::Map& map) {
+        std::vector<char> marks(static_cast<size_t>(map.size) * map.size, '.');
+        for (const MapGen::Sabotage& s : map.sabotage) marks[s.cell] = static_cast<char>('0' + s.value);
+        for (uint32_t cell : map.obstacles) marks[cell] = '#';
+        marks[0] = 'K';
+        marks[marks.size() - 1] = 'K';
+        for (int y = 0; y < map.size; ++y) {
+            for (int x = 0; x < map.size; ++x) std::putchar(marks[x * map.size + y]);
+            std::putchar('\n');
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--print") {
+            options.print = true;
+        } else if (i + 1 < argc && arg == "--size") {
+            options.size = std::atoi(argv[++i]);
+        } else if (i + 1 < argc && arg == "--territory") {
+            options.territory = std::max(1, std::atoi(argv[++i]));
+        } else if (i + 1 < argc && arg == "--sabotage") {
+            options.sabotage = std::max(0, std::atoi(argv[++i]));
+        } else if (i + 1 < argc && arg == "--obstacles") {
+            options.obstacles = std::max(0, std::atoi(argv[++i]));
+        } else if (i + 1 < argc && arg == "--maps") {
+            options.maps = std::max(1, std::atoi(argv[++i]));
+        } else if (i + 1 < argc && arg == "--seed") {
+            options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (i + 1 < argc && arg == "--template" && MapGen::parseTemplate(argv[i + 1], options.layout)) {
+            ++i;
+        } else {
+            std::fprintf(stderr, "Использование: %s [--size N] [--territory N] [--sabotage N] [--obstacles N] "
+                                 "[--maps N] [--seed N]\n       [--template legacy|mirror|rotational|clustered|sparse] "
+                                 "[--print]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (options.size < 2 * options.territory + 2 || options.size > 4096) {
+        std::fprintf(stderr, "Недопустимый размер поля\n");
+        return 2;
+    }
+
+    MapGen::Params params;
+    params.size = options.size;
+    params.territory = options.territory;
+    params.sabotage = options.sabotage >= 0 ? options.sabotage : std::max(10, options.size * options.size / 40);
+    params.obstacles = options.obstacles;
+    params.layout = options.layout;
+
+    if (options.print) {
+        printMap(MapGen::Generator::local().generate(params, options.seed));
+        return 0;
+    }
+
+    // Индекс строится один раз на поток - до замера
+    ThreadPool& pool = ThreadPool::instance();
+    pool.parallelFor(0, pool.threadCount(), 1, [&](int, int) { MapGen::Generator::local().generate(params, 0); });
+
+    std::atomic<uint64_t> cells{0}, totalImbalance{0};
+    std::atomic<int> worstImbalance{0};
+    auto start = std::chrono::steady_clock::now();
+    pool.parallelFor(0, options.maps, 16, [&](int begin, int end) {
+        uint64_t placed = 0, sum = 0;
+        int worst = 0;
+        for (int i = begin; i < end; ++i) {
+            const MapGen::Map& map = MapGen::Generator::local().generate(params, options.seed + static_cast<uint32_t>(i));
+            placed += map.sabotage.size() + map.obstacles.size();
+            int d = imbalance(map);
+            sum += static_cast<uint64_t>(d);
+            worst = std::max(worst, d);
+        }
+        cells += placed;
+        totalImbalance += sum;
+        int seen = worstImbalance.load();
+        while (worst > seen && !worstImbalance.compare_exchange_weak(seen, worst)) {}
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("Карт: %d, поле %dx%d, шаблон %s, потоков: %d\n", options.maps, options.size, options.size,
+                MapGen::TEMPLATE_NAMES[options.layout], pool.threadCount());
+    std::printf("%.0f карт/с (%.1f мкс на карту), клеток на карте: %.1f\n", options.maps / seconds,
+                seconds * 1e6 / options.maps, static_cast<double>(cells.load()) / options.maps);
+    std::printf("Перевес очков диверсии у одного короля: в среднем %.2f, наибольший %d\n",
+                static_cast<double>(totalImbalance.load()) / options.maps, worstImbalance.load());
+    return 0;
+}
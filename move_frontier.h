@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "cow_grid.h"
+
+// ============= ДОСТУПНЫЕ ЗАХВАТЫ =============
+// Игрок может захватить клетку, если она не его, не королевская, не
+// укреплена и рядом есть его неукрепленная клетка. Туман здесь не
+// участвует: своя клетка и ее соседи всегда в радиусе видимости.
+//
+// Для каждого игрока клетки, которые он может захватить, лежат в
+// разреженном множестве: плотный массив клеток и позиция каждой клетки в
+// нем. У каждой клетки еще хранится, сколько рядом неукрепленных клеток
+// каждого игрока. Смена владельца или укрепления клетки правит эти
+// счетчики у четырех соседей и членство пяти клеток - O(1) на игрока, без
+// прохода по полю. Перечислить захваты - пройти плотный массив, случайный
+// захват - один индекс в нем.
+//
+// Как и в king_threat.h, состояние клеток здесь свое, его меняет только
+// cellChanged(), а поклеточные массивы - CowArray. Плотные массивы
+// копируются целиком: в них только клетки на границе.
+class MoveFrontier {
+public:
+    static constexpr int MAX_PLAYERS = 8;
+    static constexpr uint32_t ABSENT = 0xFFFFFFFF;
+
+private:
+    int size = 0;
+    int cells = 0;
+    int players = 0;
+    CowArray<uint8_t> owner;      // 0 - нейтральная, иначе номер игрока с 1
+    CowArray<uint8_t> fortified;
+    CowArray<uint8_t> king;
+    CowArray<uint8_t> sources;    // [игрок * клеток + клетка] - неукрепленных соседей игрока
+    CowArray<uint32_t> position;  // [игрок * клеток + клетка] - индекс в dense, ABSENT - нет
+    std::vector<uint32_t> dense[MAX_PLAYERS];
+
+    // Чьи захваты клетка открывает соседям (с 0), -1 - ничьи
+    int sourceOf(int i) const {
+        return owner[i] != 0 && !fortified[i] ? owner[i] - 1 : -1;
+    }
+
+    template <typename Fn>
+    void forNeighbours(int i, Fn&& fn) const {
+        int x = i / size, y = i % size;
+        if (x > 0) fn(i - size);
+        if (x + 1 < size) fn(i + size);
+        if (y > 0) fn(i - 1);
+        if (y + 1 < size) fn(i + 1);
+    }
+
+    // Членство клетки i в множестве игрока p по ее счетчику и состоянию
+    void refresh(int p, int i) {
+        bool capturable = sources[p * cells + i] > 0 && owner[i] != p + 1 && !fortified[i] && !king[i];
+        uint32_t at = position[p * cells + i];
+        std::vector<uint32_t>& set = dense[p];
+        if (capturable && at == ABSENT) {
+            position.edit(p * cells + i) = static_cast<uint32_t>(set.size());
+            set.push_back(static_cast<uint32_t>(i));
+        } else if (!capturable && at != ABSENT) {
+            uint32_t last = set.back();
+            set[at] = last;
+            position.edit(p * cells + last) = at;
+            set.pop_back();
+            position.edit(p * cells + i) = ABSENT;
+        }
+    }
+
+    void shiftSources(int p, int i, int sign) {
+        forNeighbours(i, [&](int n) {
+            uint8_t& count = sources.edit(p * cells + n);
+            count = static_cast<uint8_t>(count + sign);
+            refresh(p, n);
+        });
+    }
+
+public:
+    // Новое поле: все клетки нейтральные. Клетки задаются setInitial(),
+    // затем rebuild(). Место под множества резервируется сразу, чтобы
+    // ходы не выделяли память.
+    void reset(int boardSize, int playerCount) {
+        size = boardSize;
+        cells = size * size;
+        players = playerCount;
+        owner.assign(cells, 0);
+        fortified.assign(cells, 0);
+        king.assign(cells, 0);
+        sources.assign(static_cast<size_t>(players) * cells, 0);
+        position.assign(static_cast<size_t>(players) * cells, ABSENT);
+        for (int p = 0; p < MAX_PLAYERS; ++p) {
+            dense[p].clear();
+            if (p < players) dense[p].reserve(cells);
+        }
+    }
+
+    void setInitial(int x, int y, int ownerId, bool isFortified, bool kingCell) {
+        int i = x * size + y;
+        owner.edit(i) = static_cast<uint8_t>(ownerId);
+        fortified.edit(i) = isFortified;
+        king.edit(i) = kingCell;
+    }
+
+    // Множества по порядку клеток
+    void rebuild() {
+        for (int i = 0; i < cells; ++i) {
+            int p = sourceOf(i);
+            if (p >= 0) forNeighbours(i, [&](int n) { sources.edit(p * cells + n)++; });
+        }
+        for (int p = 0; p < players; ++p) {
+            for (int i = 0; i < cells; ++i) refresh(p, i);
+        }
+    }
+
+    // Все массивы своими (см. Game::detach())
+    void detach() {
+        owner.detach();
+        fortified.detach();
+        king.detach();
+        sources.detach();
+        position.detach();
+    }
+
+    // Клетка (x, y) сменила владельца или укрепление
+    void cellChanged(int x, int y, int ownerId, bool isFortified) {
+        int i = x * size + y;
+        int before = sourceOf(i);
+        owner.set(i, static_cast<uint8_t>(ownerId));
+        fortified.set(i, isFortified);
+        int after = sourceOf(i);
+        if (before != after) {
+            if (before >= 0) shiftSources(before, i, -1);
+            if (after >= 0) shiftSources(after, i, +1);
+        }
+        for (int p = 0; p < players; ++p) refresh(p, i);
+    }
+
+    bool contains(int player, int x, int y) const {
+        return position[player * cells + x * size + y] != ABSENT;
+    }
+
+    // Клетки (x * size + y), которые может захватить игрок (с 0), в
+    // произвольном порядке
+    const std::vector<uint32_t>& capturable(int player) const {
+        return dense[player];
+    }
+};
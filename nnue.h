@@ -0,0 +1,376 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "game.h"
+
+// ============= НЕЙРОСЕТЕВАЯ ОЦЕНКА (NNUE) =============
+// Оценка позиции небольшой сетью, первый слой которой не пересчитывается
+// с нуля: входы разреженные (клетка x владелец, укрепление, диверсия,
+// расстояние до вражеского короля), и изменение клетки меняет не больше
+// четырех входов. Аккумулятор (сумма столбцов первого слоя по включенным
+// входам) поддерживается по тем же CellDiff, что пишет журнал партии:
+// до изменения вычитаются столбцы старых входов клетки, после - добавляются
+// новые.
+//
+// Сеть: входы -> HIDDEN1 (int16, аккумулятор) -> обрезанный ReLU до int8 ->
+// HIDDEN2 (веса int8) -> обрезанный ReLU -> 1 (веса int8). Оценка - с
+// точки зрения игрока 1, для игрока 2 знак меняется. Очки игроков - тоже
+// входы, но они не в клетках, поэтому добавляются при каждой оценке.
+//
+// Веса учит nnuetrain.cpp по шардам самоигры (dataset.h). Сеть своя для
+// каждого размера поля.
+namespace Nnue {
+    const int HIDDEN1 = 64;
+    const int HIDDEN2 = 32;
+    const int KING_BUCKETS = 32;
+    const int SCORE_BUCKETS = 32;
+    const int SCORE_DIFF_BUCKETS = 64;
+    const int SCORE_FEATURES = 3;
+    const int MAX_CELL_FEATURES = 4;
+
+    // Квантование: активации первого и второго слоя - [0, ACTIVATION_SCALE],
+    // веса второго и третьего слоя - с множителем WEIGHT_SCALE
+    const int ACTIVATION_SCALE = 127;
+    const int WEIGHT_SCALE = 64;
+    const int WEIGHT_SHIFT = 6;
+    const int OUTPUT_SCALE = 100;    // Единиц оценки на единицу логита
+
+    const uint32_t FILE_MAGIC = 0x4E4E5743; // "CWNN"
+    const uint32_t FILE_VERSION = 1;
+
+    // ============= ВХОДЫ =============
+    // Плоскости входов по N = size * size клеток:
+    //   [0, N)    - клетка игрока 1      [N, 2N)   - клетка игрока 2
+    //   [2N, 3N)  - укрепление игрока 1  [3N, 4N)  - укрепление игрока 2
+    //   [4N, 5N)  - диверсия
+    //   затем KING_BUCKETS на игрока - клетка игрока на таком расстоянии
+    //   до вражеского короля, SCORE_BUCKETS на игрока - его очки (хватит
+    //   ли на способности) и SCORE_DIFF_BUCKETS - разница очков
+    struct Layout {
+        int size = 0;
+        int kingX[2] = {0, 0};
+        int kingY[2] = {0, 0};
+
+        int cells() const { return size * size; }
+        int kingBase() const { return 5 * cells(); }
+        int scoreBase() const { return kingBase() + 2 * KING_BUCKETS; }
+        int features() const { return scoreBase() + 2 * SCORE_BUCKETS + SCORE_DIFF_BUCKETS; }
+
+        static Layout of(const Game& game) {
+            Layout layout;
+            layout.size = game.getSize();
+            for (int i = 0; i < 2; ++i) {
+                layout.kingX[i] = game.getPlayer(i).kingX;
+                layout.kingY[i] = game.getPlayer(i).kingY;
+            }
+            return layout;
+        }
+
+        // Входы клетки (x, y) в открытом состоянии packed (packCell), до
+        // MAX_CELL_FEATURES штук
+        int cellFeatures(int x, int y, uint16_t packed, uint32_t* out) const {
+            Cell cell;
+            unpackCell(packed, cell);
+            int n = 0;
+            uint32_t index = static_cast<uint32_t>(x * size + y);
+            uint32_t plane = static_cast<uint32_t>(cells());
+            if (cell.ownerId == 1 || cell.ownerId == 2) {
+                int p = cell.ownerId - 1;
+                out[n++] = p * plane + index;
+                if (cell.isFortified) out[n++] = (2 + p) * plane + index;
+                int enemy = 1 - p;
+                int d = std::abs(x - kingX[enemy]) + std::abs(y - kingY[enemy]);
+                out[n++] = static_cast<uint32_t>(kingBase() + p * KING_BUCKETS + d * KING_BUCKETS / (2 * size - 1));
+            }
+            if (cell.sabotageCell) out[n++] = 4 * plane + index;
+            return n;
+        }
+
+        // Входы очков, SCORE_FEATURES штук
+        void scoreFeatures(int score1, int score2, uint32_t* out) const {
+            int scores[2] = {score1, score2};
+            for (int p = 0; p < 2; ++p) {
+                int bucket = std::min(std::max(scores[p], 0) / 4, SCORE_BUCKETS - 1);
+                out[p] = static_cast<uint32_t>(scoreBase() + p * SCORE_BUCKETS + bucket);
+            }
+            int half = SCORE_DIFF_BUCKETS / 2;
+            int diff = std::min(std::max(score1 - score2, -half), half - 1) + half;
+            out[2] = static_cast<uint32_t>(scoreBase() + 2 * SCORE_BUCKETS + diff);
+        }
+    };
+
+    // ============= SIMD =============
+    // Ядра для векторов длины, кратной 16 (32 для AVX2 в dot); без
+    // SSE2 - обычные циклы
+    namespace Simd {
+        inline void addRow(int16_t* acc, const int16_t* row, int n) {
+            int i = 0;
+#if defined(__AVX2__)
+            for (; i + 16 <= n; i += 16) {
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i));
+                __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_add_epi16(a, w));
+            }
+#elif defined(__SSE2__)
+            for (; i + 8 <= n; i += 8) {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i));
+                __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + i), _mm_add_epi16(a, w));
+            }
+#endif
+            for (; i < n; ++i) acc[i] = static_cast<int16_t>(acc[i] + row[i]);
+        }
+
+        inline void subRow(int16_t* acc, const int16_t* row, int n) {
+            int i = 0;
+#if defined(__AVX2__)
+            for (; i + 16 <= n; i += 16) {
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i));
+                __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_sub_epi16(a, w));
+            }
+#elif defined(__SSE2__)
+            for (; i + 8 <= n; i += 8) {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i));
+                __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + i), _mm_sub_epi16(a, w));
+            }
+#endif
+            for (; i < n; ++i) acc[i] = static_cast<int16_t>(acc[i] - row[i]);
+        }
+
+        // Обрезанный ReLU: int16 -> [0, ACTIVATION_SCALE] в uint8
+        inline void clippedRelu(const int16_t* in, uint8_t* out, int n) {
+            int i = 0;
+#if defined(__SSE2__)
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i top = _mm_set1_epi16(ACTIVATION_SCALE);
+            for (; i + 16 <= n; i += 16) {
+                __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 8));
+                lo = _mm_min_epi16(_mm_max_epi16(lo, zero), top);
+                hi = _mm_min_epi16(_mm_max_epi16(hi, zero), top);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(lo, hi));
+            }
+#endif
+            for (; i < n; ++i) out[i] = static_cast<uint8_t>(std::min<int>(std::max<int>(in[i], 0), ACTIVATION_SCALE));
+        }
+
+        // Скалярное произведение uint8 (активации до 127) на int8 (веса)
+        inline int32_t dot(const uint8_t* a, const int8_t* w, int n) {
+            int32_t sum = 0;
+            int i = 0;
+#if defined(__AVX2__)
+            // maddubs не переполняется: 2 * 127 * 127 < 32767
+            __m256i acc = _mm256_setzero_si256();
+            const __m256i ones = _mm256_set1_epi16(1);
+            for (; i + 32 <= n; i += 32) {
+                __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+                __m256i vw = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w + i));
+                acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_maddubs_epi16(va, vw), ones));
+            }
+            __m128i half = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+            half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+            half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+            sum = _mm_cvtsi128_si32(half);
+#elif defined(__SSE2__)
+            __m128i acc = _mm_setzero_si128();
+            const __m128i zero = _mm_setzero_si128();
+            for (; i + 16 <= n; i += 16) {
+                __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+                __m128i vw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(w + i));
+                // Расширение до int16: активации нулями, веса знаком
+                __m128i aLo = _mm_unpacklo_epi8(va, zero);
+                __m128i aHi = _mm_unpackhi_epi8(va, zero);
+                __m128i wLo = _mm_srai_epi16(_mm_unpacklo_epi8(vw, vw), 8);
+                __m128i wHi = _mm_srai_epi16(_mm_unpackhi_epi8(vw, vw), 8);
+                acc = _mm_add_epi32(acc, _mm_madd_epi16(aLo, wLo));
+                acc = _mm_add_epi32(acc, _mm_madd_epi16(aHi, wHi));
+            }
+            acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4E));
+            acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xB1));
+            sum = _mm_cvtsi128_si32(acc);
+#endif
+            for (; i < n; ++i) sum += static_cast<int32_t>(a[i]) * w[i];
+            return sum;
+        }
+    }
+
+    // ============= СЕТЬ =============
+    // Файл весов: [magic u32][version u32][size u32][HIDDEN1 u32][HIDDEN2 u32],
+    // затем w1 (features x HIDDEN1 int16, по столбцу на вход), b1 (int16),
+    // w2 (HIDDEN2 x HIDDEN1 int8), b2 (int32), w3 (HIDDEN2 int8), b3 (int32).
+    // Порядок байт - как у машины, писавшей файл.
+    struct Network {
+        int size = 0;
+        std::vector<int16_t> w1;
+        int16_t b1[HIDDEN1] = {};
+        int8_t w2[HIDDEN2 * HIDDEN1] = {};
+        int32_t b2[HIDDEN2] = {};
+        int8_t w3[HIDDEN2] = {};
+        int32_t b3 = 0;
+
+        void resize(int boardSize) {
+            Layout layout;
+            layout.size = boardSize;
+            size = boardSize;
+            w1.assign(static_cast<size_t>(layout.features()) * HIDDEN1, 0);
+        }
+
+        const int16_t* column(uint32_t feature) const { return &w1[static_cast<size_t>(feature) * HIDDEN1]; }
+
+        bool load(const std::string& path) {
+            std::ifstream in(path, std::ios::binary);
+            uint32_t header[5];
+            if (!in.read(reinterpret_cast<char*>(header), sizeof(header))) return false;
+            if (header[0] != FILE_MAGIC || header[1] != FILE_VERSION || header[3] != HIDDEN1 || header[4] != HIDDEN2 ||
+                header[2] < static_cast<uint32_t>(Constants::MIN_BOARD_SIZE) ||
+                header[2] > static_cast<uint32_t>(Constants::MAX_BOARD_SIZE)) {
+                return false;
+            }
+            resize(static_cast<int>(header[2]));
+            in.read(reinterpret_cast<char*>(w1.data()), static_cast<std::streamsize>(w1.size() * sizeof(int16_t)));
+            in.read(reinterpret_cast<char*>(b1), sizeof(b1));
+            in.read(reinterpret_cast<char*>(w2), sizeof(w2));
+            in.read(reinterpret_cast<char*>(b2), sizeof(b2));
+            in.read(reinterpret_cast<char*>(w3), sizeof(w3));
+            in.read(reinterpret_cast<char*>(&b3), sizeof(b3));
+            return static_cast<bool>(in);
+        }
+
+        bool save(const std::string& path) const {
+            std::ofstream out(path, std::ios::binary);
+            uint32_t header[5] = {FILE_MAGIC, FILE_VERSION, static_cast<uint32_t>(size), HIDDEN1, HIDDEN2};
+            out.write(reinterpret_cast<const char*>(header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(w1.data()), static_cast<std::streamsize>(w1.size() * sizeof(int16_t)));
+            out.write(reinterpret_cast<const char*>(b1), sizeof(b1));
+            out.write(reinterpret_cast<const char*>(w2), sizeof(w2));
+            out.write(reinterpret_cast<const char*>(b2), sizeof(b2));
+            out.write(reinterpret_cast<const char*>(w3), sizeof(w3));
+            out.write(reinterpret_cast<const char*>(&b3), sizeof(b3));
+            return static_cast<bool>(out);
+        }
+    };
+
+    // ============= АККУМУЛЯТОР =============
+    struct Accumulator {
+        alignas(32) int16_t values[HIDDEN1];
+        Layout layout;
+    };
+
+    class Evaluator {
+    private:
+        const Network& net;
+
+    public:
+        explicit Evaluator(const Network& network) : net(network) {}
+
+        const Network& network() const { return net; }
+
+        // Аккумулятор с нуля по всему полю - при создании партии или для
+        // проверки инкрементального
+        void refresh(const Game& game, Accumulator& acc) const {
+            acc.layout = Layout::of(game);
+            std::copy(net.b1, net.b1 + HIDDEN1, acc.values);
+            uint32_t features[MAX_CELL_FEATURES];
+            int size = game.getSize();
+            for (int x = 0; x < size; ++x) {
+                for (int y = 0; y < size; ++y) {
+                    int n = acc.layout.cellFeatures(x, y, packCell(game.getCell(x, y)), features);
+                    for (int i = 0; i < n; ++i) Simd::addRow(acc.values, net.column(features[i]), HIDDEN1);
+                }
+            }
+        }
+
+        // Одно изменение клетки: старые входы вычитаются, новые добавляются
+        void update(Accumulator& acc, const CellDiff& diff) const {
+            uint32_t features[MAX_CELL_FEATURES];
+            int n = acc.layout.cellFeatures(diff.x, diff.y, diff.before, features);
+            for (int i = 0; i < n; ++i) Simd::subRow(acc.values, net.column(features[i]), HIDDEN1);
+            n = acc.layout.cellFeatures(diff.x, diff.y, diff.after, features);
+            for (int i = 0; i < n; ++i) Simd::addRow(acc.values, net.column(features[i]), HIDDEN1);
+        }
+
+        // Все изменения журнала партии (Game::getCellJournal())
+        void update(Accumulator& acc, const std::vector<CellDiff>& journal) const {
+            for (const CellDiff& diff : journal) update(acc, diff);
+        }
+
+        // Оценка с точки зрения игрока 1, в единицах OUTPUT_SCALE на логит
+        int evaluate(const Accumulator& acc, int score1, int score2) const {
+            alignas(32) int16_t hidden[HIDDEN1];
+            std::copy(acc.values, acc.values + HIDDEN1, hidden);
+            uint32_t features[SCORE_FEATURES];
+            acc.layout.scoreFeatures(score1, score2, features);
+            for (uint32_t feature : features) Simd::addRow(hidden, net.column(feature), HIDDEN1);
+
+            alignas(32) uint8_t a1[HIDDEN1];
+            Simd::clippedRelu(hidden, a1, HIDDEN1);
+
+            alignas(32) uint8_t a2[HIDDEN2];
+            for (int j = 0; j < HIDDEN2; ++j) {
+                int32_t z = Simd::dot(a1, &net.w2[j * HIDDEN1], HIDDEN1) + net.b2[j];
+                a2[j] = static_cast<uint8_t>(std::min(std::max(z >> WEIGHT_SHIFT, 0), ACTIVATION_SCALE));
+            }
+            int64_t out = static_cast<int64_t>(Simd::dot(a2, net.w3, HIDDEN2)) + net.b3;
+            return static_cast<int>(out * OUTPUT_SCALE / (ACTIVATION_SCALE * WEIGHT_SCALE));
+        }
+
+        // Оценка для игрока playerId (1-2), как Bot::evaluate()
+        int evaluate(const Game& game, const Accumulator& acc, int playerId) const {
+            if (game.isGameOver()) {
+                return game.getWinner() == playerId ? INT_MAX / 2 : INT_MIN / 2;
+            }
+            int value = evaluate(acc, game.getPlayer(0).score, game.getPlayer(1).score);
+            return playerId == 1 ? value : -value;
+        }
+
+        // Жадный ход на один вперед, как Bot::chooseMove(), но позиции
+        // оцениваются сетью: аккумулятор копии партии - это аккумулятор
+        // текущей позиции плюс изменения из журнала хода
+        Action chooseMove(const Game& game, const Accumulator& acc, uint32_t seed) const {
+            int size = game.getSize();
+            int playerId = game.getCurrentPlayer() + 1;
+            std::mt19937 rng(seed);
+
+            Action best = Action::pass();
+            int bestScore = INT_MIN;
+            int ties = 0;
+
+            for (int x = 0; x < size; ++x) {
+                for (int y = 0; y < size; ++y) {
+                    if (!game.isCellAvailable(x, y)) continue;
+
+                    Game trial = game.fork();
+                    trial.setJournalEnabled(true);
+                    if (!trial.playCapture(x, y)) continue;
+                    Accumulator next = acc;
+                    update(next, trial.getCellJournal());
+                    int score = evaluate(trial, next, playerId);
+
+                    if (score > bestScore) {
+                        bestScore = score;
+                        best = Action::capture(x, y);
+                        ties = 1;
+                    } else if (score == bestScore && rng() % ++ties == 0) {
+                        best = Action::capture(x, y);
+                    }
+                }
+            }
+            return best;
+        }
+    };
+}
@@ -0,0 +1,338 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "dataset.h"
+#include "nnue.h"
+
+// ============= ОБУЧЕНИЕ NNUE =============
+// Читает шарды самоигры (dataset.h), учит сеть nnue.h в float и пишет
+// квантованные веса. Цель позиции - итог партии с точки зрения игрока 1
+// (1, 0), смешанный с оценкой простого бота (Bot::evaluate без поиска,
+// через сигмоиду); у недоигранных партий цель - только оценка бота.
+// Каждая десятая партия откладывается для проверки; в конце та же выборка
+// оценивается уже квантованной сетью, как ее увидит игра.
+//
+//   ./selfplay --games 1000 --size 16 --greedy --out data/selfplay
+//   ./nnuetrain --out nnue16.cwnn data/selfplay-*.cwds
+//   ./selfplay --games 100 --size 16 --greedy --nnue nnue16.cwnn
+
+namespace {
+    struct Options {
+        std::string out = "nnue.cwnn";
+        std::vector<std::string> shards;
+        int epochs = 6;
+        float rate = 0.02f;
+        float resultWeight = 0.5f;  // Доля итога партии в цели
+        float teacherScale = 24.0f; // Единиц оценки бота на единицу логита
+        uint32_t seed = 1;
+    };
+
+    struct Sample {
+        std::vector<uint32_t> features; // Входы клеток, с повторами
+        int scores[2];
+        float target;
+        bool validation;
+        Nnue::Layout layout;
+    };
+
+    // Сеть в float той же формы, что Nnue::Network
+    struct FloatNetwork {
+        std::vector<float> w1;
+        float b1[Nnue::HIDDEN1];
+        float w2[Nnue::HIDDEN2 * Nnue::HIDDEN1];
+        float b2[Nnue::HIDDEN2];
+        float w3[Nnue::HIDDEN2];
+        float b3;
+
+        // Пределы весов, при которых квантованная сеть не переполняется
+        static constexpr float W1_LIMIT = 1.0f;
+        static constexpr float W_LIMIT = 127.0f / Nnue::WEIGHT_SCALE;
+
+        void init(int features, uint32_t seed) {
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<float> small(-0.01f, 0.01f);
+            std::uniform_real_distribution<float> hidden(-1.0f / std::sqrt(float(Nnue::HIDDEN1)), 1.0f / std::sqrt(float(Nnue::HIDDEN1)));
+            std::uniform_real_distribution<float> output(-1.0f / std::sqrt(float(Nnue::HIDDEN2)), 1.0f / std::sqrt(float(Nnue::HIDDEN2)));
+            w1.resize(static_cast<size_t>(features) * Nnue::HIDDEN1);
+            for (float& w : w1) w = small(rng);
+            for (float& b : b1) b = 0.5f;
+            for (float& w : w2) w = hidden(rng);
+            for (float& b : b2) b = 0.5f;
+            for (float& w : w3) w = output(rng);
+            b3 = 0;
+        }
+    };
+
+    // Активации прямого прохода для обратного
+    struct Pass {
+        float h[Nnue::HIDDEN1];
+        float a1[Nnue::HIDDEN1];
+        float z2[Nnue::HIDDEN2];
+        float a2[Nnue::HIDDEN2];
+        float y;
+    };
+
+    float clip01(float v) { return std::min(std::max(v, 0.0f), 1.0f); }
+    float sigmoid(float v) { return 1.0f / (1.0f + std::exp(-v)); }
+
+    void forward(const FloatNetwork& net, const Sample& s, const uint32_t* scoreFeatures, Pass& p) {
+        std::copy(net.b1, net.b1 + Nnue::HIDDEN1, p.h);
+        auto add = [&](uint32_t f) {
+            const float* column = &net.w1[static_cast<size_t>(f) * Nnue::HIDDEN1];
+            for (int k = 0; k < Nnue::HIDDEN1; ++k) p.h[k] += column[k];
+        };
+        for (uint32_t f : s.features) add(f);
+        for (int i = 0; i < Nnue::SCORE_FEATURES; ++i) add(scoreFeatures[i]);
+        for (int k = 0; k < Nnue::HIDDEN1; ++k) p.a1[k] = clip01(p.h[k]);
+        for (int j = 0; j < Nnue::HIDDEN2; ++j) {
+            float z = net.b2[j];
+            for (int k = 0; k < Nnue::HIDDEN1; ++k) z += net.w2[j * Nnue::HIDDEN1 + k] * p.a1[k];
+            p.z2[j] = z;
+            p.a2[j] = clip01(z);
+        }
+        p.y = net.b3;
+        for (int j = 0; j < Nnue::HIDDEN2; ++j) p.y += net.w3[j] * p.a2[j];
+    }
+
+    // Шаг SGD по одной позиции, возвращает квадрат ошибки
+    float train(FloatNetwork& net, const Sample& s, float rate) {
+        uint32_t scoreFeatures[Nnue::SCORE_FEATURES];
+        s.layout.scoreFeatures(s.scores[0], s.scores[1], scoreFeatures);
+        Pass p;
+        forward(net, s, scoreFeatures, p);
+        float out = sigmoid(p.y);
+        float error = out - s.target;
+        float gy = error * out * (1 - out);
+
+        float dz2[Nnue::HIDDEN2];
+        for (int j = 0; j < Nnue::HIDDEN2; ++j) {
+            dz2[j] = (p.z2[j] > 0 && p.z2[j] < 1) ? gy * net.w3[j] : 0;
+            net.w3[j] = std::min(std::max(net.w3[j] - rate * gy * p.a2[j], -FloatNetwork::W_LIMIT), FloatNetwork::W_LIMIT);
+        }
+        net.b3 -= rate * gy;
+
+        float dh[Nnue::HIDDEN1] = {};
+        for (int j = 0; j < Nnue::HIDDEN2; ++j) {
+            if (dz2[j] == 0) continue;
+            float* row = &net.w2[j * Nnue::HIDDEN1];
+            for (int k = 0; k < Nnue::HIDDEN1; ++k) {
+                dh[k] += dz2[j] * row[k];
+                row[k] = std::min(std::max(row[k] - rate * dz2[j] * p.a1[k], -FloatNetwork::W_LIMIT), FloatNetwork::W_LIMIT);
+            }
+            net.b2[j] -= rate * dz2[j];
+        }
+        for (int k = 0; k < Nnue::HIDDEN1; ++k) {
+            if (p.h[k] <= 0 || p.h[k] >= 1) dh[k] = 0;
+            net.b1[k] = std::min(std::max(net.b1[k] - rate * dh[k], -FloatNetwork::W1_LIMIT), FloatNetwork::W1_LIMIT);
+        }
+        auto step = [&](uint32_t f) {
+            float* column = &net.w1[static_cast<size_t>(f) * Nnue::HIDDEN1];
+            for (int k = 0; k < Nnue::HIDDEN1; ++k) {
+                column[k] = std::min(std::max(column[k] - rate * dh[k], -FloatNetwork::W1_LIMIT), FloatNetwork::W1_LIMIT);
+            }
+        };
+        for (uint32_t f : s.features) step(f);
+        for (uint32_t f : scoreFeatures) step(f);
+        return error * error;
+    }
+
+    template <typename T>
+    T quantize(float v, float scale, float lo, float hi) {
+        return static_cast<T>(std::lround(std::min(std::max(v * scale, lo), hi)));
+    }
+
+    void quantize(const FloatNetwork& f, int size, Nnue::Network& q) {
+        const float activation = Nnue::ACTIVATION_SCALE;
+        const float weight = Nnue::WEIGHT_SCALE;
+        q.resize(size);
+        for (size_t i = 0; i < f.w1.size(); ++i) q.w1[i] = quantize<int16_t>(f.w1[i], activation, -32767, 32767);
+        for (int k = 0; k < Nnue::HIDDEN1; ++k) q.b1[k] = quantize<int16_t>(f.b1[k], activation, -32767, 32767);
+        for (int i = 0; i < Nnue::HIDDEN2 * Nnue::HIDDEN1; ++i) q.w2[i] = quantize<int8_t>(f.w2[i], weight, -127, 127);
+        for (int j = 0; j < Nnue::HIDDEN2; ++j) {
+            q.b2[j] = quantize<int32_t>(f.b2[j], activation * weight, -1e9f, 1e9f);
+            q.w3[j] = quantize<int8_t>(f.w3[j], weight, -127, 127);
+        }
+        q.b3 = quantize<int32_t>(f.b3, activation * weight, -1e9f, 1e9f);
+    }
+
+    // Короли позиции - по клеткам-королям и их владельцам; без них
+    // углы, как в Game::reset()
+    Nnue::Layout layoutOf(const Dataset::Position& p) {
+        Nnue::Layout layout;
+        layout.size = p.size;
+        layout.kingX[1] = layout.kingY[1] = p.size - 1;
+        for (uint32_t k : p.kings) {
+            int owner = p.owners[k];
+            if (owner == 1 || owner == 2) {
+                layout.kingX[owner - 1] = static_cast<int>(k) / p.size;
+                layout.kingY[owner - 1] = static_cast<int>(k) % p.size;
+            }
+        }
+        return layout;
+    }
+
+    // Bot::evaluate() для игрока 1 по разобранной позиции, с расстоянием
+    // до короля для обеих сторон
+    int teacherEval(const Dataset::Position& p, const Nnue::Layout& layout) {
+        int cells[2] = {0, 0};
+        int kingDistance[2] = {p.size * 2, p.size * 2};
+        for (int i = 0; i < p.size * p.size; ++i) {
+            int owner = p.owners[i];
+            if (owner != 1 && owner != 2) continue;
+            cells[owner - 1]++;
+            int enemy = 2 - owner;
+            int d = std::abs(i / p.size - layout.kingX[enemy]) + std::abs(i % p.size - layout.kingY[enemy]);
+            kingDistance[owner - 1] = std::min(kingDistance[owner - 1], d);
+        }
+        return (p.scores[0] - p.scores[1]) * 4 + (cells[0] - cells[1]) - (kingDistance[0] - kingDistance[1]) * 2;
+    }
+
+    bool loadSamples(const Options& options, int& size, std::vector<Sample>& samples) {
+        size = 0;
+        Dataset::Position p;
+        std::vector<Cell> cells;
+        for (const std::string& path : options.shards) {
+            Dataset::ShardReader reader;
+            if (!reader.open(path)) {
+                std::fprintf(stderr, "Не удалось открыть шард %s\n", path.c_str());
+                return false;
+            }
+            if (size == 0) size = reader.boardSize();
+            if (reader.boardSize() != size) {
+                std::fprintf(stderr, "Шард %s - поле %d, а не %d\n", path.c_str(), reader.boardSize(), size);
+                return false;
+            }
+            for (uint32_t k = 0; k < reader.positionCount(); ++k) {
+                if (!reader.read(k, p)) {
+                    std::fprintf(stderr, "Шард %s поврежден (позиция %u)\n", path.c_str(), k);
+                    return false;
+                }
+                Sample s;
+                s.layout = layoutOf(p);
+                cells.assign(p.owners.size(), Cell());
+                for (size_t i = 0; i < cells.size(); ++i) cells[i].ownerId = p.owners[i];
+                for (uint32_t i : p.fortified) cells[i].isFortified = true;
+                for (size_t j = 0; j < p.sabotage.size(); ++j) {
+                    cells[p.sabotage[j]].sabotageCell = true;
+                    cells[p.sabotage[j]].sabotageValue = p.sabotageValues[j];
+                }
+                uint32_t features[Nnue::MAX_CELL_FEATURES];
+                for (int i = 0; i < size * size; ++i) {
+                    int n = s.layout.cellFeatures(i / size, i % size, packCell(cells[i]), features);
+                    s.features.insert(s.features.end(), features, features + n);
+                }
+                s.scores[0] = p.scores[0];
+                s.scores[1] = p.scores[1];
+
+                float teacher = sigmoid(teacherEval(p, s.layout) / options.teacherScale);
+                if (p.result == 1 || p.result == 2) {
+                    float result = p.result == 1 ? 1.0f : 0.0f;
+                    s.target = options.resultWeight * result + (1 - options.resultWeight) * teacher;
+                } else {
+                    s.target = teacher;
+                }
+                s.validation = p.gameId % 10 == 0;
+                samples.push_back(std::move(s));
+            }
+        }
+        return size != 0;
+    }
+
+    // Средний квадрат ошибки float-сети и квантованной, и среднее
+    // расхождение их оценок в единицах OUTPUT_SCALE
+    void validate(const FloatNetwork& f, const Nnue::Network& q, const std::vector<Sample>& samples) {
+        Nnue::Evaluator evaluator(q);
+        double floatLoss = 0, quantLoss = 0, drift = 0;
+        size_t n = 0;
+        for (const Sample& s : samples) {
+            if (!s.validation) continue;
+            uint32_t scoreFeatures[Nnue::SCORE_FEATURES];
+            s.layout.scoreFeatures(s.scores[0], s.scores[1], scoreFeatures);
+            Pass p;
+            forward(f, s, scoreFeatures, p);
+            Nnue::Accumulator acc;
+            acc.layout = s.layout;
+            std::copy(q.b1, q.b1 + Nnue::HIDDEN1, acc.values);
+            for (uint32_t feature : s.features) Nnue::Simd::addRow(acc.values, q.column(feature), Nnue::HIDDEN1);
+            int value = evaluator.evaluate(acc, s.scores[0], s.scores[1]);
+
+            double fe = sigmoid(p.y) - s.target;
+            double qe = sigmoid(static_cast<float>(value) / Nnue::OUTPUT_SCALE) - s.target;
+            floatLoss += fe * fe;
+            quantLoss += qe * qe;
+            drift += std::abs(p.y * Nnue::OUTPUT_SCALE - value);
+            ++n;
+        }
+        if (n == 0) return;
+        std::printf("Проверка: %zu позиций, ошибка float %.5f, квантованной %.5f, расхождение оценок %.2f\n",
+                    n, floatLoss / n, quantLoss / n, drift / n);
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 < argc && arg == "--out") {
+            options.out = argv[++i];
+        } else if (i + 1 < argc && arg == "--epochs") {
+            options.epochs = std::max(1, std::atoi(argv[++i]));
+        } else if (i + 1 < argc && arg == "--rate") {
+            options.rate = static_cast<float>(std::atof(argv[++i]));
+        } else if (i + 1 < argc && arg == "--result-weight") {
+            options.resultWeight = std::min(std::max(static_cast<float>(std::atof(argv[++i])), 0.0f), 1.0f);
+        } else if (i + 1 < argc && arg == "--seed") {
+            options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (!arg.empty() && arg[0] != '-') {
+            options.shards.push_back(arg);
+        } else {
+            options.shards.clear();
+            break;
+        }
+    }
+    if (options.shards.empty()) {
+        std::fprintf(stderr, "Использование: %s [--out ВЕСА] [--epochs N] [--rate X] [--result-weight X] [--seed N] "
+                             "ШАРД...\n", argv[0]);
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int size = 0;
+    std::vector<Sample> samples;
+    if (!loadSamples(options, size, samples)) return 1;
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < samples.size(); ++i) {
+        if (!samples[i].validation) order.push_back(i);
+    }
+    std::printf("Поле %dx%d: позиций %zu, для обучения %zu\n", size, size, samples.size(), order.size());
+
+    Nnue::Layout layout;
+    layout.size = size;
+    FloatNetwork net;
+    net.init(layout.features(), options.seed);
+    std::mt19937 rng(options.seed);
+    for (int epoch = 0; epoch < options.epochs; ++epoch) {
+        std::shuffle(order.begin(), order.end(), rng);
+        float rate = options.rate / (1 + epoch);
+        double loss = 0;
+        for (uint32_t i : order) loss += train(net, samples[i], rate);
+        std::printf("Эпоха %d: ошибка %.5f\n", epoch + 1, order.empty() ? 0.0 : loss / order.size());
+    }
+
+    Nnue::Network quantized;
+    quantize(net, size, quantized);
+    validate(net, quantized, samples);
+    if (!quantized.save(options.out)) {
+        std::fprintf(stderr, "Не удалось записать %s\n", options.out.c_str());
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("Веса: %s, %.1f с\n", options.out.c_str(), seconds);
+    return 0;
+}
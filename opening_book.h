@@ -0,0 +1,322 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "bot.h"
+#include "game.h"
+
+// ============= КНИГА ДЕБЮТОВ =============
+// Первые ходы партии бот не ищет, а берет из книги: для позиций, которые
+// встречались в самоигре, лучший захват посчитан заранее глубже, чем бот
+// ищет сам (на два полухода: свой захват и лучший для соперника ответ).
+//
+// Стартовая позиция симметрична: короли в (0,0) и (size-1,size-1).
+// Отражение по главной диагонали их не двигает, отражение по побочной и
+// поворот на 180 градусов меняют местами. Поэтому позиция хешируется с
+// точки зрения того, кто ходит: его клетки - "свои", король - в (0,0) (для
+// игрока 2 поле поворачивается), и из двух вариантов - как есть и
+// отраженный по диагонали - берется меньший хеш. Зеркальные позиции, в том
+// числе те же позиции за другого игрока, попадают в одну запись.
+//
+// Хеш - Zobrist по клеткам (владелец, укрепление, очки диверсии) плюс
+// размер поля, очки и флаги игроков. Ход в записи хранится в каноническом
+// поле и при выдаче переводится обратно.
+//
+// Файл: [Header 32 байта][Entry по 24 байта, по возрастанию key]. Файл
+// отображается в память, запись ищется интерполяцией по ключу (ключи
+// равномерны), последние шаги - двоичным поиском. Порядок байт - как у
+// машины, писавшей книгу.
+namespace OpeningBook {
+    const uint32_t MAGIC = 0x424F5743; // "CWOB"
+    const uint32_t VERSION = 1;
+    const int DEFAULT_PLIES = 8;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t boardSize;
+        uint32_t plies;       // Сколько первых полуходов партий в книге
+        uint64_t count;
+        uint64_t reserved;
+    };
+    static_assert(sizeof(Header) == 32, "Header пишется как есть");
+
+    // Только захват или пропуск: у способностей несимметричные области,
+    // их в книге нет
+    struct Entry {
+        uint64_t key;
+        uint16_t x, y;        // Захват в каноническом поле
+        uint8_t kind;         // Action::CAPTURE или Action::PASS
+        uint8_t reserved[3];
+        uint32_t count;       // Сколько раз позиция встречалась
+        int32_t score;        // Оценка анализа для того, кто ходит
+    };
+    static_assert(sizeof(Entry) == 24, "Entry пишется как есть");
+
+    // ============= КАНОНИЧЕСКИЙ КЛЮЧ =============
+    inline uint64_t mix(uint64_t v) {
+        v += 0x9E3779B97F4A7C15ull;
+        v = (v ^ (v >> 30)) * 0xBF58476D1CE4E5B9ull;
+        v = (v ^ (v >> 27)) * 0x94D049BB133111EBull;
+        return v ^ (v >> 31);
+    }
+
+    // Ключ Zobrist для (место, значение) - вычисляется, а не хранится
+    inline uint64_t zobrist(uint64_t slot, uint64_t value) {
+        return mix((slot << 16) ^ value);
+    }
+
+    // Преобразование координат поля в каноническое и обратно (оно само
+    // себе обратное): поворот на 180 градусов, затем отражение по диагонали
+    struct Frame {
+        int size;
+        bool rotate;
+        bool transpose;
+
+        void map(int x, int y, int& cx, int& cy) const {
+            if (rotate) {
+                x = size - 1 - x;
+                y = size - 1 - y;
+            }
+            cx = transpose ? y : x;
+            cy = transpose ? x : y;
+        }
+    };
+
+    inline uint64_t hashInFrame(const Game& game, const Frame& frame) {
+        int size = game.getSize();
+        int mover = game.getCurrentPlayer() + 1;
+        uint64_t h = zobrist(1u << 20, static_cast<uint64_t>(size));
+        for (int x = 0; x < size; ++x) {
+            for (int y = 0; y < size; ++y) {
+                const Cell& cell = game.getCell(x, y);
+                int owner = cell.ownerId == 0 ? 0 : (cell.ownerId == mover ? 1 : 2);
+                uint64_t value = static_cast<uint64_t>(owner) | (cell.isFortified ? 4u : 0u) |
+                                 (cell.sabotageCell ? static_cast<uint64_t>(cell.sabotageValue) << 3 : 0u);
+                if (value == 0) continue;
+                int cx, cy;
+                frame.map(x, y, cx, cy);
+                h ^= zobrist(static_cast<uint64_t>(cx * size + cy), value);
+            }
+        }
+        for (int side = 0; side < 2; ++side) {
+            const Player& player = game.getPlayer(side == 0 ? mover - 1 : 2 - mover);
+            uint64_t flags = (player.commanderActive ? 1u : 0u) | (player.abilityUsedThisTurn ? 2u : 0u);
+            h ^= zobrist((1u << 21) + side, static_cast<uint64_t>(std::max(player.score, 0)) << 2 | flags);
+        }
+        return h;
+    }
+
+    struct Key {
+        uint64_t hash;
+        Frame frame;
+    };
+
+    inline Key canonicalKey(const Game& game) {
+        Frame frame{game.getSize(), game.getCurrentPlayer() == 1, false};
+        Key best{hashInFrame(game, frame), frame};
+        frame.transpose = true;
+        uint64_t mirrored = hashInFrame(game, frame);
+        if (mirrored < best.hash) best = {mirrored, frame};
+        return best;
+    }
+
+    // ============= АНАЛИЗ =============
+    // Лучший захват того, кто ходит, на два полухода: после каждого
+    // захвата соперник отвечает захватом, худшим для нас по Bot::evaluate.
+    // Дорого (квадрат числа захватов копий партии), поэтому - только при
+    // сборке книги.
+    inline Action analyze(const Game& game, int& score) {
+        int size = game.getSize();
+        int playerId = game.getCurrentPlayer() + 1;
+        Action best = Action::pass();
+        score = Bot::evaluate(game, playerId);
+        bool found = false;
+
+        for (int x = 0; x < size; ++x) {
+            for (int y = 0; y < size; ++y) {
+                if (!game.isCellAvailable(x, y)) continue;
+                Game trial = game.fork();
+                trial.setJournalEnabled(false);
+                if (!trial.playCapture(x, y)) continue;
+
+                int worst = INT_MAX;
+                if (trial.isGameOver()) {
+                    worst = Bot::evaluate(trial, playerId);
+                } else {
+                    for (int rx = 0; rx < size; ++rx) {
+                        for (int ry = 0; ry < size; ++ry) {
+                            if (!trial.isCellAvailable(rx, ry)) continue;
+                            Game reply = trial;
+                            if (!reply.playCapture(rx, ry)) continue;
+                            worst = std::min(worst, Bot::evaluate(reply, playerId));
+                        }
+                    }
+                    if (worst == INT_MAX) worst = Bot::evaluate(trial, playerId);
+                }
+                if (!found || worst > score) {
+                    found = true;
+                    score = worst;
+                    best = Action::capture(x, y);
+                }
+            }
+        }
+        return best;
+    }
+
+    // Запись книги для позиции: анализ в каноническом поле; played -
+    // найденный ход в поле партии
+    inline Entry makeEntry(const Game& game, Action* played = nullptr) {
+        Key key = canonicalKey(game);
+        Entry entry = {};
+        entry.key = key.hash;
+        entry.count = 1;
+        int score = 0;
+        Action move = analyze(game, score);
+        if (played) *played = move;
+        entry.kind = move.kind;
+        entry.score = score;
+        if (move.kind == Action::CAPTURE) {
+            int cx, cy;
+            key.frame.map(move.x, move.y, cx, cy);
+            entry.x = static_cast<uint16_t>(cx);
+            entry.y = static_cast<uint16_t>(cy);
+        }
+        return entry;
+    }
+
+    // ============= ЗАПИСЬ =============
+    // Записи копятся в памяти; повторы одной позиции сливаются (анализ у
+    // них одинаковый, счетчики складываются), таблица сортируется по ключу
+    inline bool write(const std::string& path, int boardSize, int plies, std::vector<Entry>& entries) {
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.key < b.key; });
+        size_t unique = 0;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (unique > 0 && entries[unique - 1].key == entries[i].key) {
+                entries[unique - 1].count += entries[i].count;
+            } else {
+                entries[unique++] = entries[i];
+            }
+        }
+        entries.resize(unique);
+
+        FILE* f = std::fopen(path.c_str(), "wb");
+        if (!f) return false;
+        Header header = {MAGIC, VERSION, static_cast<uint32_t>(boardSize), static_cast<uint32_t>(plies),
+                         static_cast<uint64_t>(entries.size()), 0};
+        bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1 &&
+                  (entries.empty() || std::fwrite(entries.data(), sizeof(Entry), entries.size(), f) == entries.size());
+        return std::fclose(f) == 0 && ok;
+    }
+
+    // ============= ЧТЕНИЕ =============
+    // Книга, отображенная в память; probe() можно звать из любых потоков
+    class Book {
+    private:
+        const uint8_t* base;
+        size_t length;
+        const Entry* entries;
+        uint64_t count;
+        int boardSize;
+
+    public:
+        Book() : base(nullptr), length(0), entries(nullptr), count(0), boardSize(0) {}
+        ~Book() { close(); }
+        Book(const Book&) = delete;
+        Book& operator=(const Book&) = delete;
+
+        bool open(const std::string& path) {
+            close();
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return false;
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+                ::close(fd);
+                return false;
+            }
+            void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (p == MAP_FAILED) return false;
+            base = static_cast<const uint8_t*>(p);
+            length = static_cast<size_t>(st.st_size);
+
+            const Header* header = reinterpret_cast<const Header*>(base);
+            if (header->magic != MAGIC || header->version != VERSION ||
+                sizeof(Header) + header->count * sizeof(Entry) > length) {
+                close();
+                return false;
+            }
+            entries = reinterpret_cast<const Entry*>(base + sizeof(Header));
+            count = header->count;
+            boardSize = static_cast<int>(header->boardSize);
+            return true;
+        }
+
+        void close() {
+            if (!base) return;
+            munmap(const_cast<uint8_t*>(base), length);
+            base = nullptr;
+            length = 0;
+            entries = nullptr;
+            count = 0;
+        }
+
+        uint64_t size() const { return count; }
+        int getBoardSize() const { return boardSize; }
+
+        // Интерполяция по ключу, пока отрезок большой, затем двоичный поиск
+        const Entry* find(uint64_t key) const {
+            uint64_t lo = 0, hi = count;
+            while (hi - lo > 16) {
+                uint64_t first = entries[lo].key, last = entries[hi - 1].key;
+                if (key < first || key > last) return nullptr;
+                uint64_t span = hi - 1 - lo;
+                uint64_t guess = lo + (last == first ? 0 : static_cast<uint64_t>(
+                    static_cast<unsigned __int128>(key - first) * span / (last - first)));
+                if (entries[guess].key == key) return &entries[guess];
+                if (entries[guess].key < key) lo = guess + 1;
+                else hi = guess;
+            }
+            const Entry* begin = entries + lo;
+            const Entry* end = entries + hi;
+            const Entry* it = std::lower_bound(begin, end, key, [](const Entry& e, uint64_t k) { return e.key < k; });
+            return (it != end && it->key == key) ? it : nullptr;
+        }
+
+        // Ход из книги для того, кто ходит; false - позиции нет в книге
+        // или ход стал невозможен
+        bool probe(const Game& game, Action& move) const {
+            if (count == 0 || game.getSize() != boardSize || game.isGameOver()) return false;
+            Key key = canonicalKey(game);
+            const Entry* entry = find(key.hash);
+            if (!entry) return false;
+            if (entry->kind != Action::CAPTURE) {
+                move = Action::pass();
+                return true;
+            }
+            int x, y;
+            key.frame.map(entry->x, entry->y, x, y);
+            if (x >= boardSize || y >= boardSize || !game.isCellAvailable(x, y)) return false;
+            move = Action::capture(x, y);
+            return true;
+        }
+    };
+
+    // Ход бота: из книги, если позиция там есть, иначе Bot::chooseMove()
+    inline Action chooseMove(const Book* book, const Game& game, uint32_t seed, bool* fromBook = nullptr) {
+        Action move;
+        bool hit = book && book->probe(game, move);
+        if (fromBook) *fromBook = hit;
+        return hit ? move : Bot::chooseMove(game, seed);
+    }
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+// ============= ПРОФИЛИРОВАНИЕ =============
+// Таймеры областей и счетчики для горячих мест правил. Включаются флагом
+// сборки -DCELL_WARFARE_PROFILE; без него макросы раскрываются в пустоту и
+// в сборке от них ничего не остается.
+//
+//   PROFILE_SCOPE("updateVisibility");      // время до конца блока
+//   PROFILE_COUNTER("territory.p1", value); // значение счетчика
+//
+// Каждый поток пишет в свой буфер фиксированного размера без блокировок;
+// переполненный буфер отбрасывает события и считает их. При выходе из
+// программы все буферы выгружаются в JSON формата Chrome trace_event
+// (chrome://tracing, Perfetto) в файл из CELL_WARFARE_TRACE, по умолчанию
+// cell_warfare_trace.json.
+//
+//   g++ -std=c++17 -O2 -pthread -DCELL_WARFARE_PROFILE -o game game.cpp
+
+#ifdef CELL_WARFARE_PROFILE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Profiler {
+    const size_t EVENTS_PER_THREAD = 1 << 18;
+
+    struct Event {
+        const char* name;     // Строковый литерал: хранится только указатель
+        uint64_t start;       // нс от запуска программы
+        uint64_t duration;    // Для таймера
+        int64_t value;        // Для счетчика
+        bool counter;
+    };
+
+    inline uint64_t now() {
+        static const auto origin = std::chrono::steady_clock::now();
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - origin).count());
+    }
+
+    // Буфер одного потока: пишет только владелец, count публикуется с
+    // release, и выгрузка видит только записанные до конца события
+    struct ThreadBuffer {
+        int threadId;
+        std::unique_ptr<Event[]> events;
+        std::atomic<size_t> count{0};
+        std::atomic<uint64_t> dropped{0};
+
+        explicit ThreadBuffer(int id) : threadId(id), events(new Event[EVENTS_PER_THREAD]) {}
+
+        void push(const Event& event) {
+            size_t n = count.load(std::memory_order_relaxed);
+            if (n >= EVENTS_PER_THREAD) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            events[n] = event;
+            count.store(n + 1, std::memory_order_release);
+        }
+    };
+
+    // Все буферы процесса. Мьютекс берется только при первом событии
+    // потока; буферы живут до выхода, даже если поток завершился раньше.
+    class Registry {
+    private:
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+        static void writeEscaped(FILE* f, const char* s) {
+            for (; *s; ++s) {
+                if (*s == '"' || *s == '\\') std::fputc('\\', f);
+                std::fputc(*s, f);
+            }
+        }
+
+    public:
+        static Registry& instance() {
+            static Registry registry;
+            return registry;
+        }
+
+        ~Registry() {
+            const char* path = std::getenv("CELL_WARFARE_TRACE");
+            writeTrace(path ? path : "cell_warfare_trace.json");
+        }
+
+        ThreadBuffer* registerThread() {
+            std::lock_guard<std::mutex> lock(mutex);
+            buffers.emplace_back(new ThreadBuffer(static_cast<int>(buffers.size()) + 1));
+            return buffers.back().get();
+        }
+
+        bool writeTrace(const char* path) {
+            std::lock_guard<std::mutex> lock(mutex);
+            FILE* f = std::fopen(path, "w");
+            if (!f) return false;
+            std::fprintf(f, "{\"traceEvents\":[\n");
+            bool first = true;
+            uint64_t dropped = 0;
+            for (const auto& buffer : buffers) {
+                size_t n = buffer->count.load(std::memory_order_acquire);
+                dropped += buffer->dropped.load(std::memory_order_relaxed);
+                for (size_t i = 0; i < n; ++i) {
+                    const Event& e = buffer->events[i];
+                    std::fprintf(f, "%s{\"name\":\"", first ? "" : ",\n");
+                    writeEscaped(f, e.name);
+                    if (e.counter) {
+                        std::fprintf(f, "\",\"ph\":\"C\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"args\":{\"value\":%lld}}",
+                                     buffer->threadId, e.start / 1000.0, static_cast<long long>(e.value));
+                    } else {
+                        std::fprintf(f, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                                     buffer->threadId, e.start / 1000.0, e.duration / 1000.0);
+                    }
+                    first = false;
+                }
+            }
+            std::fprintf(f, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":%llu}}\n",
+                         static_cast<unsigned long long>(dropped));
+            return std::fclose(f) == 0;
+        }
+    };
+
+    inline ThreadBuffer& threadBuffer() {
+        thread_local ThreadBuffer* buffer = Registry::instance().registerThread();
+        return *buffer;
+    }
+
+    class Scope {
+    private:
+        const char* name;
+        uint64_t start;
+
+    public:
+        explicit Scope(const char* scopeName) : name(scopeName), start(now()) {}
+        ~Scope() {
+            uint64_t end = now();
+            threadBuffer().push({name, start, end - start, 0, false});
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    inline void counter(const char* name, int64_t value) {
+        threadBuffer().push({name, now(), 0, value, true});
+    }
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ::Profiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_COUNTER(name, value) ::Profiler::counter(name, static_cast<int64_t>(value))
+
+#else
+
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_COUNTER(name, value) ((void)0)
+
+#endif
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "game.h"
+
+// ============= ПРОТОКОЛ СЕРВЕРА МАТЧЕЙ =============
+// Двоичные кадры поверх TCP или Unix-сокета, все числа little-endian:
+//   [длина u16][тип u8][тело]
+// Длина считает тип и тело, но не саму себя. Поле до 64x64 целиком
+// помещается в один кадр.
+namespace Protocol {
+    const int HEADER_SIZE = 2;
+    const int MAX_FRAME = 0xFFFF;
+
+    enum MessageType : uint8_t {
+        // Клиент -> сервер
+        MSG_CREATE = 1,   // u8 size, u32 seed[, u8 bots] -> MSG_CREATED; создатель садится за все места не-ботов
+        MSG_JOIN = 2,     // u32 game, u8 player -> MSG_STATE; пересесть на место игрока
+        MSG_ACTION = 3,   // u32 game, u8 player, u8 kind, u8 ability, u16 x, u16 y, u8 direction -> MSG_STATE
+        MSG_VIEW = 4,     // u32 game, u8 player -> MSG_STATE
+        MSG_LEAVE = 5,    // u32 game -> MSG_CLOSED
+        MSG_STATS = 6,    // -> MSG_STATS_REPLY
+        MSG_SPECTATE = 7, // u32 game -> MSG_SPECTATOR_FRAME с ключевым кадром, дальше по кадру на ход
+        MSG_UNSPECTATE = 8, // u32 game -> MSG_CLOSED
+
+        // Сервер -> клиент
+        MSG_CREATED = 64, // u32 game
+        MSG_STATE = 65,   // см. writeState()
+        MSG_CLOSED = 66,  // u32 game
+        MSG_STATS_REPLY = 67, // u32 sessions, u32 connections, u64 actions, u64 cpuMicros, u64 wallMicros
+        MSG_ERROR = 68,   // u8 status
+        MSG_SPECTATOR_FRAME = 69 // u32 game, кадр трансляции (см. spectator.h)
+    };
+
+    enum ActionKind : uint8_t {
+        ACTION_CAPTURE = 0,
+        ACTION_ABILITY = 1,
+        ACTION_PASS = 2
+    };
+
+    // Маска bots в MSG_CREATE: за кого играет бот сервера
+    const uint8_t BOT_PLAYER1 = 1 << 0;
+    const uint8_t BOT_PLAYER2 = 1 << 1;
+
+    enum Status : uint8_t {
+        STATUS_OK = 0,
+        STATUS_ILLEGAL = 1,       // Правила не дали сделать ход
+        STATUS_NOT_YOUR_TURN = 2,
+        STATUS_NO_SUCH_GAME = 3,
+        STATUS_NOT_SEATED = 4,    // Соединение не занимает это место
+        STATUS_BAD_REQUEST = 5,
+        STATUS_GAME_OVER = 6
+    };
+
+    // Клетка в представлении игрока - один байт:
+    // младшие 4 бита - владелец (VIEW_FOG - клетка скрыта туманом),
+    // затем флаги короля, укрепления, диверсии и доступности захвата
+    // (доступность считается только для игрока, чей сейчас ход).
+    const uint8_t VIEW_OWNER_MASK = 0x0F;
+    const uint8_t VIEW_FOG = 0x0F;
+    const uint8_t VIEW_KING = 1 << 4;
+    const uint8_t VIEW_FORTIFIED = 1 << 5;
+    const uint8_t VIEW_SABOTAGE = 1 << 6;
+    const uint8_t VIEW_AVAILABLE = 1 << 7;
+
+    // ============= ЗАПИСЬ И ЧТЕНИЕ =============
+    class Writer {
+    private:
+        std::vector<uint8_t>& buffer;
+        size_t frameStart;
+
+    public:
+        explicit Writer(std::vector<uint8_t>& out) : buffer(out), frameStart(0) {}
+
+        void begin(MessageType type) {
+            frameStart = buffer.size();
+            u16(0);
+            u8(type);
+        }
+
+        // Дописывает длину в начало кадра
+        void end() {
+            size_t length = buffer.size() - frameStart - HEADER_SIZE;
+            buffer[frameStart] = static_cast<uint8_t>(length & 0xFF);
+            buffer[frameStart + 1] = static_cast<uint8_t>(length >> 8);
+        }
+
+        void u8(uint8_t v) { buffer.push_back(v); }
+        void u16(uint16_t v) { u8(static_cast<uint8_t>(v)); u8(static_cast<uint8_t>(v >> 8)); }
+        void u32(uint32_t v) { u16(static_cast<uint16_t>(v)); u16(static_cast<uint16_t>(v >> 16)); }
+        void u64(uint64_t v) { u32(static_cast<uint32_t>(v)); u32(static_cast<uint32_t>(v >> 32)); }
+        void bytes(const uint8_t* data, size_t n) { buffer.insert(buffer.end(), data, data + n); }
+
+        // Место под n байт, которые вызывающий заполнит сам
+        uint8_t* reserve(size_t n) {
+            buffer.resize(buffer.size() + n);
+            return buffer.data() + buffer.size() - n;
+        }
+    };
+
+    // Чтение тела одного кадра; при выходе за границы ok() становится false
+    // и все дальнейшие чтения возвращают 0
+    class Reader {
+    private:
+        const uint8_t* data;
+        size_t length;
+        size_t pos;
+        bool valid;
+
+    public:
+        Reader(const uint8_t* body, size_t n) : data(body), length(n), pos(0), valid(true) {}
+
+        bool ok() const { return valid; }
+        size_t remaining() const { return valid ? length - pos : 0; }
+
+        uint8_t u8() {
+            if (pos + 1 > length) { valid = false; return 0; }
+            return data[pos++];
+        }
+        uint16_t u16() { uint16_t lo = u8(); return static_cast<uint16_t>(lo | (u8() << 8)); }
+        uint32_t u32() { uint32_t lo = u16(); return lo | (static_cast<uint32_t>(u16()) << 16); }
+        uint64_t u64() { uint64_t lo = u32(); return lo | (static_cast<uint64_t>(u32()) << 32); }
+
+        const uint8_t* bytes(size_t n) {
+            if (pos + n > length) { valid = false; return nullptr; }
+            const uint8_t* p = data + pos;
+            pos += n;
+            return p;
+        }
+    };
+
+    // Длина готового кадра в начале буфера или 0, если кадр еще не дочитан
+    inline size_t completeFrame(const uint8_t* data, size_t n) {
+        if (n < static_cast<size_t>(HEADER_SIZE)) return 0;
+        size_t length = data[0] | (data[1] << 8);
+        return (n >= HEADER_SIZE + length) ? HEADER_SIZE + length : 0;
+    }
+
+    // ============= ПРЕДСТАВЛЕНИЕ ИГРОКА =============
+    // Поле глазами игрока playerId: то, что скрыто туманом, не уходит в сеть.
+    // visible - рабочий буфер вызывающего.
+    inline void encodeView(const Game& game, int playerId, uint8_t* cells,
+                           std::vector<uint8_t>& visible) {
+        int size = game.getSize();
+        game.computeVisibility(playerId, visible);
+        bool toMove = game.getCurrentPlayer() + 1 == playerId;
+
+        for (int x = 0; x < size; ++x) {
+            for (int y = 0; y < size; ++y) {
+                int i = x * size + y;
+                if (!visible[i]) {
+                    cells[i] = VIEW_FOG;
+                    continue;
+                }
+                const Cell& cell = game.getCell(x, y);
+                uint8_t v = cell.ownerId & VIEW_OWNER_MASK;
+                if (cell.kingCell) v |= VIEW_KING;
+                if (cell.isFortified) v |= VIEW_FORTIFIED;
+                if (cell.sabotageCell) v |= VIEW_SABOTAGE;
+                if (toMove && game.isCellAvailable(x, y)) v |= VIEW_AVAILABLE;
+                cells[i] = v;
+            }
+        }
+    }
+
+    // MSG_STATE: u32 game, u8 viewer, u8 status, u8 toMove, u8 gameOver,
+    // u8 winner, u8 abilityUsed, i32 score1, i32 score2, u16 size,
+    // size*size байт клеток (индекс x * size + y)
+    inline void writeState(Writer& w, uint32_t gameId, int playerId, Status status, const Game& game,
+                           std::vector<uint8_t>& visible) {
+        int size = game.getSize();
+        const Player& mover = game.getPlayer(game.getCurrentPlayer());
+
+        w.begin(MSG_STATE);
+        w.u32(gameId);
+        w.u8(static_cast<uint8_t>(playerId));
+        w.u8(status);
+        w.u8(static_cast<uint8_t>(game.getCurrentPlayer() + 1));
+        w.u8(game.isGameOver() ? 1 : 0);
+        w.u8(static_cast<uint8_t>(game.getWinner()));
+        w.u8(mover.abilityUsedThisTurn ? 1 : 0);
+        w.u32(static_cast<uint32_t>(game.getPlayer(0).score));
+        w.u32(static_cast<uint32_t>(game.getPlayer(1).score));
+        w.u16(static_cast<uint16_t>(size));
+
+        encodeView(game, playerId, w.reserve(size * size), visible);
+        w.end();
+    }
+
+    // Разобранный MSG_STATE на стороне клиента
+    struct StateView {
+        uint32_t gameId = 0;
+        uint8_t viewer = 0;
+        uint8_t status = 0;
+        uint8_t toMove = 0;
+        bool gameOver = false;
+        uint8_t winner = 0;
+        bool abilityUsed = false;
+        int32_t scores[2] = {0, 0};
+        uint16_t size = 0;
+        const uint8_t* cells = nullptr;
+    };
+
+    inline bool readState(Reader& r, StateView& s) {
+        s.gameId = r.u32();
+        s.viewer = r.u8();
+        s.status = r.u8();
+        s.toMove = r.u8();
+        s.gameOver = r.u8() != 0;
+        s.winner = r.u8();
+        s.abilityUsed = r.u8() != 0;
+        s.scores[0] = static_cast<int32_t>(r.u32());
+        s.scores[1] = static_cast<int32_t>(r.u32());
+        s.size = r.u16();
+        s.cells = r.bytes(static_cast<size_t>(s.size) * s.size);
+        return r.ok();
+    }
+}
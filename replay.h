@@ -0,0 +1,200 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "game.h"
+
+// ============= АРХИВ ПАРТИЙ =============
+// Партия без терминала полностью задается размером поля, зерном и списком
+// ходов, поэтому архив хранит только их, а всё остальное получается
+// повторной игрой по тем же правилам.
+//
+// Файл: [magic u32][version u32][8 байт резерв], затем записи подряд:
+//   [длина u32 - байт после этого поля][size u8][winner u8][резерв u16]
+//   [seed u32][число ходов u32][ходы по ACTION_BYTES]
+// Ход: kind u8, ability u8, x u16, y u16, direction u8, резерв u8.
+// Числа little-endian. Записи только дописываются в конец.
+namespace Replay {
+    const uint32_t MAGIC = 0x50525743; // "CWRP"
+    const uint32_t VERSION = 1;
+    const int FILE_HEADER_SIZE = 16;
+    const int RECORD_HEADER_SIZE = 16;  // Вместе с полем длины
+    const int ACTION_BYTES = 8;
+
+    inline void putLe(std::vector<uint8_t>& out, uint64_t v, int bytes) {
+        for (int i = 0; i < bytes; ++i) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    inline uint64_t getLe(const uint8_t* p, int bytes) {
+        uint64_t v = 0;
+        for (int i = 0; i < bytes; ++i) v |= static_cast<uint64_t>(p[i]) << (8 * i);
+        return v;
+    }
+
+    // Записанная партия: вызывающий копит ходы, которые правила приняли
+    struct Record {
+        int size = 0;
+        uint32_t seed = 0;
+        int winner = 0;
+        std::vector<Action> actions;
+    };
+
+    // ============= ЗАПИСЬ =============
+    class Writer {
+    private:
+        std::ofstream file;
+        std::vector<uint8_t> buffer;
+
+    public:
+        // Существующий архив дописывается
+        bool open(const std::string& path) {
+            file.open(path, std::ios::binary | std::ios::app);
+            if (!file) return false;
+            file.seekp(0, std::ios::end);
+            if (file.tellp() == 0) {
+                buffer.clear();
+                putLe(buffer, MAGIC, 4);
+                putLe(buffer, VERSION, 4);
+                putLe(buffer, 0, 8);
+                file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+            }
+            return static_cast<bool>(file);
+        }
+
+        void write(const Record& record) {
+            buffer.clear();
+            putLe(buffer, RECORD_HEADER_SIZE - 4 + record.actions.size() * ACTION_BYTES, 4);
+            buffer.push_back(static_cast<uint8_t>(record.size));
+            buffer.push_back(static_cast<uint8_t>(record.winner));
+            putLe(buffer, 0, 2);
+            putLe(buffer, record.seed, 4);
+            putLe(buffer, record.actions.size(), 4);
+            for (const Action& a : record.actions) {
+                buffer.push_back(a.kind);
+                buffer.push_back(a.ability);
+                putLe(buffer, a.x, 2);
+                putLe(buffer, a.y, 2);
+                buffer.push_back(static_cast<uint8_t>(a.direction));
+                buffer.push_back(0);
+            }
+            file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        }
+
+        void close() {
+            if (file.is_open()) file.close();
+        }
+    };
+
+    // ============= ЧТЕНИЕ =============
+    // Запись внутри отображенного файла; данные не копируются
+    struct View {
+        int size;
+        int winner;
+        uint32_t seed;
+        uint32_t actionCount;
+        const uint8_t* actions;
+
+        Action action(uint32_t i) const {
+            const uint8_t* p = actions + static_cast<size_t>(i) * ACTION_BYTES;
+            Action a;
+            a.kind = p[0];
+            a.ability = p[1];
+            a.x = static_cast<uint16_t>(getLe(p + 2, 2));
+            a.y = static_cast<uint16_t>(getLe(p + 4, 2));
+            a.direction = static_cast<char>(p[6]);
+            return a;
+        }
+    };
+
+    // Архив, отображенный в память целиком. Открытие один раз проходит по
+    // заголовкам записей и запоминает их смещения, дальше записи читаются
+    // из любых потоков.
+    class Archive {
+    private:
+        const uint8_t* base;
+        size_t length;
+        std::vector<size_t> offsets;
+        size_t skipped;
+
+    public:
+        Archive() : base(nullptr), length(0), skipped(0) {}
+        ~Archive() { close(); }
+        Archive(const Archive&) = delete;
+        Archive& operator=(const Archive&) = delete;
+
+        // false - файла нет или заголовок не тот; обрезанный хвост
+        // (недописанная запись) просто не попадает в архив. Запись с
+        // неизвестным размером поля или победителем пропускается
+        // (skippedCount()): переигрывать ее нельзя, а границы следующих
+        // записей она не сбивает.
+        bool open(const std::string& path) {
+            close();
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return false;
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size < FILE_HEADER_SIZE) {
+                ::close(fd);
+                return false;
+            }
+            void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (p == MAP_FAILED) return false;
+            base = static_cast<const uint8_t*>(p);
+            length = static_cast<size_t>(st.st_size);
+            madvise(const_cast<uint8_t*>(base), length, MADV_WILLNEED);
+
+            if (getLe(base, 4) != MAGIC || getLe(base + 4, 4) != VERSION) {
+                close();
+                return false;
+            }
+            size_t pos = FILE_HEADER_SIZE;
+            while (pos + RECORD_HEADER_SIZE <= length) {
+                size_t recordLength = getLe(base + pos, 4);
+                uint64_t actions = getLe(base + pos + 12, 4);
+                if (actions > (length - pos - RECORD_HEADER_SIZE) / ACTION_BYTES ||
+                    recordLength != RECORD_HEADER_SIZE - 4 + actions * ACTION_BYTES) {
+                    break;
+                }
+                if (Game::isKnownSize(base[pos + 4]) && base[pos + 5] <= 2) {
+                    offsets.push_back(pos);
+                } else {
+                    ++skipped;
+                }
+                pos += 4 + recordLength;
+            }
+            return true;
+        }
+
+        void close() {
+            if (!base) return;
+            munmap(const_cast<uint8_t*>(base), length);
+            base = nullptr;
+            length = 0;
+            offsets.clear();
+            skipped = 0;
+        }
+
+        size_t count() const { return offsets.size(); }
+        size_t skippedCount() const { return skipped; }
+        size_t bytes() const { return length; }
+
+        View view(size_t i) const {
+            const uint8_t* p = base + offsets[i];
+            View v;
+            v.size = p[4];
+            v.winner = p[5];
+            v.seed = static_cast<uint32_t>(getLe(p + 8, 4));
+            v.actionCount = static_cast<uint32_t>(getLe(p + 12, 4));
+            v.actions = p + RECORD_HEADER_SIZE;
+            return v;
+        }
+    };
+}
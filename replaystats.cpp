@@ -0,0 +1,279 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "replay.h"
+
+// ============= СТАТИСТИКА ПО АРХИВУ ПАРТИЙ =============
+// Отображает архив replay.h в память и переигрывает партии по правилам
+// game.h на пуле потоков. Каждый поток копит свою статистику и берет
+// партии из общего счетчика, в конце счетчики складываются - во время
+// разбора потоки ничего не делят.
+//
+// Считается: тепловая карта захватов по клеткам (для каждого размера поля
+// отдельно), способности победителя и проигравшего, доля побед у тех, кто
+// способность применял, и ход первой артиллерии.
+//
+//   ./selfplay --games 1000 --size 16 --replays data/games.cwrp
+//   ./replaystats data/games.cwrp --json stats.json --csv stats
+
+namespace {
+    const int ARTILLERY = 4; // Индекс в ABILITIES
+
+    struct Stats {
+        uint64_t games = 0;
+        uint64_t wins[3] = {};          // [0] - партия не закончена
+        uint64_t turns = 0;
+        uint64_t mismatches = 0;        // Переигровка разошлась с записанным итогом
+        uint64_t usesByWinner[NUM_ABILITIES] = {};
+        uint64_t usesByLoser[NUM_ABILITIES] = {};
+        uint64_t sidesUsing[NUM_ABILITIES] = {};   // Игроков (в законченных партиях), применивших хоть раз
+        uint64_t sidesUsingWon[NUM_ABILITIES] = {};
+        uint64_t artilleryGames = 0;
+        uint64_t firstArtilleryTurnSum = 0;
+        // Размер поля -> захваты [клетка * 2 + игрок - 1], клетка = x * size + y
+        std::map<int, std::vector<uint64_t>> heatmaps;
+
+        void merge(const Stats& other) {
+            games += other.games;
+            turns += other.turns;
+            mismatches += other.mismatches;
+            for (int i = 0; i < 3; ++i) wins[i] += other.wins[i];
+            for (int i = 0; i < NUM_ABILITIES; ++i) {
+                usesByWinner[i] += other.usesByWinner[i];
+                usesByLoser[i] += other.usesByLoser[i];
+                sidesUsing[i] += other.sidesUsing[i];
+                sidesUsingWon[i] += other.sidesUsingWon[i];
+            }
+            artilleryGames += other.artilleryGames;
+            firstArtilleryTurnSum += other.firstArtilleryTurnSum;
+            for (const auto& entry : other.heatmaps) {
+                std::vector<uint64_t>& mine = heatmaps[entry.first];
+                if (mine.empty()) mine.assign(entry.second.size(), 0);
+                for (size_t i = 0; i < mine.size(); ++i) mine[i] += entry.second[i];
+            }
+        }
+    };
+
+    // Переигрывает одну партию и добавляет ее в stats. Игра переиспользуется
+    // между партиями одного потока (Game::reset).
+    void replayGame(const Replay::View& replay, Game& game, Stats& stats) {
+        if (replay.size != game.getSize()) {
+            game = Game(replay.size, replay.seed, false);
+            game.setParallel(false);
+            game.setJournalEnabled(true);
+        } else {
+            game.reset(replay.seed);
+        }
+
+        std::vector<uint64_t>& heatmap = stats.heatmaps[replay.size];
+        if (heatmap.empty()) heatmap.assign(static_cast<size_t>(replay.size) * replay.size * 2, 0);
+
+        int uses[2][NUM_ABILITIES] = {};
+        int turn = 0, firstArtillery = -1;
+        for (uint32_t i = 0; i < replay.actionCount && !game.isGameOver(); ++i) {
+            Action action = replay.action(i);
+            if (!game.playAction(action)) {
+                game.playPass();
+                action = Action::pass();
+            }
+
+            for (const CellDiff& diff : game.getCellJournal()) {
+                int before = diff.before & 0x0F, after = diff.after & 0x0F;
+                if (after != before && (after == 1 || after == 2)) {
+                    ++heatmap[(static_cast<size_t>(diff.x) * replay.size + diff.y) * 2 + after - 1];
+                }
+            }
+            for (const GameEvent& event : game.getEventJournal()) {
+                if (event.type != GameEvent::ABILITY_USED) continue;
+                ++uses[event.playerId - 1][event.ability];
+                if (event.ability == ARTILLERY && firstArtillery < 0) firstArtillery = turn;
+            }
+            game.clearJournal();
+            if (action.kind != Action::ABILITY) ++turn;
+        }
+
+        int winner = game.isGameOver() ? game.getWinner() : 0;
+        ++stats.games;
+        ++stats.wins[winner];
+        stats.turns += turn;
+        if (winner != replay.winner) ++stats.mismatches;
+        if (firstArtillery >= 0) {
+            ++stats.artilleryGames;
+            stats.firstArtilleryTurnSum += firstArtillery;
+        }
+        if (winner == 0) return;
+        for (int a = 0; a < NUM_ABILITIES; ++a) {
+            stats.usesByWinner[a] += uses[winner - 1][a];
+            stats.usesByLoser[a] += uses[2 - winner][a];
+            for (int p = 0; p < 2; ++p) {
+                if (uses[p][a] == 0) continue;
+                ++stats.sidesUsing[a];
+                if (p == winner - 1) ++stats.sidesUsingWon[a];
+            }
+        }
+    }
+
+    double ratio(uint64_t a, uint64_t b) {
+        return b ? static_cast<double>(a) / b : 0.0;
+    }
+
+    // Имена способностей - UTF-8 без кавычек и обратных слэшей,
+    // экранировать нечего
+    bool writeJson(const std::string& path, const Stats& stats) {
+        FILE* f = std::fopen(path.c_str(), "w");
+        if (!f) return false;
+        std::fprintf(f, "{\n  \"games\": %llu,\n", static_cast<unsigned long long>(stats.games));
+        std::fprintf(f, "  \"wins\": {\"player1\": %llu, \"player2\": %llu, \"unfinished\": %llu},\n",
+                     static_cast<unsigned long long>(stats.wins[1]), static_cast<unsigned long long>(stats.wins[2]),
+                     static_cast<unsigned long long>(stats.wins[0]));
+        std::fprintf(f, "  \"average_turns\": %.3f,\n", ratio(stats.turns, stats.games));
+        std::fprintf(f, "  \"mismatches\": %llu,\n", static_cast<unsigned long long>(stats.mismatches));
+        std::fprintf(f, "  \"artillery_games\": %llu,\n", static_cast<unsigned long long>(stats.artilleryGames));
+        std::fprintf(f, "  \"average_first_artillery_turn\": %.3f,\n",
+                     ratio(stats.firstArtilleryTurnSum, stats.artilleryGames));
+        std::fprintf(f, "  \"abilities\": [\n");
+        for (int a = 0; a < NUM_ABILITIES; ++a) {
+            std::fprintf(f, "    {\"index\": %d, \"name\": \"%s\", \"uses_by_winner\": %llu, \"uses_by_loser\": %llu, "
+                            "\"players_using\": %llu, \"win_rate_when_used\": %.4f}%s\n",
+                         a, ABILITIES[a].name.c_str(), static_cast<unsigned long long>(stats.usesByWinner[a]),
+                         static_cast<unsigned long long>(stats.usesByLoser[a]),
+                         static_cast<unsigned long long>(stats.sidesUsing[a]),
+                         ratio(stats.sidesUsingWon[a], stats.sidesUsing[a]), a + 1 < NUM_ABILITIES ? "," : "");
+        }
+        std::fprintf(f, "  ],\n  \"heatmaps\": {");
+        bool first = true;
+        for (const auto& entry : stats.heatmaps) {
+            int size = entry.first;
+            std::fprintf(f, "%s\n    \"%d\": {\"player1\": [", first ? "" : ",", size);
+            for (int p = 0; p < 2; ++p) {
+                if (p == 1) std::fprintf(f, "], \"player2\": [");
+                for (int i = 0; i < size * size; ++i) {
+                    std::fprintf(f, "%s%llu", i ? "," : "", static_cast<unsigned long long>(entry.second[i * 2 + p]));
+                }
+            }
+            std::fprintf(f, "]}");
+            first = false;
+        }
+        std::fprintf(f, "\n  }\n}\n");
+        return std::fclose(f) == 0;
+    }
+
+    // PREFIX-abilities.csv и PREFIX-heatmap.csv
+    bool writeCsv(const std::string& prefix, const Stats& stats) {
+        FILE* f = std::fopen((prefix + "-abilities.csv").c_str(), "w");
+        if (!f) return false;
+        std::fprintf(f, "index,name,uses_by_winner,uses_by_loser,players_using,win_rate_when_used\n");
+        for (int a = 0; a < NUM_ABILITIES; ++a) {
+            std::fprintf(f, "%d,%s,%llu,%llu,%llu,%.4f\n", a, ABILITIES[a].name.c_str(),
+                         static_cast<unsigned long long>(stats.usesByWinner[a]),
+                         static_cast<unsigned long long>(stats.usesByLoser[a]),
+                         static_cast<unsigned long long>(stats.sidesUsing[a]),
+                         ratio(stats.sidesUsingWon[a], stats.sidesUsing[a]));
+        }
+        if (std::fclose(f) != 0) return false;
+
+        f = std::fopen((prefix + "-heatmap.csv").c_str(), "w");
+        if (!f) return false;
+        std::fprintf(f, "size,x,y,player1,player2\n");
+        for (const auto& entry : stats.heatmaps) {
+            int size = entry.first;
+            for (int i = 0; i < size * size; ++i) {
+                std::fprintf(f, "%d,%d,%d,%llu,%llu\n", size, i / size, i % size,
+                             static_cast<unsigned long long>(entry.second[i * 2]),
+                             static_cast<unsigned long long>(entry.second[i * 2 + 1]));
+            }
+        }
+        return std::fclose(f) == 0;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string archivePath, jsonPath, csvPrefix;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--json" && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csvPrefix = argv[++i];
+        } else if (archivePath.empty() && !arg.empty() && arg[0] != '-') {
+            archivePath = arg;
+        } else {
+            archivePath.clear();
+            break;
+        }
+    }
+    if (archivePath.empty()) {
+        std::fprintf(stderr, "Использование: %s АРХИВ [--json ФАЙЛ] [--csv ПРЕФИКС]\n", argv[0]);
+        return 2;
+    }
+
+    Replay::Archive archive;
+    if (!archive.open(archivePath)) {
+        std::fprintf(stderr, "Не удалось открыть архив %s\n", archivePath.c_str());
+        return 1;
+    }
+    if (archive.skippedCount() > 0) {
+        std::fprintf(stderr, "⚠️ Пропущено поврежденных записей: %zu\n", archive.skippedCount());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ThreadPool& pool = ThreadPool::instance();
+    int threads = pool.threadCount();
+    std::vector<Stats> perThread(threads);
+    std::atomic<size_t> next{0};
+    const size_t total = archive.count();
+
+    // Один кусок на поток, каждый со своими счетчиками; партии разбираются
+    // по одной из общего счетчика, так что длинные партии не ждут в хвосте
+    pool.parallelFor(0, threads, 1, [&](int begin, int) {
+        Stats& stats = perThread[begin];
+        Game game(Constants::MIN_BOARD_SIZE, 0, false);
+        game.setParallel(false);
+        game.setJournalEnabled(true);
+        for (size_t i = next.fetch_add(1); i < total; i = next.fetch_add(1)) {
+            replayGame(archive.view(i), game, stats);
+        }
+    });
+
+    Stats stats;
+    for (const Stats& part : perThread) stats.merge(part);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("Партий: %llu (%.1f МБ), %.2f с, %.0f партий/с на %d потоках\n",
+                static_cast<unsigned long long>(stats.games), archive.bytes() / 1048576.0, seconds,
+                seconds > 0 ? stats.games / seconds : 0.0, threads);
+    std::printf("Победы: %llu / %llu, не закончено: %llu, ходов в среднем: %.1f\n",
+                static_cast<unsigned long long>(stats.wins[1]), static_cast<unsigned long long>(stats.wins[2]),
+                static_cast<unsigned long long>(stats.wins[0]), ratio(stats.turns, stats.games));
+    if (stats.artilleryGames) {
+        std::printf("Первая артиллерия в среднем на ходу %.1f (%llu партий)\n",
+                    ratio(stats.firstArtilleryTurnSum, stats.artilleryGames),
+                    static_cast<unsigned long long>(stats.artilleryGames));
+    }
+    for (int a = 0; a < NUM_ABILITIES; ++a) {
+        if (stats.sidesUsing[a] == 0) continue;
+        std::printf("  %s: победитель %llu, проигравший %llu, побед у применивших %.1f%%\n",
+                    ABILITIES[a].name.c_str(), static_cast<unsigned long long>(stats.usesByWinner[a]),
+                    static_cast<unsigned long long>(stats.usesByLoser[a]),
+                    100.0 * ratio(stats.sidesUsingWon[a], stats.sidesUsing[a]));
+    }
+    if (stats.mismatches) {
+        std::printf("Внимание: %llu партий закончились не так, как записано\n",
+                    static_cast<unsigned long long>(stats.mismatches));
+    }
+
+    if (!jsonPath.empty() && !writeJson(jsonPath, stats)) {
+        std::fprintf(stderr, "Не удалось записать %s\n", jsonPath.c_str());
+        return 1;
+    }
+    if (!csvPrefix.empty() && !writeCsv(csvPrefix, stats)) {
+        std::fprintf(stderr, "Не удалось записать %s-*.csv\n", csvPrefix.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "state_ring.h"
+
+// ============= ПРОСМОТР КОЛЬЦА СОСТОЯНИЙ =============
+// Читает кольцо из state_ring.h: печатает последнюю позицию или с --follow
+// каждый новый ход и сколько ходов пропущено, если читатель не успел.
+// --demo играет случайную партию без терминала и пишет ее в кольцо, чтобы
+// проверить все без интерактивной игры.
+//
+//   CELL_WARFARE_SHM=/cell-warfare ./game
+//   ./ringview /cell-warfare --follow --board
+//   ./ringview /cell-warfare --demo 32
+
+namespace {
+    void printSnapshot(const StateRing::Snapshot& snapshot, bool showBoard) {
+        std::printf("ход %llu: счет %d:%d, ходит %d%s\n",
+                    static_cast<unsigned long long>(snapshot.turn), snapshot.scores[0], snapshot.scores[1],
+                    snapshot.currentPlayer, snapshot.gameOver ? ", игра окончена" : "");
+        if (snapshot.gameOver) std::printf("победил игрок %d\n", snapshot.winner);
+        if (!showBoard) return;
+        for (int y = 0; y < snapshot.boardSize; ++y) {
+            for (int x = 0; x < snapshot.boardSize; ++x) {
+                char c = '.';
+                if (snapshot.test(StateRing::PLANE_PLAYER1, x, y)) c = '1';
+                if (snapshot.test(StateRing::PLANE_PLAYER2, x, y)) c = '2';
+                if (snapshot.test(StateRing::PLANE_SABOTAGE, x, y)) c = '$';
+                if (snapshot.test(StateRing::PLANE_FORTIFIED, x, y)) c = '#';
+                if (snapshot.test(StateRing::PLANE_KING, x, y)) c = 'K';
+                std::putchar(c);
+            }
+            std::putchar('\n');
+        }
+    }
+
+    // Случайная партия без терминала: захваты доступных клеток, раз в
+    // delayMs миллисекунд
+    int runDemo(const std::string& name, int size, int delayMs) {
+        StateRing::Writer ring;
+        if (!ring.open(name, size)) {
+            std::perror("shm_open");
+            return 1;
+        }
+        Game game(size, 1, false);
+        game.setTurnObserver([&ring](const Game& g) { ring.publish(g); });
+        std::mt19937 rng(1);
+
+        int turns = 0;
+        while (!game.isGameOver() && turns < 100000) {
+            const std::vector<uint32_t>& available = game.getAvailableCells();
+            int chosen = available.empty() ? -1 : static_cast<int>(available[rng() % available.size()]);
+            if (chosen < 0 || !game.playCapture(chosen / size, chosen % size)) game.playPass();
+            ++turns;
+            if (delayMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+        }
+        std::printf("Записано ходов: %d\n", turns);
+        return 0;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string name = "/cell-warfare";
+    bool follow = false, showBoard = false;
+    int demoSize = 0, delayMs = 20;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--follow") {
+            follow = true;
+        } else if (arg == "--board") {
+            showBoard = true;
+        } else if (arg == "--demo" && i + 1 < argc) {
+            demoSize = std::atoi(argv[++i]);
+        } else if (arg == "--delay" && i + 1 < argc) {
+            delayMs = std::atoi(argv[++i]);
+        } else if (!arg.empty() && arg[0] == '/') {
+            name = arg;
+        } else {
+            std::fprintf(stderr, "Использование: %s [/ИМЯ] [--follow] [--board] [--demo РАЗМЕР [--delay МС]]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (demoSize > 0) return runDemo(name, demoSize, delayMs);
+
+    StateRing::Reader ring;
+    if (!ring.open(name)) {
+        std::fprintf(stderr, "Кольцо %s не найдено\n", name.c_str());
+        return 1;
+    }
+
+    StateRing::Snapshot snapshot;
+    if (!follow) {
+        if (!ring.latest(snapshot)) {
+            std::printf("Ходов еще не было\n");
+            return 0;
+        }
+        printSnapshot(snapshot, showBoard);
+        return 0;
+    }
+
+    uint64_t next = 1;
+    unsigned long long missed = 0;
+    for (;;) {
+        uint64_t published = ring.published();
+        if (published < next) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            continue;
+        }
+        // Отставший читатель перескакивает к самому старому живому слоту
+        if (published - next >= ring.slotCount()) {
+            uint64_t oldest = published - ring.slotCount() + 1;
+            missed += oldest - next;
+            next = oldest;
+        }
+        if (!ring.read(next, snapshot)) {
+            ++missed;
+            ++next;
+            continue;
+        }
+        printSnapshot(snapshot, showBoard);
+        ++next;
+        if (snapshot.gameOver) break;
+    }
+    std::printf("Пропущено ходов: %llu\n", missed);
+    return 0;
+}
@@ -0,0 +1,296 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bot.h"
+#include "dataset.h"
+#include "nnue.h"
+#include "opening_book.h"
+#include "replay.h"
+
+// ============= САМОИГРА =============
+// Играет партии без терминала на пуле потоков и пишет каждую позицию в
+// шарды dataset.h. Партии считаются пачками параллельно, а пишутся по
+// порядку номеров, так что набор зависит только от --seed. С --replays
+// партии еще и дописываются в архив replay.h для replaystats. С --nnue
+// игрок 1 ходит жадно по оценке сети nnue.h (аккумулятор ведется по
+// журналу партии), игрок 2 - как без нее; в конце печатаются победы. Так
+// же с --eval игрок 1 ходит жадно по оценке с весами evaltune.cpp.
+// С --book первые --book-plies позиций каждой партии анализируются и
+// пишутся в книгу дебютов opening_book.h (жадный бот при этом и ходит по
+// анализу, так что книга покрывает свои же продолжения); с --use-book
+// жадный бот берет ходы из книги, когда позиция в ней есть. В конце
+// печатается, сколько проходов по полю ушло на видимость и автозахват за
+// ход и сколько запросов было (столько проходов делала игра
+// до учета изменений).
+//
+//   ./selfplay --games 200 --size 16 --out data/selfplay
+//   ./selfplay --games 1000 --size 16 --replays data/games.cwrp
+//   ./selfplay --games 100 --size 16 --greedy --nnue nnue16.cwnn
+//   ./selfplay --games 100 --size 16 --greedy --eval eval16.weights
+//   ./selfplay --games 1000 --size 16 --greedy --book book16.cwob
+//   ./selfplay --games 1000 --size 16 --greedy --use-book book16.cwob
+//   ./selfplay --read data/selfplay-00000.cwds 1234
+
+namespace {
+    struct Options {
+        int games = 100;
+        int size = Constants::BOARD_SIZE_SMALL;
+        int maxPlies = 400;
+        uint32_t seed = 1;
+        bool greedy = false;   // Ходы Bot::chooseMove вместо случайных захватов
+        std::string out = "selfplay";
+        std::string replays;   // Пусто - архив партий не пишется
+        std::string nnue;      // Веса сети для игрока 1, пусто - без сети
+        std::string eval;      // Веса оценки Bot::Weights для игрока 1
+        std::string book;      // Куда писать книгу дебютов, пусто - не писать
+        int bookPlies = OpeningBook::DEFAULT_PLIES;
+        std::string useBook;   // Книга для жадного бота
+    };
+
+    // Общие для всех партий сеть, веса оценки и книга, только для чтения
+    struct Engines {
+        const Nnue::Network* network = nullptr;
+        const Bot::Weights* weights = nullptr;
+        const OpeningBook::Book* book = nullptr;
+    };
+
+    struct PlayedGame {
+        std::vector<Dataset::Position> positions;
+        Replay::Record replay;
+        std::vector<OpeningBook::Entry> bookEntries;
+        int bookMoves = 0;     // Ходов, взятых из книги
+        int result = 0;
+        DerivedCounters derived;
+    };
+
+    Action randomCapture(const Game& game, std::mt19937& rng) {
+        int size = game.getSize();
+        const std::vector<uint32_t>& available = game.getAvailableCells();
+        if (available.empty()) return Action::pass();
+        int chosen = static_cast<int>(available[rng() % available.size()]);
+        return Action::capture(chosen / size, chosen % size);
+    }
+
+    void playGame(const Options& options, const Engines& engines, uint32_t gameId, PlayedGame& played) {
+        const Nnue::Network* network = engines.network;
+        uint32_t seed = options.seed * 1000003u + gameId;
+        Game game(options.size, seed, false);
+        game.setParallel(false); // Параллельно идут сами партии
+        std::mt19937 rng(seed);
+        Nnue::Accumulator acc;
+        if (network) {
+            Nnue::Evaluator(*network).refresh(game, acc);
+            game.setJournalEnabled(true);
+        }
+
+        played.positions.clear();
+        played.replay.size = options.size;
+        played.replay.seed = seed;
+        played.replay.actions.clear();
+        played.bookEntries.clear();
+        played.bookMoves = 0;
+        for (int ply = 0; ply < options.maxPlies && !game.isGameOver(); ++ply) {
+            played.positions.emplace_back();
+            played.positions.back().capture(game, gameId, static_cast<uint32_t>(ply));
+            bool analyzed = !options.book.empty() && ply < options.bookPlies;
+            Action action;
+            if (analyzed) played.bookEntries.push_back(OpeningBook::makeEntry(game, &action));
+
+            if (network && game.getCurrentPlayer() == 0) {
+                action = Nnue::Evaluator(*network).chooseMove(game, acc, rng());
+            } else if (engines.weights && game.getCurrentPlayer() == 0) {
+                action = Bot::chooseMove(game, rng(), engines.weights);
+            } else if (options.greedy && analyzed) {
+                rng(); // Столько же случайных чисел, сколько без книги
+            } else if (options.greedy) {
+                bool fromBook = false;
+                action = OpeningBook::chooseMove(engines.book, game, rng(), &fromBook);
+                played.bookMoves += fromBook;
+            } else {
+                action = randomCapture(game, rng);
+            }
+            if (!game.playAction(action)) {
+                action = Action::pass();
+                game.playPass();
+            }
+            if (network) {
+                Nnue::Evaluator(*network).update(acc, game.getCellJournal());
+                game.clearJournal();
+            }
+            played.replay.actions.push_back(action);
+        }
+        played.result = game.getWinner();
+        played.derived = game.getDerivedCounters();
+        played.replay.winner = played.result;
+    }
+
+    int readPosition(const std::string& path, uint32_t k) {
+        Dataset::ShardReader reader;
+        if (!reader.open(path)) {
+            std::fprintf(stderr, "Не удалось открыть шард %s\n", path.c_str());
+            return 1;
+        }
+        Dataset::Position p;
+        if (!reader.read(k, p)) {
+            std::fprintf(stderr, "Позиции %u нет (в шарде %u)\n", k, reader.positionCount());
+            return 1;
+        }
+        std::printf("партия %u, ход %u, ходит %d, счет %d:%d, итог %d\n",
+                    p.gameId, p.ply, p.toMove, p.scores[0], p.scores[1], p.result);
+        std::vector<char> marks(p.owners.size());
+        for (size_t i = 0; i < p.owners.size(); ++i) marks[i] = p.owners[i] ? static_cast<char>('0' + p.owners[i]) : '.';
+        for (uint32_t i : p.sabotage) marks[i] = '$';
+        for (uint32_t i : p.fortified) marks[i] = '#';
+        for (uint32_t i : p.kings) marks[i] = 'K';
+        for (int y = 0; y < p.size; ++y) {
+            for (int x = 0; x < p.size; ++x) std::putchar(marks[x * p.size + y]);
+            std::putchar('\n');
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--read" && i + 2 < argc) {
+            return readPosition(argv[i + 1], static_cast<uint32_t>(std::strtoul(argv[i + 2], nullptr, 10)));
+        } else if (arg == "--greedy") {
+            options.greedy = true;
+        } else if (i + 1 < argc && arg == "--games") {
+            options.games = std::max(1, std::atoi(argv[++i]));
+        } else if (i + 1 < argc && arg == "--size") {
+            options.size = std::atoi(argv[++i]);
+        } else if (i + 1 < argc && arg == "--max-plies") {
+            options.maxPlies = std::max(1, std::atoi(argv[++i]));
+        } else if (i + 1 < argc && arg == "--seed") {
+            options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (i + 1 < argc && arg == "--out") {
+            options.out = argv[++i];
+        } else if (i + 1 < argc && arg == "--replays") {
+            options.replays = argv[++i];
+        } else if (i + 1 < argc && arg == "--nnue") {
+            options.nnue = argv[++i];
+        } else if (i + 1 < argc && arg == "--eval") {
+            options.eval = argv[++i];
+        } else if (i + 1 < argc && arg == "--book") {
+            options.book = argv[++i];
+        } else if (i + 1 < argc && arg == "--book-plies") {
+            options.bookPlies = std::max(1, std::atoi(argv[++i]));
+        } else if (i + 1 < argc && arg == "--use-book") {
+            options.useBook = argv[++i];
+        } else {
+            std::fprintf(stderr, "Использование: %s [--games N] [--size N] [--max-plies N] [--seed N] [--greedy] "
+                                 "[--out ПРЕФИКС] [--replays АРХИВ] [--nnue ВЕСА]\n"
+                                 "       [--eval ВЕСА] [--book КНИГА] [--book-plies N] [--use-book КНИГА]\n       %s --read ШАРД K\n", argv[0], argv[0]);
+            return 2;
+        }
+    }
+    if (!Game::isKnownSize(options.size)) {
+        std::fprintf(stderr, "Размер поля - %d, %d или %d\n", Constants::BOARD_SIZE_SMALL,
+                     Constants::BOARD_SIZE_MEDIUM, Constants::BOARD_SIZE_LARGE);
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Dataset::Writer writer(options.out, options.size);
+    Replay::Writer replays;
+    if (!options.replays.empty() && !replays.open(options.replays)) {
+        std::fprintf(stderr, "Не удалось открыть архив %s\n", options.replays.c_str());
+        return 1;
+    }
+    Nnue::Network network;
+    if (!options.nnue.empty()) {
+        if (!network.load(options.nnue)) {
+            std::fprintf(stderr, "Не удалось прочитать веса %s\n", options.nnue.c_str());
+            return 1;
+        }
+        if (network.size != options.size) {
+            std::fprintf(stderr, "Веса %s - для поля %d\n", options.nnue.c_str(), network.size);
+            return 2;
+        }
+    }
+    Bot::Weights weights;
+    if (!options.eval.empty() && !weights.load(options.eval)) {
+        std::fprintf(stderr, "Не удалось прочитать веса %s\n", options.eval.c_str());
+        return 1;
+    }
+    OpeningBook::Book book;
+    if (!options.useBook.empty()) {
+        if (!book.open(options.useBook)) {
+            std::fprintf(stderr, "Не удалось открыть книгу %s\n", options.useBook.c_str());
+            return 1;
+        }
+        if (book.getBoardSize() != options.size) {
+            std::fprintf(stderr, "Книга %s - для поля %d\n", options.useBook.c_str(), book.getBoardSize());
+            return 2;
+        }
+    }
+    Engines engines;
+    engines.network = options.nnue.empty() ? nullptr : &network;
+    engines.weights = options.eval.empty() ? nullptr : &weights;
+    engines.book = options.useBook.empty() ? nullptr : &book;
+    int wins[3] = {0, 0, 0};
+    uint64_t bookMoves = 0;
+    DerivedCounters derived;
+    std::vector<OpeningBook::Entry> bookEntries;
+    ThreadPool& pool = ThreadPool::instance();
+    int batch = pool.threadCount() * 4;
+    std::vector<PlayedGame> played(batch);
+
+    for (int first = 0; first < options.games; first += batch) {
+        int count = std::min(batch, options.games - first);
+        pool.parallelFor(0, count, 1, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) playGame(options, engines, static_cast<uint32_t>(first + i), played[i]);
+        });
+        if (!writer.ok()) break;
+        for (int i = 0; i < count; ++i) {
+            writer.writeGame(played[i].positions, played[i].result);
+            wins[played[i].result]++;
+            bookMoves += played[i].bookMoves;
+            derived += played[i].derived;
+            bookEntries.insert(bookEntries.end(), played[i].bookEntries.begin(), played[i].bookEntries.end());
+            if (!options.replays.empty()) replays.write(played[i].replay);
+        }
+    }
+    writer.close();
+    replays.close();
+    if (!writer.ok()) return 1;
+    size_t bookPositions = bookEntries.size();
+    if (!options.book.empty() && !OpeningBook::write(options.book, options.size, options.bookPlies, bookEntries)) {
+        std::fprintf(stderr, "Не удалось записать книгу %s\n", options.book.c_str());
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double perPosition = writer.positions() ? static_cast<double>(writer.bytesWritten()) / writer.positions() : 0;
+    std::printf("Партий: %d, позиций: %llu, шардов: %d, %.1f с\n", options.games,
+                static_cast<unsigned long long>(writer.positions()), writer.shards(), seconds);
+    std::printf("%.1f байт на позицию (Cell как есть - %zu байт)\n", perPosition,
+                sizeof(Cell) * options.size * options.size);
+    double plies = writer.positions() ? static_cast<double>(writer.positions()) : 1;
+    std::printf("На ход: видимость - %.2f запроса, %.2f полных и %.2f частичных проходов "
+                "(частичный - %.0f клеток из %d); автозахват - %.2f запроса, %.2f проходов\n",
+                derived.requests / plies, derived.fullPasses / plies, derived.partialPasses / plies,
+                derived.partialPasses ? static_cast<double>(derived.cellsRecomputed) / derived.partialPasses : 0.0,
+                options.size * options.size, derived.enclosureRequests / plies, derived.enclosureRuns / plies);
+    if (!options.book.empty()) {
+        std::printf("Книга: %zu позиций (всего встретилось %zu) в %s\n", bookEntries.size(), bookPositions,
+                    options.book.c_str());
+    }
+    if (engines.book) {
+        std::printf("Ходов из книги: %llu (в книге %llu позиций)\n", static_cast<unsigned long long>(bookMoves),
+                    static_cast<unsigned long long>(book.size()));
+    }
+    if (engines.network) {
+        std::printf("Побед: игрок 1 (сеть) - %d, игрок 2 - %d, не доиграно - %d\n", wins[1], wins[2], wins[0]);
+    } else if (engines.weights) {
+        std::printf("Побед: игрок 1 (веса) - %d, игрок 2 - %d, не доиграно - %d\n", wins[1], wins[2], wins[0]);
+    }
+    return 0;
+}
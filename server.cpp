@@ -0,0 +1,981 @@
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <sys/eventfd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "bot.h"
+#include "protocol.h"
+#include "spectator.h"
+
+// ============= СЕРВЕР МАТЧЕЙ =============
+// Один процесс и один поток на цикле epoll держит тысячи партий. Каждая
+// партия - Game без терминала, а игроки шлют ходы кадрами из protocol.h.
+// Каждый игрок получает поле только в пределах своей видимости.
+//
+// Партия - это корутина (runSession): она ждет хода человека через
+// co_await NextAction и просыпается, когда цикл получает его кадр. Ход бота
+// считается в отдельном пуле потоков (co_await BotMove), а результат
+// возвращается в цикл через eventfd, так что медленный перебор не
+// задерживает сокеты. Своих потоков у партий нет: ждущая партия - это
+// только ее кадр корутины и Game.
+//
+// Зрители (MSG_SPECTATE) получают трансляцию из spectator.h: кадр хода
+// кодируется один раз, и в очереди всех зрителей кладется ссылка на один и
+// тот же буфер. Журнал партии включен, только пока у нее есть зрители.
+//
+//   ./server --tcp 7878
+//   ./server --unix /tmp/cell-warfare.sock --bot-threads 4
+
+namespace {
+    volatile sig_atomic_t stopRequested = 0;
+
+    void onStopSignal(int) {
+        stopRequested = 1;
+    }
+
+    uint64_t microsSince(std::chrono::steady_clock::time_point start) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+
+    uint64_t cpuMicros() {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return static_cast<uint64_t>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+               usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+    }
+
+    bool setNonBlocking(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+
+    struct UniqueFd {
+        int fd;
+
+        explicit UniqueFd(int f) : fd(f) {}
+        ~UniqueFd() {
+            if (fd >= 0) ::close(fd);
+        }
+        UniqueFd(const UniqueFd&) = delete;
+        UniqueFd& operator=(const UniqueFd&) = delete;
+    };
+
+    // Кадров трансляции в очереди зрителя, после которых он считается
+    // отставшим и отписывается
+    const size_t MAX_SPECTATOR_BACKLOG = 1024;
+
+    // Неотправленных байт собственных ответов, после которых соединение
+    // перестает читать запросы, пока клиент не заберет ответы
+    const size_t MAX_OUTPUT_BACKLOG = 4 << 20;
+
+    struct Connection {
+        int fd;
+        std::vector<uint8_t> input;
+        std::vector<uint8_t> output;
+        size_t outputSent;
+        std::deque<Spectator::Frame> feed; // Общие кадры трансляции, уходят после output
+        size_t feedSent;                   // Отправлено байт первого кадра feed
+        uint32_t events;                   // Маска, с которой fd записан в epoll
+        bool readPaused;                   // Запросы не читаются: клиент не забирает ответы
+        std::vector<uint32_t> games;    // Партии, где соединение занимает место
+        std::vector<uint32_t> watching; // Партии, которые соединение смотрит
+
+        explicit Connection(int f) : fd(f), outputSent(0), feedSent(0), events(EPOLLIN | EPOLLRDHUP),
+                                      readPaused(false) {}
+
+        bool hasOutput() const {
+            return output.size() > outputSent || !feed.empty();
+        }
+
+        size_t outputBacklog() const {
+            return output.size() - outputSent;
+        }
+    };
+
+    // Корутина партии. Создается приостановленной, запускается сервером и
+    // уничтожается вместе с сессией, даже если ждет хода.
+    struct SessionTask {
+        struct promise_type {
+            SessionTask get_return_object() {
+                return SessionTask(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+
+        std::coroutine_handle<promise_type> handle;
+
+        SessionTask() : handle(nullptr) {}
+        explicit SessionTask(std::coroutine_handle<promise_type> h) : handle(h) {}
+        SessionTask(SessionTask&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+        SessionTask& operator=(SessionTask&& other) noexcept {
+            if (this != &other) {
+                if (handle) handle.destroy();
+                handle = other.handle;
+                other.handle = nullptr;
+            }
+            return *this;
+        }
+        ~SessionTask() {
+            if (handle) handle.destroy();
+        }
+    };
+
+    const int SEAT_EMPTY = -1;
+    const int SEAT_BOT = -2;
+
+    struct Session {
+        uint32_t id;
+        std::unique_ptr<Game> game;
+        int seats[2];            // fd соединений игроков, SEAT_EMPTY или SEAT_BOT
+        SessionTask task;
+
+        // Где стоит корутина: ждет хода игрока waitingFor или ответа бота
+        std::coroutine_handle<> waiter;
+        int waitingFor;
+        Action inbox;            // Ход человека и соединение, откуда он пришел
+        int inboxFd;
+        uint64_t botTicket;      // Номер заказанного хода бота, 0 - не заказан
+        Action botAction;
+
+        // Трансляция: есть, только пока есть зрители
+        std::vector<int> spectators;
+        std::unique_ptr<Spectator::Encoder> feed;
+        std::vector<Spectator::Frame> feedHistory; // Последний ключевой кадр и дельты после него
+
+        Session() : id(0), seats{SEAT_EMPTY, SEAT_EMPTY}, waiter(nullptr), waitingFor(0),
+                    inboxFd(-1), botTicket(0) {}
+
+        bool hasHumans() const {
+            return seats[0] >= 0 || seats[1] >= 0;
+        }
+    };
+
+    struct BotResult {
+        uint32_t gameId;
+        uint64_t ticket;
+        Action action;
+    };
+
+    class MatchServer {
+    private:
+        int epollFd;
+        std::vector<int> listeners;
+        std::string unixPath;
+        std::unordered_map<int, std::unique_ptr<Connection>> connections;
+        std::unordered_map<uint32_t, Session> sessions;
+        std::vector<Connection*> pendingFlush;
+        std::vector<int> resumed;              // Снова читают: разобрать накопленные кадры
+        uint32_t nextGameId;
+        uint64_t actionsApplied;
+        std::chrono::steady_clock::time_point startedAt;
+        uint64_t cpuAtStart;
+        std::vector<uint8_t> visible;          // Рабочий буфер encodeView()
+        std::vector<uint8_t> feedPayload;      // Рабочий буфер кодировщика трансляции
+
+        // Готовые ходы ботов: пишут потоки пула, читает цикл по сигналу eventfd
+        UniqueFd botEvents;
+        std::mutex botResultsMutex;
+        std::vector<BotResult> botResults;
+        std::vector<BotResult> botResultsDrained;
+        uint64_t nextBotTicket;
+        ThreadPool botWorkers; // Последним: останавливается первым, пока очередь результатов жива
+
+        // ============= КОРУТИНА ПАРТИИ =============
+        struct NextAction {
+            Session& session;
+            int playerId;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) {
+                session.waiter = h;
+                session.waitingFor = playerId;
+            }
+            Action await_resume() {
+                session.waiter = nullptr;
+                session.waitingFor = 0;
+                return session.inbox;
+            }
+        };
+
+        struct BotMove {
+            MatchServer& server;
+            Session& session;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) {
+                session.waiter = h;
+                server.startBot(session);
+            }
+            Action await_resume() {
+                session.waiter = nullptr;
+                return session.botAction;
+            }
+        };
+
+        // Игра думает над копией позиции в пуле, сама партия в это время
+        // доступна циклу только на чтение (MSG_VIEW)
+        void startBot(Session& session) {
+            uint64_t ticket = ++nextBotTicket;
+            session.botTicket = ticket;
+            auto snapshot = std::make_shared<Game>(*session.game);
+            snapshot->setJournalEnabled(false); // Пробные ходы бота зрителям не нужны
+            uint32_t gameId = session.id;
+
+            botWorkers.submit([this, snapshot, gameId, ticket] {
+                Action action = Bot::chooseMove(*snapshot, static_cast<uint32_t>(ticket));
+                {
+                    std::lock_guard<std::mutex> lock(botResultsMutex);
+                    botResults.push_back({gameId, ticket, action});
+                }
+                uint64_t one = 1;
+                ssize_t written = ::write(botEvents.fd, &one, sizeof(one));
+                (void)written;
+            });
+        }
+
+        void drainBotResults() {
+            uint64_t counter;
+            ssize_t n = ::read(botEvents.fd, &counter, sizeof(counter));
+            (void)n;
+            {
+                std::lock_guard<std::mutex> lock(botResultsMutex);
+                botResultsDrained.swap(botResults);
+            }
+            for (const BotResult& result : botResultsDrained) {
+                auto it = sessions.find(result.gameId);
+                // Партию могли закрыть, пока бот думал
+                if (it == sessions.end() || it->second.botTicket != result.ticket) continue;
+                Session& session = it->second;
+                session.botTicket = 0;
+                session.botAction = result.action;
+                session.waiter.resume();
+            }
+            botResultsDrained.clear();
+        }
+
+        void notifySeat(Session& session, int playerId, Protocol::Status status) {
+            auto it = connections.find(session.seats[playerId - 1]);
+            if (it == connections.end()) return;
+            sendState(*it->second, session.id, playerId, status, *session.game);
+            queue(*it->second);
+        }
+
+        SessionTask runSession(Session& session) {
+            Game& game = *session.game;
+
+            while (!game.isGameOver()) {
+                int playerId = game.getCurrentPlayer() + 1;
+
+                if (session.seats[playerId - 1] == SEAT_BOT) {
+                    Action action = co_await BotMove{*this, session};
+                    if (!game.playAction(action)) game.playPass();
+                    ++actionsApplied;
+                    publishTurn(session);
+                    notifySeat(session, 3 - playerId, Protocol::STATUS_OK);
+                    continue;
+                }
+
+                Action action = co_await NextAction{session, playerId};
+                bool applied = game.playAction(action);
+                if (applied) {
+                    ++actionsApplied;
+                    publishTurn(session);
+                }
+
+                auto requester = connections.find(session.inboxFd);
+                if (requester != connections.end()) {
+                    sendState(*requester->second, session.id, playerId,
+                              applied ? Protocol::STATUS_OK : Protocol::STATUS_ILLEGAL, game);
+                }
+                // Сопернику - его новое представление поля
+                if (applied && session.seats[2 - playerId] >= 0) {
+                    notifySeat(session, 3 - playerId, Protocol::STATUS_OK);
+                }
+            }
+        }
+
+        // ============= ТРАНСЛЯЦИЯ =============
+        // Кадр MSG_SPECTATOR_FRAME вокруг feedPayload; nullptr - не влезает в кадр протокола
+        Spectator::Frame wrapFeed(uint32_t gameId) {
+            if (Protocol::HEADER_SIZE + 1 + 4 + feedPayload.size() > Protocol::MAX_FRAME + Protocol::HEADER_SIZE) {
+                return nullptr;
+            }
+            auto frame = std::make_shared<std::vector<uint8_t>>();
+            frame->reserve(Protocol::HEADER_SIZE + 1 + 4 + feedPayload.size());
+            Protocol::Writer w(*frame);
+            w.begin(Protocol::MSG_SPECTATOR_FRAME);
+            w.u32(gameId);
+            w.bytes(feedPayload.data(), feedPayload.size());
+            w.end();
+            return frame;
+        }
+
+        bool takeKeyframe(Session& session) {
+            feedPayload.clear();
+            if (!session.feed->encodeKeyframe(*session.game, feedPayload)) return false;
+            Spectator::Frame keyframe = wrapFeed(session.id);
+            if (!keyframe) return false;
+            session.feedHistory.clear();
+            session.feedHistory.push_back(keyframe);
+            return true;
+        }
+
+        void sendFeed(Connection& conn, uint32_t gameId, const Spectator::Frame& frame) {
+            if (conn.feed.size() >= MAX_SPECTATOR_BACKLOG) {
+                dropSpectator(gameId, conn);
+                return;
+            }
+            conn.feed.push_back(frame);
+            queue(conn);
+        }
+
+        // Дельта хода всем зрителям партии
+        void publishTurn(Session& session) {
+            if (!session.feed) return;
+            feedPayload.clear();
+            Spectator::Frame delta;
+            if (session.feed->encodeDelta(*session.game, feedPayload)) delta = wrapFeed(session.id);
+            if (!delta) {
+                stopFeed(session);
+                return;
+            }
+            // dropSpectator() правит список, поэтому обходим копию
+            std::vector<int> spectators = session.spectators;
+            for (int fd : spectators) {
+                auto it = connections.find(fd);
+                if (it != connections.end()) sendFeed(*it->second, session.id, delta);
+            }
+            if (!session.feed) return;
+
+            if (session.feed->keyframeDue()) {
+                if (!takeKeyframe(session)) stopFeed(session);
+            } else {
+                session.feedHistory.push_back(delta);
+            }
+        }
+
+        void closeFeedIfUnwatched(Session& session) {
+            if (!session.spectators.empty()) return;
+            session.feed.reset();
+            session.feedHistory.clear();
+            session.game->setJournalEnabled(false);
+        }
+
+        void removeSpectator(uint32_t gameId, Connection& conn) {
+            conn.watching.erase(std::remove(conn.watching.begin(), conn.watching.end(), gameId), conn.watching.end());
+            auto it = sessions.find(gameId);
+            if (it == sessions.end()) return;
+            Session& session = it->second;
+            session.spectators.erase(std::remove(session.spectators.begin(), session.spectators.end(), conn.fd),
+                                     session.spectators.end());
+            closeFeedIfUnwatched(session);
+        }
+
+        void sendClosed(Connection& conn, uint32_t gameId) {
+            Protocol::Writer w(conn.output);
+            w.begin(Protocol::MSG_CLOSED);
+            w.u32(gameId);
+            w.end();
+            queue(conn);
+        }
+
+        // Отставший зритель теряет трансляцию: из очереди убираются еще не
+        // начатые кадры этой партии, а сам он получает MSG_CLOSED
+        void dropSpectator(uint32_t gameId, Connection& conn) {
+            removeSpectator(gameId, conn);
+            size_t keep = conn.feedSent > 0 ? 1 : 0;
+            conn.feed.erase(std::remove_if(conn.feed.begin() + keep, conn.feed.end(),
+                [gameId](const Spectator::Frame& frame) {
+                    const uint8_t* body = frame->data() + Protocol::HEADER_SIZE + 1;
+                    uint32_t id = body[0] | (body[1] << 8) | (body[2] << 16) | (static_cast<uint32_t>(body[3]) << 24);
+                    return id == gameId;
+                }), conn.feed.end());
+            sendClosed(conn, gameId);
+        }
+
+        // Партия больше не транслируется: кадр не влез в протокол, партия не на
+        // двоих или закрыта
+        void stopFeed(Session& session) {
+            std::vector<int> spectators;
+            spectators.swap(session.spectators);
+            for (int fd : spectators) {
+                auto it = connections.find(fd);
+                if (it == connections.end()) continue;
+                Connection& conn = *it->second;
+                conn.watching.erase(std::remove(conn.watching.begin(), conn.watching.end(), session.id),
+                                    conn.watching.end());
+                sendClosed(conn, session.id);
+            }
+            closeFeedIfUnwatched(session);
+        }
+
+        bool watch(int fd, uint32_t events, bool add) {
+            epoll_event ev{};
+            ev.events = events;
+            ev.data.fd = fd;
+            return epoll_ctl(epollFd, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev) == 0;
+        }
+
+        bool addListener(int fd) {
+            if (listen(fd, SOMAXCONN) != 0 || !setNonBlocking(fd) || !watch(fd, EPOLLIN, true)) {
+                std::perror("listen");
+                ::close(fd);
+                return false;
+            }
+            listeners.push_back(fd);
+            return true;
+        }
+
+        bool isListener(int fd) const {
+            for (int l : listeners) if (l == fd) return true;
+            return false;
+        }
+
+        void acceptAll(int listener) {
+            for (;;) {
+                int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) {
+                    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) std::perror("accept");
+                    return;
+                }
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Для Unix-сокета просто не сработает
+                if (!watch(fd, EPOLLIN | EPOLLRDHUP, true)) {
+                    ::close(fd);
+                    continue;
+                }
+                connections[fd] = std::make_unique<Connection>(fd);
+            }
+        }
+
+        void closeConnection(int fd) {
+            auto it = connections.find(fd);
+            if (it == connections.end()) return;
+            for (uint32_t gameId : it->second->games) {
+                releaseSeats(gameId, fd);
+            }
+            std::vector<uint32_t> watching = it->second->watching;
+            for (uint32_t gameId : watching) {
+                removeSpectator(gameId, *it->second);
+            }
+            for (auto& pending : pendingFlush) {
+                if (pending == it->second.get()) pending = nullptr;
+            }
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+            ::close(fd);
+            connections.erase(it);
+        }
+
+        // Освобождает места соединения в партии; партия без игроков удаляется
+        void releaseSeats(uint32_t gameId, int fd) {
+            auto it = sessions.find(gameId);
+            if (it == sessions.end()) return;
+            for (int& seat : it->second.seats) {
+                if (seat == fd) seat = -1;
+            }
+            if (!it->second.hasHumans()) {
+                stopFeed(it->second);
+                sessions.erase(it);
+            }
+        }
+
+        void queue(Connection& conn) {
+            if (conn.hasOutput()) pendingFlush.push_back(&conn);
+        }
+
+        // Сначала собственные ответы соединения, затем общие кадры трансляции.
+        // Начатый кадр трансляции дописывается до конца, чтобы кадры не перемешались.
+        bool flush(Connection& conn) {
+            for (;;) {
+                bool fromFeed = conn.feedSent > 0 || conn.outputSent == conn.output.size();
+                if (fromFeed && conn.feed.empty()) break;
+                const uint8_t* data;
+                size_t left;
+                if (fromFeed) {
+                    const std::vector<uint8_t>& frame = *conn.feed.front();
+                    data = frame.data() + conn.feedSent;
+                    left = frame.size() - conn.feedSent;
+                } else {
+                    data = conn.output.data() + conn.outputSent;
+                    left = conn.output.size() - conn.outputSent;
+                }
+                ssize_t n = ::send(conn.fd, data, left, MSG_NOSIGNAL);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                    return false;
+                }
+                if (!fromFeed) {
+                    conn.outputSent += static_cast<size_t>(n);
+                } else if (static_cast<size_t>(n) == left) {
+                    conn.feed.pop_front();
+                    conn.feedSent = 0;
+                } else {
+                    conn.feedSent += static_cast<size_t>(n);
+                }
+            }
+            if (conn.outputSent == conn.output.size()) {
+                conn.output.clear();
+                conn.outputSent = 0;
+                // Ответы ушли: дочитываем запросы, отложенные в conn.input
+                if (conn.readPaused) {
+                    conn.readPaused = false;
+                    resumed.push_back(conn.fd);
+                }
+            }
+            updateEvents(conn);
+            return true;
+        }
+
+        // Пока чтение приостановлено, fd ждет только записи
+        void updateEvents(Connection& conn) {
+            uint32_t events = conn.readPaused ? 0u : static_cast<uint32_t>(EPOLLIN | EPOLLRDHUP);
+            if (conn.hasOutput()) events |= EPOLLOUT;
+            if (events != conn.events) {
+                conn.events = events;
+                watch(conn.fd, events, false);
+            }
+        }
+
+        void sendError(Connection& conn, Protocol::Status status) {
+            Protocol::Writer w(conn.output);
+            w.begin(Protocol::MSG_ERROR);
+            w.u8(status);
+            w.end();
+        }
+
+        void sendState(Connection& conn, uint32_t gameId, int playerId, Protocol::Status status, const Game& game) {
+            Protocol::Writer w(conn.output);
+            Protocol::writeState(w, gameId, playerId, status, game, visible);
+        }
+
+        // Сессия и проверка, что соединение сидит на месте playerId
+        Session* seatedSession(Connection& conn, uint32_t gameId, int playerId, Protocol::Status& status) {
+            auto it = sessions.find(gameId);
+            if (it == sessions.end()) {
+                status = Protocol::STATUS_NO_SUCH_GAME;
+                return nullptr;
+            }
+            if (playerId < 1 || playerId > 2 || it->second.seats[playerId - 1] != conn.fd) {
+                status = Protocol::STATUS_NOT_SEATED;
+                return nullptr;
+            }
+            return &it->second;
+        }
+
+        void handleCreate(Connection& conn, Protocol::Reader& r) {
+            int size = r.u8();
+            uint32_t seed = r.u32();
+            int bots = r.remaining() > 0 ? r.u8() : 0;
+            const int bothBots = Protocol::BOT_PLAYER1 | Protocol::BOT_PLAYER2;
+            // Параметры правил есть только для трех размеров (setGameParameters);
+            // хотя бы одно место должно быть за человеком
+            bool knownSize = size == Constants::BOARD_SIZE_SMALL || size == Constants::BOARD_SIZE_MEDIUM ||
+                             size == Constants::BOARD_SIZE_LARGE;
+            if (!r.ok() || !knownSize ||
+                (bots & ~bothBots) != 0 || bots == bothBots) {
+                sendError(conn, Protocol::STATUS_BAD_REQUEST);
+                return;
+            }
+            uint32_t gameId = nextGameId++;
+            Session& session = sessions[gameId];
+            session.id = gameId;
+            session.game = std::make_unique<Game>(size, seed, false);
+            for (int p = 0; p < 2; ++p) {
+                session.seats[p] = (bots & (1 << p)) ? SEAT_BOT : conn.fd;
+            }
+            conn.games.push_back(gameId);
+
+            Protocol::Writer w(conn.output);
+            w.begin(Protocol::MSG_CREATED);
+            w.u32(gameId);
+            w.end();
+
+            session.task = runSession(session);
+            session.task.handle.resume();
+        }
+
+        void handleJoin(Connection& conn, Protocol::Reader& r) {
+            uint32_t gameId = r.u32();
+            int playerId = r.u8();
+            if (!r.ok() || playerId < 1 || playerId > 2) {
+                sendError(conn, Protocol::STATUS_BAD_REQUEST);
+                return;
+            }
+            auto it = sessions.find(gameId);
+            if (it == sessions.end()) {
+                sendError(conn, Protocol::STATUS_NO_SUCH_GAME);
+                return;
+            }
+            Session& session = it->second;
+            // Место можно занять, если оно свободно или его держит создатель
+            // партии за обоих игроков
+            int& seat = session.seats[playerId - 1];
+            int other = session.seats[2 - playerId];
+            if (seat == SEAT_BOT || (seat >= 0 && seat != conn.fd && seat != other)) {
+                sendError(conn, Protocol::STATUS_NOT_SEATED);
+                return;
+            }
+            seat = conn.fd;
+            conn.games.push_back(gameId);
+            sendState(conn, gameId, playerId, Protocol::STATUS_OK, *session.game);
+        }
+
+        void handleAction(Connection& conn, Protocol::Reader& r) {
+            uint32_t gameId = r.u32();
+            int playerId = r.u8();
+            int kind = r.u8();
+            int ability = r.u8();
+            int x = r.u16();
+            int y = r.u16();
+            char direction = static_cast<char>(r.u8());
+            if (!r.ok()) {
+                sendError(conn, Protocol::STATUS_BAD_REQUEST);
+                return;
+            }
+
+            Protocol::Status status = Protocol::STATUS_OK;
+            Session* session = seatedSession(conn, gameId, playerId, status);
+            if (!session) {
+                sendError(conn, status);
+                return;
+            }
+            Game& game = *session->game;
+
+            if (game.isGameOver()) {
+                status = Protocol::STATUS_GAME_OVER;
+            } else if (session->waitingFor != playerId) {
+                status = Protocol::STATUS_NOT_YOUR_TURN;
+            } else if (kind > Action::PASS) {
+                status = Protocol::STATUS_BAD_REQUEST;
+            }
+            if (status != Protocol::STATUS_OK) {
+                sendState(conn, gameId, playerId, status, game);
+                return;
+            }
+
+            Action& action = session->inbox;
+            action.kind = static_cast<uint8_t>(kind);
+            action.ability = static_cast<uint8_t>(ability);
+            action.x = static_cast<uint16_t>(x);
+            action.y = static_cast<uint16_t>(y);
+            action.direction = direction;
+            session->inboxFd = conn.fd;
+            session->waiter.resume();
+        }
+
+        void handleView(Connection& conn, Protocol::Reader& r) {
+            uint32_t gameId = r.u32();
+            int playerId = r.u8();
+            if (!r.ok()) {
+                sendError(conn, Protocol::STATUS_BAD_REQUEST);
+                return;
+            }
+            Protocol::Status status = Protocol::STATUS_OK;
+            Session* session = seatedSession(conn, gameId, playerId, status);
+            if (!session) {
+                sendError(conn, status);
+                return;
+            }
+            sendState(conn, gameId, playerId, Protocol::STATUS_OK, *session->game);
+        }
+
+        void handleLeave(Connection& conn, Protocol::Reader& r) {
+            uint32_t gameId = r.u32();
+            if (!r.ok()) {
+                sendError(conn, Protocol::STATUS_BAD_REQUEST);
+                return;
+            }
+            releaseSeats(gameId, conn.fd);
+            conn.games.erase(std::remove(conn.games.begin(), conn.games.end(), gameId), conn.games.end());
+
+            Protocol::Writer w(conn.output);
+            w.begin(Protocol::MSG_CLOSED);
+            w.u32(gameId);
+            w.end();
+        }
+
+        void handleSpectate(Connection& conn, Protocol::Reader& r) {
+            uint32_t gameId = r.u32();
+            if (!r.ok()) {
+                sendError(conn, Protocol::STATUS_BAD_REQUEST);
+                return;
+            }
+            auto it = sessions.find(gameId);
+            if (it == sessions.end()) {
+                sendError(conn, Protocol::STATUS_NO_SUCH_GAME);
+                return;
+            }
+            Session& session = it->second;
+            if (std::find(conn.watching.begin(), conn.watching.end(), gameId) != conn.watching.end()) return;
+
+            // Первый зритель включает журнал партии; трансляция начинается с
+            // ключевого кадра текущей позиции
+            if (!session.feed) {
+                session.game->setJournalEnabled(true);
+                session.feed = std::make_unique<Spectator::Encoder>();
+                if (!takeKeyframe(session)) {
+                    closeFeedIfUnwatched(session);
+                    sendError(conn, Protocol::STATUS_BAD_REQUEST);
+                    return;
+                }
+            }
+            session.spectators.push_back(conn.fd);
+            conn.watching.push_back(gameId);
+            // Опоздавший зритель догоняет по ключевому кадру и дельтам после него
+            for (const Spectator::Frame& frame : session.feedHistory) {
+                conn.feed.push_back(frame);
+            }
+        }
+
+        void handleUnspectate(Connection& conn, Protocol::Reader& r) {
+            uint32_t gameId = r.u32();
+            if (!r.ok()) {
+                sendError(conn, Protocol::STATUS_BAD_REQUEST);
+                return;
+            }
+            removeSpectator(gameId, conn);
+            sendClosed(conn, gameId);
+        }
+
+        void handleStats(Connection& conn) {
+            Protocol::Writer w(conn.output);
+            w.begin(Protocol::MSG_STATS_REPLY);
+            w.u32(static_cast<uint32_t>(sessions.size()));
+            w.u32(static_cast<uint32_t>(connections.size()));
+            w.u64(actionsApplied);
+            w.u64(cpuMicros() - cpuAtStart);
+            w.u64(microsSince(startedAt));
+            w.end();
+        }
+
+        void handleFrame(Connection& conn, const uint8_t* frame, size_t length) {
+            Protocol::Reader r(frame + Protocol::HEADER_SIZE + 1, length - Protocol::HEADER_SIZE - 1);
+            switch (frame[Protocol::HEADER_SIZE]) {
+                case Protocol::MSG_CREATE: handleCreate(conn, r); break;
+                case Protocol::MSG_JOIN: handleJoin(conn, r); break;
+                case Protocol::MSG_ACTION: handleAction(conn, r); break;
+                case Protocol::MSG_VIEW: handleView(conn, r); break;
+                case Protocol::MSG_LEAVE: handleLeave(conn, r); break;
+                case Protocol::MSG_STATS: handleStats(conn); break;
+                case Protocol::MSG_SPECTATE: handleSpectate(conn, r); break;
+                case Protocol::MSG_UNSPECTATE: handleUnspectate(conn, r); break;
+                default: sendError(conn, Protocol::STATUS_BAD_REQUEST); break;
+            }
+        }
+
+        // false - соединение нужно закрыть
+        bool onReadable(Connection& conn) {
+            if (conn.readPaused) return true;
+            uint8_t chunk[16384];
+            for (;;) {
+                ssize_t n = ::recv(conn.fd, chunk, sizeof(chunk), 0);
+                if (n == 0) return false;
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                    return false;
+                }
+                conn.input.insert(conn.input.end(), chunk, chunk + n);
+            }
+            return handleInput(conn);
+        }
+
+        // Разбирает накопленные кадры. Клиент, который шлет запросы и не
+        // забирает ответы, упирается в MAX_OUTPUT_BACKLOG: остальные кадры
+        // ждут в conn.input, пока flush() не отправит ответы
+        bool handleInput(Connection& conn) {
+            size_t consumed = 0;
+            for (;;) {
+                if (conn.outputBacklog() > MAX_OUTPUT_BACKLOG) {
+                    conn.readPaused = true;
+                    break;
+                }
+                size_t frame = Protocol::completeFrame(conn.input.data() + consumed, conn.input.size() - consumed);
+                if (frame == 0) break;
+                if (frame < static_cast<size_t>(Protocol::HEADER_SIZE + 1)) return false; // Пустой кадр без типа
+                handleFrame(conn, conn.input.data() + consumed, frame);
+                consumed += frame;
+            }
+            conn.input.erase(conn.input.begin(), conn.input.begin() + consumed);
+            queue(conn);
+            updateEvents(conn);
+            return true;
+        }
+
+    public:
+        // botThreads - потоков для ходов ботов (не считая цикла)
+        explicit MatchServer(int botThreads) :
+            epollFd(epoll_create1(EPOLL_CLOEXEC)), nextGameId(1), actionsApplied(0),
+            startedAt(std::chrono::steady_clock::now()), cpuAtStart(cpuMicros()),
+            botEvents(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), nextBotTicket(0),
+            botWorkers(botThreads + 1) {
+            watch(botEvents.fd, EPOLLIN, true);
+        }
+
+        ~MatchServer() {
+            for (auto& conn : connections) ::close(conn.first);
+            for (int fd : listeners) ::close(fd);
+            if (!unixPath.empty()) unlink(unixPath.c_str());
+            // Партии с их корутинами закрываются до остановки пула; ходы
+            // ботов, досчитанные после этого, просто останутся в очереди
+            sessions.clear();
+            ::close(epollFd);
+        }
+
+        bool listenTcp(int port) {
+            int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            int one = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(static_cast<uint16_t>(port));
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+                std::perror("bind");
+                ::close(fd);
+                return false;
+            }
+            return addListener(fd);
+        }
+
+        bool listenUnix(const std::string& path) {
+            int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+            unlink(path.c_str());
+            if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+                std::perror("bind");
+                ::close(fd);
+                return false;
+            }
+            unixPath = path;
+            return addListener(fd);
+        }
+
+        void run() {
+            std::vector<epoll_event> events(1024);
+            while (!stopRequested) {
+                // Отложенные кадры разбираются без ожидания новых событий
+                int n = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), resumed.empty() ? -1 : 0);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    std::perror("epoll_wait");
+                    return;
+                }
+                for (int i = 0; i < n; ++i) {
+                    int fd = events[i].data.fd;
+                    if (fd == botEvents.fd) {
+                        drainBotResults();
+                        continue;
+                    }
+                    if (isListener(fd)) {
+                        acceptAll(fd);
+                        continue;
+                    }
+                    auto it = connections.find(fd);
+                    if (it == connections.end()) continue;
+                    Connection& conn = *it->second;
+
+                    bool alive = true;
+                    if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                        alive = onReadable(conn);
+                    }
+                    if (alive && (events[i].events & EPOLLOUT)) {
+                        alive = flush(conn);
+                    }
+                    if (!alive) closeConnection(fd);
+                }
+
+                std::vector<int> broken;
+                std::vector<int> ready;
+                ready.swap(resumed);
+                for (int fd : ready) {
+                    auto it = connections.find(fd);
+                    if (it != connections.end() && !it->second->readPaused && !handleInput(*it->second)) {
+                        broken.push_back(fd);
+                    }
+                }
+
+                // Ответы и рассылка соперникам уходят пачкой после разбора событий
+                for (Connection* conn : pendingFlush) {
+                    if (conn && !flush(*conn)) broken.push_back(conn->fd);
+                }
+                pendingFlush.clear();
+                for (int fd : broken) closeConnection(fd);
+            }
+        }
+
+        void printSummary() const {
+            double wall = microsSince(startedAt) / 1e6;
+            double cpu = (cpuMicros() - cpuAtStart) / 1e6;
+            std::printf("Партий: %zu, соединений: %zu, ходов: %llu, CPU %.2f с за %.2f с\n",
+                        sessions.size(), connections.size(),
+                        static_cast<unsigned long long>(actionsApplied), cpu, wall);
+        }
+    };
+}
+
+int main(int argc, char** argv) {
+    std::string unixPath;
+    int tcpPort = -1;
+    int botThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--tcp" && i + 1 < argc) {
+            tcpPort = std::atoi(argv[++i]);
+        } else if (arg == "--unix" && i + 1 < argc) {
+            unixPath = argv[++i];
+        } else if (arg == "--bot-threads" && i + 1 < argc) {
+            botThreads = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::fprintf(stderr, "Использование: %s [--tcp ПОРТ] [--unix ПУТЬ] [--bot-threads N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (tcpPort < 0 && unixPath.empty()) tcpPort = 7878;
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, onStopSignal);
+    signal(SIGTERM, onStopSignal);
+
+    MatchServer server(botThreads);
+    if (tcpPort >= 0 && !server.listenTcp(tcpPort)) return 1;
+    if (!unixPath.empty() && !server.listenUnix(unixPath)) return 1;
+
+    std::printf("Сервер Cell Warfare запущен");
+    if (tcpPort >= 0) std::printf(", TCP 127.0.0.1:%d", tcpPort);
+    if (!unixPath.empty()) std::printf(", Unix %s", unixPath.c_str());
+    std::printf("\n");
+    std::fflush(stdout);
+
+    server.run();
+    server.printSummary();
+    return 0;
+}
@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+#include "bot.h"
+#include "game.h"
+#include "king_solver.h"
+#include "replay.h"
+
+// ============= ПОИСК ВЗЯТИЯ КОРОЛЯ ПО ПОЗИЦИЯМ =============
+// Решает позиции перебором king_solver.h: берет ли ходящий игрок короля
+// соперника за 1, 2, ... --k своих ходов (первое доказанное k и есть
+// ответ). Позиция - партия с зерном --seed после --plies ходов жадного бота
+// (с --random - случайных захватов) или ход --ply партии --game из архива
+// replay.h. С --positions N решаются N партий с зернами подряд, в конце -
+// сводка и узлы в секунду.
+//
+//   ./solve --size 16 --seed 7 --plies 6 --k 3
+//   ./solve --size 16 --positions 50 --plies 4 --k 4 --max-nodes 2000000
+//   ./solve --replays data/games.cwrp --game 12 --ply 5 --k 3
+
+namespace {
+    struct Options {
+        int size = Constants::BOARD_SIZE_SMALL;
+        int players = 2;
+        uint32_t seed = 1;
+        int plies = 0;
+        bool random = false;
+        int positions = 1;
+        int turns = 3;
+        uint64_t maxNodes = 5000000;
+        int tableBits = 20;
+        std::string replays;
+        size_t game = 0;
+        uint32_t ply = 0;
+    };
+
+    struct Totals {
+        int solved[3] = {};
+        uint64_t nodes = 0;
+        double seconds = 0;
+    };
+
+    const char* const verdictNames[] = {"доказано", "опровергнуто", "не решено"};
+
+    std::string describe(const Action& action) {
+        char text[96];
+        if (action.kind == Action::CAPTURE) {
+            std::snprintf(text, sizeof(text), "захват (%d,%d)", action.x, action.y);
+        } else if (action.kind == Action::ABILITY) {
+            std::snprintf(text, sizeof(text), "%s (%d,%d)%s%c", ABILITIES[action.ability].name.c_str(), action.x,
+                          action.y, action.direction ? " " : "", action.direction);
+        } else {
+            std::snprintf(text, sizeof(text), "пас");
+        }
+        return text;
+    }
+
+    // Партия с зерном seed после plies ходов самоигры
+    void playOpening(Game& game, const Options& options, uint32_t seed) {
+        std::mt19937 rng(seed);
+        bool greedy = !options.random && options.players == 2;
+        for (int ply = 0; ply < options.plies && !game.isGameOver(); ++ply) {
+            Action action = Action::pass();
+            const std::vector<uint32_t>& available = game.getAvailableCells();
+            if (greedy) {
+                action = Bot::chooseMove(game, rng());
+            } else if (!available.empty()) {
+                int chosen = static_cast<int>(available[rng() % available.size()]);
+                action = Action::capture(chosen / game.getSize(), chosen % game.getSize());
+            }
+            if (!game.playAction(action)) game.playPass();
+        }
+    }
+
+    // Первое k до turns, за которое позиция доказана; таблица общая
+    void solvePosition(const Game& game, const Options& options, const char* label, Totals& totals) {
+        int side = game.getCurrentPlayer();
+        std::printf("%s: ходит игрок %d, очки", label, side + 1);
+        for (int p = 0; p < game.getPlayerCount(); ++p) std::printf("%s%d", p ? ":" : " ", game.getPlayer(p).score);
+        std::printf("\n");
+
+        KingSolver solver(game, options.tableBits);
+        KingSolver::Result result;
+        uint64_t nodes = 0;
+        double seconds = 0;
+        int k = 1;
+        for (; k <= options.turns; ++k) {
+            result = solver.solve(k, options.maxNodes);
+            nodes += result.nodes;
+            seconds += result.seconds;
+            if (result.verdict != KingSolver::DISPROVEN) break;
+        }
+        if (result.verdict == KingSolver::PROVEN) {
+            std::printf("  взятие короля за %d ход(а), первый ход: %s\n", k, describe(result.move).c_str());
+        } else if (result.verdict == KingSolver::DISPROVEN) {
+            std::printf("  за %d ход(а) короля не взять\n", options.turns);
+        } else {
+            std::printf("  за %d ход(а) не решено: лимит %llu узлов\n", k,
+                        static_cast<unsigned long long>(options.maxNodes));
+        }
+        std::printf("  узлов: %llu, %.3f с, %.0f узлов/с\n", static_cast<unsigned long long>(nodes), seconds,
+                    seconds > 0 ? static_cast<double>(nodes) / seconds : 0.0);
+        totals.solved[result.verdict]++;
+        totals.nodes += nodes;
+        totals.seconds += seconds;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--random") {
+            options.random = true;
+        } else if (i + 1 < argc && arg == "--size") {
+            options.size = std::atoi(argv[++i]);
+        } else if (i + 1 < argc && arg == "--players") {
+            options.players = std::atoi(argv[++i]);
+        } else if (i + 1 < argc && arg == "--seed") {
+            options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (i + 1 < argc && arg == "--plies") {
+            options.plies = std::max(0, std::atoi(argv[++i]));
+        } else if (i + 1 < argc && arg == "--positions") {
+            options.positions = std::max(1, std::atoi(argv[++i]));
+        } else if (i + 1 < argc && arg == "--k") {
+            options.turns = std::max(1, std::atoi(argv[++i]));
+        } else if (i + 1 < argc && arg == "--max-nodes") {
+            options.maxNodes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && arg == "--tt-bits") {
+            options.tableBits = std::min(28, std::max(10, std::atoi(argv[++i])));
+        } else if (i + 1 < argc && arg == "--replays") {
+            options.replays = argv[++i];
+        } else if (i + 1 < argc && arg == "--game") {
+            options.game = std::strtoul(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && arg == "--ply") {
+            options.ply = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else {
+            std::fprintf(stderr, "Использование: %s [--size N] [--players N] [--seed N] [--plies N] [--random] "
+                                 "[--positions N] [--k N] [--max-nodes N] [--tt-bits N]\n"
+                                 "       %s --replays архив.cwrp [--game N] [--ply N] [--k N] [--max-nodes N]\n",
+                         argv[0], argv[0]);
+            return 2;
+        }
+    }
+
+    Totals totals;
+    if (!options.replays.empty()) {
+        Replay::Archive archive;
+        if (!archive.open(options.replays)) {
+            std::fprintf(stderr, "Не удалось открыть архив %s\n", options.replays.c_str());
+            return 1;
+        }
+        if (options.game >= archive.count()) {
+            std::fprintf(stderr, "Партии %zu нет (в архиве %zu)\n", options.game, archive.count());
+            return 1;
+        }
+        Replay::View view = archive.view(options.game);
+        Game game(view.size, view.seed, false);
+        game.setParallel(false);
+        uint32_t plies = std::min(options.ply, view.actionCount);
+        for (uint32_t i = 0; i < plies && !game.isGameOver(); ++i) game.playAction(view.action(i));
+        char label[64];
+        std::snprintf(label, sizeof(label), "Партия %zu, ход %u", options.game, plies);
+        solvePosition(game, options, label, totals);
+        return 0;
+    }
+
+    if (options.size < Constants::BOARD_SIZE_SMALL || options.size > 1024 ||
+        options.players < Constants::MIN_PLAYERS || options.players > Constants::MAX_PLAYERS) {
+        std::fprintf(stderr, "Недопустимые размер поля или число игроков\n");
+        return 2;
+    }
+    for (int i = 0; i < options.positions; ++i) {
+        uint32_t seed = options.seed + static_cast<uint32_t>(i);
+        Game game(options.size, seed, false, MapGen::Options(), options.players);
+        game.setParallel(false);
+        playOpening(game, options, seed);
+        char label[64];
+        std::snprintf(label, sizeof(label), "Зерно %u, ход %d", seed, options.plies);
+        solvePosition(game, options, label, totals);
+    }
+    if (options.positions > 1) {
+        std::printf("Позиций: %d - доказано %d, опровергнуто %d, не решено %d; узлов %llu за %.2f с, %.0f узлов/с\n",
+                    options.positions, totals.solved[KingSolver::PROVEN], totals.solved[KingSolver::DISPROVEN],
+                    totals.solved[KingSolver::UNKNOWN], static_cast<unsigned long long>(totals.nodes),
+                    totals.seconds, totals.seconds > 0 ? static_cast<double>(totals.nodes) / totals.seconds : 0.0);
+    }
+    return 0;
+}
@@ -0,0 +1,210 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "protocol.h"
+#include "spectator.h"
+
+// ============= ЗРИТЕЛЬ ПАРТИИ =============
+// Подписывается на трансляцию партии сервера матчей, восстанавливает поле
+// из ключевого кадра и дельт и печатает, сколько байт занял каждый ход по
+// сравнению с полным MSG_STATE.
+//
+//   ./spectate --tcp 127.0.0.1:7878 --game 1 --board 1
+
+namespace {
+    struct Options {
+        std::string host = "127.0.0.1";
+        int port = 7878;
+        std::string unixPath;
+        uint32_t gameId = 1;
+        int frames = 0;          // 0 - до конца партии
+        bool showBoard = false;
+    };
+
+    int connectToServer(const Options& options) {
+        int fd;
+        if (!options.unixPath.empty()) {
+            fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::strncpy(addr.sun_path, options.unixPath.c_str(), sizeof(addr.sun_path) - 1);
+            if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+                ::close(fd);
+                return -1;
+            }
+        } else {
+            fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(static_cast<uint16_t>(options.port));
+            inet_pton(AF_INET, options.host.c_str(), &addr.sin_addr);
+            if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+                ::close(fd);
+                return -1;
+            }
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        return fd;
+    }
+
+    bool sendAll(int fd, const std::vector<uint8_t>& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    void printBoard(const Spectator::Board& board) {
+        Cell cell;
+        for (int y = 0; y < board.size; ++y) {
+            for (int x = 0; x < board.size; ++x) {
+                unpackCell(board.cells[x * board.size + y], cell);
+                char c = '.';
+                if (cell.ownerId != 0) c = static_cast<char>('0' + cell.ownerId);
+                if (cell.isFortified) c = '#';
+                if (cell.kingCell) c = 'K';
+                if (cell.sabotageCell && cell.ownerId == 0) c = '$';
+                std::putchar(c);
+            }
+            std::putchar('\n');
+        }
+    }
+
+    bool parseArgs(int argc, char** argv, Options& options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) return false;
+            std::string value = argv[++i];
+            if (arg == "--tcp") {
+                size_t colon = value.rfind(':');
+                if (colon == std::string::npos) return false;
+                options.host = value.substr(0, colon);
+                options.port = std::atoi(value.c_str() + colon + 1);
+            } else if (arg == "--unix") {
+                options.unixPath = value;
+            } else if (arg == "--game") {
+                options.gameId = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+            } else if (arg == "--frames") {
+                options.frames = std::max(0, std::atoi(value.c_str()));
+            } else if (arg == "--board") {
+                options.showBoard = value != "0";
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        std::fprintf(stderr, "Использование: %s [--tcp ХОСТ:ПОРТ | --unix ПУТЬ] --game ID [--frames N] [--board 1]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    int fd = connectToServer(options);
+    if (fd < 0) {
+        std::fprintf(stderr, "Не удалось подключиться к серверу\n");
+        return 1;
+    }
+
+    std::vector<uint8_t> request;
+    Protocol::Writer w(request);
+    w.begin(Protocol::MSG_SPECTATE);
+    w.u32(options.gameId);
+    w.end();
+    if (!sendAll(fd, request)) {
+        ::close(fd);
+        return 1;
+    }
+
+    Spectator::Board board;
+    std::vector<uint8_t> input;
+    uint8_t chunk[16384];
+    int frames = 0;
+    unsigned long long deltaBytes = 0, deltas = 0, keyframeBytes = 0, keyframes = 0;
+    bool done = false;
+
+    while (!done) {
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        input.insert(input.end(), chunk, chunk + n);
+
+        size_t consumed = 0;
+        size_t frame;
+        while (!done && (frame = Protocol::completeFrame(input.data() + consumed, input.size() - consumed)) != 0) {
+            const uint8_t* data = input.data() + consumed;
+            consumed += frame;
+            if (frame < static_cast<size_t>(Protocol::HEADER_SIZE + 1)) continue;
+            Protocol::Reader r(data + Protocol::HEADER_SIZE + 1, frame - Protocol::HEADER_SIZE - 1);
+
+            switch (data[Protocol::HEADER_SIZE]) {
+                case Protocol::MSG_SPECTATOR_FRAME: {
+                    r.u32();
+                    size_t payloadSize = r.remaining();
+                    const uint8_t* payload = r.bytes(payloadSize);
+                    if (!payload || !board.apply(payload, payloadSize)) {
+                        std::fprintf(stderr, "Кадр не применился, ждем ключевой кадр\n");
+                        break;
+                    }
+                    bool keyframe = payload[0] == Spectator::KEYFRAME;
+                    (keyframe ? keyframeBytes : deltaBytes) += frame;
+                    ++(keyframe ? keyframes : deltas);
+
+                    std::printf("#%u %s: %zu байт, клеток %d, событий %zu, счет %d:%d, ходит %d\n",
+                                board.seq, keyframe ? "ключевой" : "дельта", frame, board.changedCells,
+                                board.events.size(), board.scores[0], board.scores[1], board.toMove);
+                    if (options.showBoard) printBoard(board);
+
+                    if (board.gameOver) {
+                        std::printf("Игра окончена, победил игрок %d\n", board.winner);
+                        done = true;
+                    }
+                    if (options.frames > 0 && ++frames >= options.frames) done = true;
+                    break;
+                }
+                case Protocol::MSG_CLOSED:
+                    std::printf("Трансляция закрыта\n");
+                    done = true;
+                    break;
+                case Protocol::MSG_ERROR:
+                    std::fprintf(stderr, "Ошибка сервера: %u\n", r.u8());
+                    done = true;
+                    break;
+                default:
+                    break;
+            }
+        }
+        input.erase(input.begin(), input.begin() + consumed);
+    }
+    ::close(fd);
+
+    if (deltas > 0 && board.size > 0) {
+        // MSG_STATE: заголовок кадра, 20 байт полей и по байту на клетку
+        size_t fullState = Protocol::HEADER_SIZE + 1 + 20 + board.size * board.size;
+        double average = static_cast<double>(deltaBytes) / deltas;
+        std::printf("Ключевых кадров: %llu (%llu байт), дельт: %llu, в среднем %.1f байт на ход "
+                    "против %zu байт полного поля (в %.1f раз меньше)\n",
+                    keyframes, keyframeBytes, deltas, average, fullState, fullState / average);
+    }
+    return 0;
+}
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "game.h"
+
+// ============= ТРАНСЛЯЦИЯ ДЛЯ ЗРИТЕЛЕЙ =============
+// Зритель получает ключевой кадр со всем полем, а дальше по кадру на ход:
+// только изменившиеся клетки, изменения очков и события способностей из
+// журнала партии. Ключевые кадры кодируются периодически, чтобы опоздавший
+// зритель мог начать с последнего из них.
+//
+// Числа - varint (LEB128), знаковые - через zigzag. Клетки - packCell().
+//   Общее начало: u8 тип, varint seq, u8 toMove, u8 gameOver, u8 winner
+//   KEYFRAME: zigzag очки x2, varint size, затем серии до конца поля:
+//             varint длина, varint значение клетки
+//   DELTA:    zigzag изменения очков x2, varint число групп, группы:
+//             varint пропуск от конца прошлой группы, varint длина,
+//             значения клеток подряд; varint число событий, события:
+//             u8 тип, u8 игрок, u8 способность, u8 направление, varint x, varint y
+//
+// seq растет на 1 с каждым ходом; ключевой кадр несет seq хода, после
+// которого он снят. Кадры - для партий на двоих: партию на троих и больше
+// кодировщик не берет (false, в out ничего не дописано).
+namespace Spectator {
+    // Готовый кадр, общий для всех зрителей: кодируется один раз, а в очереди
+    // соединений лежат только ссылки на него
+    using Frame = std::shared_ptr<const std::vector<uint8_t>>;
+
+    enum FrameType : uint8_t {
+        KEYFRAME = 1,
+        DELTA = 2
+    };
+
+    const int DEFAULT_KEYFRAME_INTERVAL = 32;
+
+    inline void putVarint(std::vector<uint8_t>& out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back(static_cast<uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(v));
+    }
+
+    inline uint64_t zigzag(int64_t v) {
+        return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    }
+
+    inline int64_t unzigzag(uint64_t v) {
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+
+    // Чтение с проверкой границ; после ошибки ok() == false
+    class Input {
+    private:
+        const uint8_t* p;
+        const uint8_t* end;
+        bool valid;
+
+    public:
+        Input(const uint8_t* data, size_t n) : p(data), end(data + n), valid(true) {}
+
+        bool ok() const { return valid; }
+        bool atEnd() const { return p == end; }
+
+        uint8_t u8() {
+            if (p >= end) { valid = false; return 0; }
+            return *p++;
+        }
+
+        uint64_t varint() {
+            uint64_t v = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                uint8_t b = u8();
+                v |= static_cast<uint64_t>(b & 0x7F) << shift;
+                if (!(b & 0x80)) return v;
+            }
+            valid = false;
+            return 0;
+        }
+    };
+
+    // ============= КОДИРОВЩИК =============
+    // Один на партию. Партия должна вести журнал (Game::setJournalEnabled).
+    class Encoder {
+    private:
+        int keyframeInterval;
+        uint32_t seq;
+        int deltasSinceKeyframe;
+        int32_t lastScores[2];
+        std::vector<CellDiff> changes; // Рабочие буферы encodeDelta()
+        std::vector<uint8_t> groups;
+
+        void writeHeader(std::vector<uint8_t>& out, FrameType type, const Game& game) const {
+            out.push_back(type);
+            putVarint(out, seq);
+            out.push_back(static_cast<uint8_t>(game.getCurrentPlayer() + 1));
+            out.push_back(game.isGameOver() ? 1 : 0);
+            out.push_back(static_cast<uint8_t>(game.getWinner()));
+        }
+
+    public:
+        explicit Encoder(int interval = DEFAULT_KEYFRAME_INTERVAL) :
+            keyframeInterval(interval), seq(0), deltasSinceKeyframe(0), lastScores{0, 0} {}
+
+        // Пора ли снять новый ключевой кадр для опоздавших зрителей
+        bool keyframeDue() const {
+            return deltasSinceKeyframe >= keyframeInterval;
+        }
+
+        bool encodeKeyframe(const Game& game, std::vector<uint8_t>& out) {
+            if (game.getPlayerCount() != 2) return false;
+            int size = game.getSize();
+            writeHeader(out, KEYFRAME, game);
+            for (int p = 0; p < 2; ++p) {
+                lastScores[p] = game.getPlayer(p).score;
+                putVarint(out, zigzag(lastScores[p]));
+            }
+            putVarint(out, static_cast<uint64_t>(size));
+
+            int cells = size * size;
+            int i = 0;
+            while (i < cells) {
+                uint16_t value = packCell(game.getCell(i / size, i % size));
+                int run = 1;
+                while (i + run < cells && packCell(game.getCell((i + run) / size, (i + run) % size)) == value) {
+                    ++run;
+                }
+                putVarint(out, static_cast<uint64_t>(run));
+                putVarint(out, value);
+                i += run;
+            }
+            deltasSinceKeyframe = 0;
+            return true;
+        }
+
+        // Кадр одного хода из журнала партии; журнал после этого очищается
+        bool encodeDelta(Game& game, std::vector<uint8_t>& out) {
+            if (game.getPlayerCount() != 2) return false;
+            int size = game.getSize();
+            ++seq;
+            ++deltasSinceKeyframe;
+            writeHeader(out, DELTA, game);
+            for (int p = 0; p < 2; ++p) {
+                int32_t score = game.getPlayer(p).score;
+                putVarint(out, zigzag(static_cast<int64_t>(score) - lastScores[p]));
+                lastScores[p] = score;
+            }
+
+            // Клетка могла меняться за ход несколько раз (бомба, потом
+            // автозахват): оставляем первое "до" и последнее "после"
+            changes.assign(game.getCellJournal().begin(), game.getCellJournal().end());
+            std::stable_sort(changes.begin(), changes.end(), [size](const CellDiff& a, const CellDiff& b) {
+                return a.x * size + a.y < b.x * size + b.y;
+            });
+            size_t kept = 0;
+            for (size_t i = 0; i < changes.size();) {
+                size_t j = i;
+                while (j + 1 < changes.size() && changes[j + 1].x == changes[i].x && changes[j + 1].y == changes[i].y) ++j;
+                if (changes[i].before != changes[j].after) {
+                    changes[kept] = changes[i];
+                    changes[kept].after = changes[j].after;
+                    ++kept;
+                }
+                i = j + 1;
+            }
+            changes.resize(kept);
+
+            // Группы подряд идущих клеток
+            groups.clear();
+            int groupCount = 0;
+            int previousEnd = 0;
+            for (size_t i = 0; i < changes.size();) {
+                int start = changes[i].x * size + changes[i].y;
+                size_t j = i + 1;
+                while (j < changes.size() && changes[j].x * size + changes[j].y == start + static_cast<int>(j - i)) ++j;
+                putVarint(groups, static_cast<uint64_t>(start - previousEnd));
+                putVarint(groups, j - i);
+                for (size_t k = i; k < j; ++k) putVarint(groups, changes[k].after);
+                previousEnd = start + static_cast<int>(j - i);
+                ++groupCount;
+                i = j;
+            }
+            putVarint(out, static_cast<uint64_t>(groupCount));
+            out.insert(out.end(), groups.begin(), groups.end());
+
+            const auto& events = game.getEventJournal();
+            putVarint(out, events.size());
+            for (const GameEvent& e : events) {
+                out.push_back(e.type);
+                out.push_back(e.playerId);
+                out.push_back(e.ability);
+                out.push_back(static_cast<uint8_t>(e.direction));
+                putVarint(out, e.x);
+                putVarint(out, e.y);
+            }
+
+            game.clearJournal();
+            return true;
+        }
+    };
+
+    // ============= ДЕКОДЕР =============
+    // Поле на стороне зрителя. Дельта применяется только к синхронному полю
+    // со следующим по порядку seq; иначе нужно дождаться ключевого кадра.
+    class Board {
+    private:
+        bool synced;
+        // Дельта сначала разбирается сюда целиком и применяется к cells,
+        // только если весь кадр цел
+        std::vector<uint32_t> pendingCells;
+        std::vector<uint16_t> pendingValues;
+        std::vector<GameEvent> pendingEvents;
+
+    public:
+        uint32_t seq;
+        int size;
+        std::vector<uint16_t> cells;  // packCell(), индекс x * size + y
+        int32_t scores[2];
+        uint8_t toMove;
+        bool gameOver;
+        uint8_t winner;
+        std::vector<GameEvent> events; // События последней дельты
+        int changedCells;              // Клеток в последней дельте
+
+        Board() : synced(false), seq(0), size(0), scores{0, 0}, toMove(0), gameOver(false),
+                  winner(0), changedCells(0) {}
+
+        bool isSynced() const { return synced; }
+
+        // false - кадр поврежден или не по порядку
+        bool apply(const uint8_t* data, size_t n) {
+            Input in(data, n);
+            uint8_t type = in.u8();
+            uint32_t frameSeq = static_cast<uint32_t>(in.varint());
+            uint8_t frameToMove = in.u8();
+            bool frameGameOver = in.u8() != 0;
+            uint8_t frameWinner = in.u8();
+            if (!in.ok()) return false;
+
+            if (type == KEYFRAME) {
+                int32_t newScores[2];
+                for (int p = 0; p < 2; ++p) newScores[p] = static_cast<int32_t>(unzigzag(in.varint()));
+                int newSize = static_cast<int>(in.varint());
+                if (!in.ok() || newSize <= 0 || newSize > 4096) return false;
+                std::vector<uint16_t> newCells;
+                newCells.reserve(newSize * newSize);
+                while (static_cast<int>(newCells.size()) < newSize * newSize) {
+                    uint64_t run = in.varint();
+                    uint16_t value = static_cast<uint16_t>(in.varint());
+                    if (!in.ok() || run == 0 || newCells.size() + run > static_cast<size_t>(newSize * newSize)) return false;
+                    newCells.insert(newCells.end(), run, value);
+                }
+                size = newSize;
+                cells.swap(newCells);
+                scores[0] = newScores[0];
+                scores[1] = newScores[1];
+                events.clear();
+                changedCells = 0;
+            } else if (type == DELTA) {
+                if (!synced || frameSeq != seq + 1) return false;
+                int32_t delta[2];
+                for (int p = 0; p < 2; ++p) delta[p] = static_cast<int32_t>(unzigzag(in.varint()));
+                uint64_t groupCount = in.varint();
+                uint64_t pos = 0;
+                pendingCells.clear();
+                pendingValues.clear();
+                for (uint64_t g = 0; g < groupCount && in.ok(); ++g) {
+                    uint64_t gap = in.varint();
+                    uint64_t count = in.varint();
+                    if (!in.ok() || gap > cells.size() - pos) return false;
+                    pos += gap;
+                    if (count > cells.size() - pos) return false;
+                    for (uint64_t k = 0; k < count && in.ok(); ++k) {
+                        pendingCells.push_back(static_cast<uint32_t>(pos++));
+                        pendingValues.push_back(static_cast<uint16_t>(in.varint()));
+                    }
+                }
+                uint64_t eventCount = in.varint();
+                pendingEvents.clear();
+                for (uint64_t e = 0; e < eventCount && in.ok(); ++e) {
+                    GameEvent event;
+                    event.type = in.u8();
+                    event.playerId = in.u8();
+                    event.ability = in.u8();
+                    event.direction = static_cast<char>(in.u8());
+                    event.x = static_cast<uint16_t>(in.varint());
+                    event.y = static_cast<uint16_t>(in.varint());
+                    pendingEvents.push_back(event);
+                }
+                if (!in.ok()) return false;
+                for (size_t i = 0; i < pendingCells.size(); ++i) cells[pendingCells[i]] = pendingValues[i];
+                scores[0] += delta[0];
+                scores[1] += delta[1];
+                events.swap(pendingEvents);
+                changedCells = static_cast<int>(pendingCells.size());
+            } else {
+                return false;
+            }
+
+            seq = frameSeq;
+            toMove = frameToMove;
+            gameOver = frameGameOver;
+            winner = frameWinner;
+            synced = true;
+            return in.ok();
+        }
+    };
+}
@@ -0,0 +1,302 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "game.h"
+
+// ============= КОЛЬЦО СОСТОЯНИЙ В ОБЩЕЙ ПАМЯТИ =============
+// Партия после каждого хода кладет позицию в кольцо слотов в POSIX shared
+// memory (shm_open), и внешние процессы - тренер, просмотрщик - читают ее
+// без сокетов и сериализации.
+//
+// Слот защищен seqlock: писатель делает номер слота нечетным, пишет,
+// затем снова четным. Читатель копирует слот и проверяет, что номер не
+// изменился и четный, иначе пробует еще раз. Писатель никого не ждет:
+// медленный читатель просто теряет перезаписанные слоты.
+//
+// Раскладка: Header, затем slotCount слотов по slotBytes байт. Слот -
+// SlotHeader и PLANES битовых плоскостей по planeWords слов uint64,
+// бит клетки - x * size + y. Слот несет очки и плоскости двух игроков:
+// партии на троих и больше в кольцо не попадают.
+namespace StateRing {
+    const uint32_t MAGIC = 0x52535743; // "CWSR"
+    const uint32_t VERSION = 1;
+    const uint32_t DEFAULT_SLOTS = 64;
+
+    enum Plane {
+        PLANE_PLAYER1 = 0,
+        PLANE_PLAYER2 = 1,
+        PLANE_KING = 2,
+        PLANE_FORTIFIED = 3,
+        PLANE_SABOTAGE = 4,
+        PLANES = 5
+    };
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t boardSize;
+        uint32_t slotCount;
+        uint32_t planeWords;
+        uint32_t slotBytes;
+        std::atomic<uint64_t> published; // Сколько ходов опубликовано; последний - в слоте (published - 1) % slotCount
+    };
+
+    struct SlotHeader {
+        std::atomic<uint64_t> sequence;  // Нечетный - слот пишется
+        uint64_t turn;                   // Номер хода с 1
+        int32_t scores[2];
+        uint8_t currentPlayer;           // 1-2, чей ход после этого
+        uint8_t gameOver;
+        uint8_t winner;
+        uint8_t reserved[5];
+    };
+
+    static_assert(sizeof(Header) <= 64, "заголовок занимает первую строку кэша");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "seqlock нужен атомарный uint64 без блокировок");
+
+    // Позиция, скопированная читателем
+    struct Snapshot {
+        uint64_t turn = 0;
+        int32_t scores[2] = {0, 0};
+        uint8_t currentPlayer = 0;
+        bool gameOver = false;
+        uint8_t winner = 0;
+        int boardSize = 0;
+        std::vector<uint64_t> planes;    // PLANES * planeWords
+
+        bool test(Plane plane, int x, int y) const {
+            int bit = x * boardSize + y;
+            int words = (boardSize * boardSize + 63) / 64;
+            return (planes[plane * words + bit / 64] >> (bit % 64)) & 1;
+        }
+    };
+
+    inline uint32_t planeWordsFor(int boardSize) {
+        return static_cast<uint32_t>((boardSize * boardSize + 63) / 64);
+    }
+
+    inline uint32_t slotBytesFor(int boardSize) {
+        size_t bytes = sizeof(SlotHeader) + PLANES * planeWordsFor(boardSize) * sizeof(uint64_t);
+        return static_cast<uint32_t>((bytes + 63) / 64 * 64); // Слоты не делят строки кэша
+    }
+
+    inline size_t mappingBytes(uint32_t slotCount, uint32_t slotBytes) {
+        return 64 + static_cast<size_t>(slotCount) * slotBytes;
+    }
+
+    // ============= ПИСАТЕЛЬ =============
+    class Writer {
+    private:
+        std::string name;
+        uint8_t* base;
+        size_t length;
+        Header* header;
+
+        SlotHeader* slot(uint64_t index) const {
+            return reinterpret_cast<SlotHeader*>(base + 64 + (index % header->slotCount) * header->slotBytes);
+        }
+
+    public:
+        Writer() : base(nullptr), length(0), header(nullptr) {}
+        ~Writer() { close(); }
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        // name - имя объекта shm ("/cell-warfare"); старое кольцо с тем же
+        // именем пересоздается
+        bool open(const std::string& shmName, int boardSize, uint32_t slotCount = DEFAULT_SLOTS) {
+            close();
+            uint32_t slotBytes = slotBytesFor(boardSize);
+            size_t bytes = mappingBytes(slotCount, slotBytes);
+
+            shm_unlink(shmName.c_str());
+            int fd = shm_open(shmName.c_str(), O_CREAT | O_RDWR, 0644);
+            if (fd < 0) return false;
+            if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+                ::close(fd);
+                shm_unlink(shmName.c_str());
+                return false;
+            }
+            void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (p == MAP_FAILED) {
+                shm_unlink(shmName.c_str());
+                return false;
+            }
+
+            name = shmName;
+            base = static_cast<uint8_t*>(p);
+            length = bytes;
+            header = new (base) Header();
+            header->boardSize = static_cast<uint32_t>(boardSize);
+            header->slotCount = slotCount;
+            header->planeWords = planeWordsFor(boardSize);
+            header->slotBytes = slotBytes;
+            header->published.store(0, std::memory_order_relaxed);
+            for (uint32_t i = 0; i < slotCount; ++i) new (slot(i)) SlotHeader();
+            header->version = VERSION;
+            // magic последним: читатель не примет недописанный заголовок
+            std::atomic_thread_fence(std::memory_order_release);
+            header->magic = MAGIC;
+            return true;
+        }
+
+        void close() {
+            if (!base) return;
+            munmap(base, length);
+            shm_unlink(name.c_str());
+            base = nullptr;
+            header = nullptr;
+        }
+
+        bool isOpen() const { return base != nullptr; }
+
+        // Кладет позицию в следующий слот. Не блокируется и не выделяет память.
+        void publish(const Game& game) {
+            if (!base || game.getSize() != static_cast<int>(header->boardSize) || game.getPlayerCount() != 2) return;
+            uint64_t turn = header->published.load(std::memory_order_relaxed) + 1;
+            SlotHeader* s = slot(turn - 1);
+
+            uint64_t sequence = s->sequence.load(std::memory_order_relaxed);
+            s->sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            s->turn = turn;
+            s->scores[0] = game.getPlayer(0).score;
+            s->scores[1] = game.getPlayer(1).score;
+            s->currentPlayer = static_cast<uint8_t>(game.getCurrentPlayer() + 1);
+            s->gameOver = game.isGameOver() ? 1 : 0;
+            s->winner = static_cast<uint8_t>(game.getWinner());
+
+            int size = game.getSize();
+            uint32_t words = header->planeWords;
+            uint64_t* planes = reinterpret_cast<uint64_t*>(s + 1);
+            std::memset(planes, 0, PLANES * words * sizeof(uint64_t));
+            for (int x = 0; x < size; ++x) {
+                for (int y = 0; y < size; ++y) {
+                    const Cell& cell = game.getCell(x, y);
+                    int bit = x * size + y;
+                    uint64_t mask = uint64_t(1) << (bit % 64);
+                    int word = bit / 64;
+                    if (cell.ownerId == 1) planes[PLANE_PLAYER1 * words + word] |= mask;
+                    if (cell.ownerId == 2) planes[PLANE_PLAYER2 * words + word] |= mask;
+                    if (cell.kingCell) planes[PLANE_KING * words + word] |= mask;
+                    if (cell.isFortified) planes[PLANE_FORTIFIED * words + word] |= mask;
+                    if (cell.sabotageCell) planes[PLANE_SABOTAGE * words + word] |= mask;
+                }
+            }
+
+            s->sequence.store(sequence + 2, std::memory_order_release);
+            header->published.store(turn, std::memory_order_release);
+        }
+    };
+
+    // ============= ЧИТАТЕЛЬ =============
+    class Reader {
+    private:
+        const uint8_t* base;
+        size_t length;
+        const Header* header;
+
+        const SlotHeader* slot(uint64_t index) const {
+            return reinterpret_cast<const SlotHeader*>(base + 64 + (index % header->slotCount) * header->slotBytes);
+        }
+
+    public:
+        Reader() : base(nullptr), length(0), header(nullptr) {}
+        ~Reader() { close(); }
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        bool open(const std::string& shmName) {
+            close();
+            int fd = shm_open(shmName.c_str(), O_RDONLY, 0);
+            if (fd < 0) return false;
+            struct stat st;
+            if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < 64) {
+                ::close(fd);
+                return false;
+            }
+            void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (p == MAP_FAILED) return false;
+
+            base = static_cast<const uint8_t*>(p);
+            length = static_cast<size_t>(st.st_size);
+            header = reinterpret_cast<const Header*>(base);
+            bool valid = header->magic == MAGIC;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // Размеры из заголовка сверяются между собой: иначе slot() делит
+            // на ноль, а read() копирует плоскости за пределами слота
+            if (!valid || header->version != VERSION ||
+                !Game::isKnownSize(static_cast<int>(header->boardSize)) ||
+                header->slotCount == 0 ||
+                header->planeWords != planeWordsFor(static_cast<int>(header->boardSize)) ||
+                header->slotBytes < slotBytesFor(static_cast<int>(header->boardSize)) ||
+                length < mappingBytes(header->slotCount, header->slotBytes)) {
+                close();
+                return false;
+            }
+            return true;
+        }
+
+        void close() {
+            if (!base) return;
+            munmap(const_cast<uint8_t*>(base), length);
+            base = nullptr;
+            header = nullptr;
+        }
+
+        int boardSize() const { return static_cast<int>(header->boardSize); }
+        uint32_t slotCount() const { return header->slotCount; }
+
+        uint64_t published() const {
+            return header->published.load(std::memory_order_acquire);
+        }
+
+        // Копия хода turn (с 1). false - ход еще не опубликован или уже
+        // перезаписан писателем
+        bool read(uint64_t turn, Snapshot& out) const {
+            if (turn == 0 || turn > published()) return false;
+            const SlotHeader* s = slot(turn - 1);
+            uint32_t words = header->planeWords;
+            out.boardSize = static_cast<int>(header->boardSize);
+            out.planes.resize(PLANES * words);
+
+            for (;;) {
+                uint64_t before = s->sequence.load(std::memory_order_acquire);
+                if (before & 1) continue; // Писатель как раз в этом слоте
+                out.turn = s->turn;
+                out.scores[0] = s->scores[0];
+                out.scores[1] = s->scores[1];
+                out.currentPlayer = s->currentPlayer;
+                out.gameOver = s->gameOver != 0;
+                out.winner = s->winner;
+                std::memcpy(out.planes.data(), s + 1, PLANES * words * sizeof(uint64_t));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (s->sequence.load(std::memory_order_relaxed) == before) break;
+            }
+            return out.turn == turn;
+        }
+
+        // Последний опубликованный ход; false - еще ничего нет
+        bool latest(Snapshot& out) const {
+            for (;;) {
+                uint64_t turn = published();
+                if (turn == 0) return false;
+                if (read(turn, out)) return true;
+            }
+        }
+    };
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// ============= ОБЩИЙ ПУЛ ПОТОКОВ =============
+// Один пул на процесс: его используют проходы по полю и все, кому нужны
+// фоновые задачи. Число рабочих потоков = ядра - 1 (вызывающий поток тоже
+// работает), переопределяется переменной окружения CELL_WARFARE_THREADS.
+class ThreadPool {
+private:
+    // Проход parallelFor: лежит на стеке вызывающего, пул держит на него
+    // только указатель, поэтому проход не выделяет память
+    struct Job {
+        void (*invoke)(const void*, int, int);
+        const void* body;
+        int begin, end, grain, chunks;
+        std::atomic<int> next{0};
+        int waiting = 0;             // Помощников еще не пришло (под mutex)
+        int running = 0;             // Помощников в runChunks (под mutex)
+        Job* nextJob = nullptr;
+    };
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    Job* jobs = nullptr;             // Проходы, которым еще нужны помощники
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::condition_variable helpersLeft;
+    bool stopping;
+
+    static void runChunks(Job& job) {
+        for (int c = job.next.fetch_add(1); c < job.chunks; c = job.next.fetch_add(1)) {
+            int from = job.begin + c * job.grain;
+            job.invoke(job.body, from, std::min(job.end, from + job.grain));
+        }
+    }
+
+    // Под mutex
+    void unlinkJob(Job* job) {
+        for (Job** link = &jobs; *link; link = &(*link)->nextJob) {
+            if (*link == job) {
+                *link = job->nextJob;
+                return;
+            }
+        }
+    }
+
+    void workerLoop() {
+        for (;;) {
+            Job* job = nullptr;
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeUp.wait(lock, [this] { return stopping || jobs || !tasks.empty(); });
+                if (jobs) {
+                    job = jobs;
+                    if (--job->waiting == 0) unlinkJob(job);
+                    ++job->running;
+                } else if (tasks.empty()) {
+                    return;
+                } else {
+                    task = std::move(tasks.front());
+                    tasks.pop();
+                }
+            }
+            if (job) {
+                runChunks(*job);
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--job->running == 0) helpersLeft.notify_all();
+            } else {
+                task();
+            }
+        }
+    }
+
+    static int defaultThreadCount() {
+        if (const char* env = std::getenv("CELL_WARFARE_THREADS")) {
+            int n = std::atoi(env);
+            if (n > 0) return n;
+        }
+        unsigned hw = std::thread::hardware_concurrency();
+        return hw > 0 ? static_cast<int>(hw) : 1;
+    }
+
+public:
+    explicit ThreadPool(int threads) : stopping(false) {
+        for (int i = 1; i < threads; ++i) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    static ThreadPool& instance() {
+        static ThreadPool pool(defaultThreadCount());
+        return pool;
+    }
+
+    // Потоков, включая вызывающий
+    int threadCount() const {
+        return static_cast<int>(workers.size()) + 1;
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push(std::move(task));
+        }
+        wakeUp.notify_one();
+    }
+
+    // Делит [begin, end) на куски по grain и выполняет fn(from, to) для каждого.
+    // Вызывающий поток разбирает куски наравне с рабочими и возвращается,
+    // когда все куски готовы. Память не выделяется: fn вызывается через
+    // указатель на функцию, а не std::function.
+    template <typename Fn>
+    void parallelFor(int begin, int end, int grain, const Fn& fn) {
+        if (end <= begin) return;
+        grain = std::max(1, grain);
+        int chunks = (end - begin + grain - 1) / grain;
+        if (chunks == 1 || workers.empty()) {
+            fn(begin, end);
+            return;
+        }
+
+        Job job;
+        job.invoke = [](const void* body, int from, int to) { (*static_cast<const Fn*>(body))(from, to); };
+        job.body = &fn;
+        job.begin = begin;
+        job.end = end;
+        job.grain = grain;
+        job.chunks = chunks;
+        int helpers = std::min(static_cast<int>(workers.size()), chunks - 1);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job.waiting = helpers;
+            job.nextJob = jobs;
+            jobs = &job;
+        }
+        for (int i = 0; i < helpers; ++i) wakeUp.notify_one();
+        runChunks(job);
+
+        // Все куски разобраны: помощник, который не успел прийти, уже не
+        // нужен и не увидит job; ждать остается только тех, кто еще считает
+        std::unique_lock<std::mutex> lock(mutex);
+        if (job.waiting > 0) unlinkJob(&job);
+        helpersLeft.wait(lock, [&] { return job.running == 0; });
+    }
+};